@@ -15,9 +15,9 @@
 
 #include "../common/url.h"
 
-bnet::Handle httpSendRequest(uint32_t _ip, uint16_t _port, const char* _request, bool secure)
+bnet::Handle httpSendRequest(const bnet::Address* _addrs, uint32_t _num, uint16_t _port, const char* _request, bool secure)
 {
-	bnet::Handle handle = bnet::connect(_ip, _port, true, secure);
+	bnet::Handle handle = bnet::connect(_addrs, _num, _port, true, secure);
 
 	bnet::Message* out = bnet::alloc(handle, (uint16_t)strlen(_request) );
 	memcpy(out->data, _request, out->size);
@@ -92,7 +92,7 @@ int main(int /*_argc*/, const char* /*_argv*/[])
 
 	if (0 != port)
 	{
-		uint32_t ip = bnet::toIpv4(tokens[UrlToken::Host]);
+		bnet::resolve(tokens[UrlToken::Host]);
 		if ('\0' != tokens[UrlToken::Port][0])
 		{
 			port = atoi(tokens[UrlToken::Port]);
@@ -106,24 +106,10 @@ int main(int /*_argc*/, const char* /*_argv*/[])
 				, tokens[UrlToken::Host]
 				);
 
-		bnet::Handle handle = httpSendRequest(ip, port, header, secure);
-
 		uint32_t size = 0;
 		uint8_t* data = NULL;
 
-		bool cont = bnet::isValid(handle);
-		if (cont)
-		{
-			printf("Connecting to %s (%d.%d.%d.%d:%d)\n"
-				, url
-				, ip>>24
-				, (ip>>16)&0xff
-				, (ip>>8)&0xff
-				, ip&0xff
-				, port
-				);
-		}
-
+		bool cont = true;
 		while (cont)
 		{
 			bnet::Message* msg = bnet::recv();
@@ -133,6 +119,34 @@ int main(int /*_argc*/, const char* /*_argv*/[])
 				{
 					switch (msg->data[0])
 					{
+					case bnet::MessageId::Resolved:
+						{
+							bnet::Address addrs[16];
+							uint32_t num = msg->data[13] < BX_COUNTOF(addrs) ? msg->data[13] : BX_COUNTOF(addrs);
+							memcpy(addrs, &msg->data[14], num*sizeof(bnet::Address) );
+
+							bnet::Handle handle = bnet::invalidHandle;
+							if (0 != num)
+							{
+								handle = httpSendRequest(addrs, num, port, header, secure);
+							}
+
+							cont = bnet::isValid(handle);
+							if (cont)
+							{
+								printf("Connecting to %s (%d addresses, port %d)\n"
+									, url
+									, num
+									, port
+									);
+							}
+							else
+							{
+								printf("Failed to resolve %s.\n", tokens[UrlToken::Host]);
+							}
+						}
+						break;
+
 					case bnet::MessageId::Notify:
 						printf("notify!\n");
 						break;
@@ -15,9 +15,29 @@ namespace bx { struct AllocatorI; }
 
 namespace bnet
 {
-	BNET_HANDLE(Handle);
+	BNET_HANDLE(ContextHandle);
+	BNET_HANDLE(GroupHandle);
 
-	static const Handle invalidHandle = { UINT16_MAX };
+	/// Connection or listen socket handle. Generation changes every time
+	/// handle is released, so stale handles are rejected, even after slot
+	/// is reused.
+	struct Handle
+	{
+		uint16_t idx;
+		uint16_t gen;
+	};
+
+	/// Timer handle, generation changes every time timer is destroyed.
+	struct TimerHandle
+	{
+		uint16_t idx;
+		uint16_t gen;
+	};
+
+	static const Handle invalidHandle = { UINT16_MAX, 0 };
+	static const ContextHandle invalidContextHandle = { UINT16_MAX };
+	static const GroupHandle invalidGroupHandle = { UINT16_MAX };
+	static const TimerHandle invalidTimerHandle = { UINT16_MAX, 0 };
 	static const uint16_t maxMessageSize = UINT16_MAX;
 
 	struct MessageId
@@ -30,8 +50,13 @@ namespace bnet
 			ListenFailed,
 			ConnectFailed,
 			RawData,
+			Fragment,
+			Resolved,
+			Timer,
+			SendQueueFull,
+			SendQueueDrained,
 
-			UserDefined = 8
+			UserDefined = 16
 		};
 	};
 
@@ -44,6 +69,107 @@ namespace bnet
 			RecvFailed,
 			SendFailed,
 			InvalidMessageId,
+			Timeout,
+			SendQueueLimit,
+
+			Count
+		};
+	};
+
+	/// Why connection failed before it was established, see
+	/// `TrafficStats::connectFailures`.
+	struct ConnectFailure
+	{
+		enum Enum
+		{
+			Error,     //< Socket couldn't be created, or connect was refused or unreachable.
+			Timeout,   //< Connection wasn't established in BNET_CONFIG_CONNECT_TIMEOUT_SECONDS.
+			Handshake, //< Connection was lost, or SSL verification failed, during handshake.
+
+			Count
+		};
+	};
+
+	/// What happens to message queued on connection that reached its send
+	/// queue limit, see `bnet::setSendLimit`.
+	struct SendLimit
+	{
+		enum Enum
+		{
+			Drop,       //< Message is released without sending it.
+			Disconnect, //< Connection is closed with `DisconnectReason::SendQueueLimit`.
+		};
+	};
+
+	/// Delivery guarantee of message sent on UDP connection, selected with
+	/// `bnet::send`. TCP connections deliver all messages reliably and in
+	/// order.
+	struct Channel
+	{
+		enum Enum
+		{
+			ReliableOrdered,     //< Resent until acknowledged, delivered in order.
+			Unreliable,          //< Sent once, might be lost or reordered.
+			UnreliableSequenced, //< Sent once, dropped if newer message was already received.
+
+			Count
+		};
+	};
+
+	/// Send priority class of message, selected with `bnet::alloc`.
+	/// Higher classes are sent first, messages of same class are sent in
+	/// order. Lower classes get share of connection even while higher
+	/// classes have messages queued. Ignored by UDP connections.
+	struct Priority
+	{
+		enum Enum
+		{
+			High,   //< Latency critical messages.
+			Normal, //< Default.
+			Low,    //< Bulk transfers, large messages are sent in this class.
+
+			Count
+		};
+	};
+
+	struct AddressFamily
+	{
+		enum Enum
+		{
+			Ipv4,
+			Ipv6,
+		};
+	};
+
+	/// IPv4 or IPv6 address, see `bnet::toAddress`.
+	struct Address
+	{
+		uint8_t family;   //< `AddressFamily::Enum`.
+		uint8_t data[16]; //< Address in network byte order, IPv4 uses first 4 bytes.
+	};
+
+	/// Compression codec of framed connection messages.
+	struct Codec
+	{
+		enum Enum
+		{
+			None,
+			Lz4, //< LZ4 block format.
+
+			Count
+		};
+	};
+
+	/// Fragment of large message sent with `bnet::sendLarge`. Data of
+	/// `MessageId::Fragment` message is message id, fragment flags, total
+	/// message size as 32-bit little-endian integer (first fragment
+	/// only), followed by payload.
+	struct FragmentFlags
+	{
+		enum Enum
+		{
+			First = 0x01,
+			Last  = 0x02,
 		};
 	};
 
@@ -51,26 +177,306 @@ namespace bnet
 	struct Message
 	{
 		uint8_t* data; //< Message data.
-		uint16_t size; //< Message size.
+		uint32_t size; //< Message size. Exceeds `maxMessageSize` only for reassembled large messages.
 		Handle handle; //< Connection handle.
 	};
 
 	typedef Message IncomingMessage;
 	typedef Message OutgoingMessage;
 
+	/// Message pool statistics, returned by `bnet::getPoolStats`. With I/O
+	/// thread, application and I/O thread have separate pools, stats are
+	/// combined and pool limit is split between them.
+	struct PoolStats
+	{
+		uint64_t hits;      //< Allocations served from pool free lists.
+		uint64_t misses;    //< Allocations that required allocator call.
+		uint32_t used;      //< Memory held by live messages.
+		uint32_t usedMax;   //< High-water mark of used memory.
+		uint32_t cached;    //< Memory kept in pool free lists.
+		uint32_t cachedMax; //< High-water mark of cached memory.
+	};
+
+	/// Receive buffer statistics, returned by `bnet::getRecvBufferStats`.
+	struct RecvBufferStats
+	{
+		uint32_t connections; //< Live connections.
+		uint32_t buffers;     //< Connections holding receive buffer.
+		uint32_t used;        //< Memory held by connection receive buffers.
+		uint32_t usedMax;     //< High-water mark of used memory.
+		uint32_t cached;      //< Memory kept in pool free lists.
+	};
+
+	/// Connection compression statistics, returned by
+	/// `bnet::getCompressionStats`.
+	struct CompressionStats
+	{
+		uint64_t sentRaw;        //< Size of messages passed to compressor.
+		uint64_t sentCompressed; //< Size of same messages as sent, compressed or not.
+		uint64_t recvCompressed; //< Size of compressed messages received.
+		uint64_t recvRaw;        //< Size of same messages after decompression.
+		uint64_t compressUs;     //< Time spent compressing, in microseconds.
+		uint64_t decompressUs;   //< Time spent decompressing, in microseconds.
+		uint8_t codec;           //< Codec of sent messages, `Codec::None` until peer accepts offer.
+		uint8_t dictionary;      //< Dictionary of sent messages, 0 when none.
+	};
+
+	/// Connection traffic statistics, returned by `bnet::getStats` and
+	/// `bnet::getGlobalStats`. Counters of closed connections are kept
+	/// in global statistics. Calls of connections driven by io_uring
+	/// engine count submitted operations.
+	struct TrafficStats
+	{
+		uint64_t bytesSent;         //< Bytes handed to socket, including framing.
+		uint64_t bytesReceived;     //< Bytes read from socket.
+		uint64_t messagesSent;      //< Messages handed to socket.
+		uint64_t messagesReceived;  //< Messages received from peer, reassembled or raw data chunks.
+		uint64_t sendCalls;         //< Send system calls.
+		uint64_t recvCalls;         //< Receive system calls.
+		uint64_t sendWouldBlock;    //< Send calls that would block.
+		uint64_t recvWouldBlock;    //< Receive calls that found no data.
+		uint64_t handshakeUs;       //< Time from connect or accept until connection is established, in microseconds.
+		uint32_t handshakes;        //< Connections established.
+		uint32_t accepted;          //< Connections accepted from listen sockets.
+		uint32_t connections;       //< Live connections.
+		uint32_t sendQueueMessages; //< Messages queued, not handed to socket yet.
+		uint32_t sendQueueBytes;    //< Size of queued messages.
+		uint32_t recvBufferUsed;    //< Received bytes not returned as messages yet.
+		uint32_t recvBufferSize;    //< Size of receive buffers held by connections.
+		uint32_t disconnects[DisconnectReason::Count]; //< Established connections closed, by reason.
+		uint32_t connectFailures[ConnectFailure::Count]; //< Connections that failed before they were established, by reason.
+	};
+
+	/// Latency measured for each message, see `bnet::getLatency`.
+	struct Latency
+	{
+		enum Enum
+		{
+			Send, //< From `bnet::send` until last byte of message is accepted by socket.
+			Recv, //< From message being received until it's returned by `bnet::recv`.
+
+			Count
+		};
+	};
+
+	/// Latency histogram summary, returned by `bnet::getLatency` and
+	/// `bnet::getGlobalLatency`. Percentiles are within 1/16 of value.
+	struct LatencyStats
+	{
+		uint64_t count;  //< Messages measured.
+		uint64_t meanNs; //< Mean latency, in nanoseconds.
+		uint64_t p50Ns;  //< Median latency, in nanoseconds.
+		uint64_t p99Ns;  //< 99th percentile, in nanoseconds.
+		uint64_t p999Ns; //< 99.9th percentile, in nanoseconds.
+		uint64_t maxNs;  //< Highest latency, in nanoseconds.
+	};
+
+	/// Host name resolver, see `bnet::setResolver`. Called on resolver
+	/// thread, so it must be thread safe.
+	///
+	/// @param _host Host name.
+	/// @param _addrs Receives addresses, in order they should be tried.
+	/// @param _num Size of `_addrs` array, receives number of addresses.
+	/// @param _ttl Receives number of seconds result can be cached, 0 if
+	///   it must not be cached.
+	/// @param _userData User data passed to `bnet::setResolver`.
+	///
+	/// @returns True if host name is resolved.
+	///
+	typedef bool (*ResolveFn)(const char* _host, Address* _addrs, uint32_t* _num, uint32_t* _ttl, void* _userData);
+
 	/// Returns is handle is valid.
 	inline bool isValid(Handle _handle) { return invalidHandle.idx != _handle.idx; }
 
-	/// Initialize networking.
+	/// Returns is context handle is valid.
+	inline bool isValid(ContextHandle _handle) { return invalidContextHandle.idx != _handle.idx; }
+
+	/// Returns is group handle is valid.
+	inline bool isValid(GroupHandle _handle) { return invalidGroupHandle.idx != _handle.idx; }
+
+	/// Returns is timer handle is valid.
+	inline bool isValid(TimerHandle _handle) { return invalidTimerHandle.idx != _handle.idx; }
+
+	/// Create networking context. Each context owns its connections,
+	/// listen sockets, message queues, message pool and allocator, and
+	/// can be used from its own thread. Creating and destroying contexts
+	/// is not thread safe.
 	///
 	/// @param _maxConnections Maximum concurrent outgoing connections.
 	/// @param _maxListenSockets Maximum number of listen ports.
 	/// @param _certs SSL certificates.
 	/// @param _allocator Custom allocator.
+	/// @param _ioThread Run socket updates on dedicated I/O thread. `send`
+	///   and `recv` then only exchange messages with I/O thread through
+	///   lock-free queues.
+	///
+	/// @returns Context handle.
+	///
+	ContextHandle createContext(uint16_t _maxConnections, uint16_t _maxListenSockets = 0, const char* _certs[] = NULL, bx::AllocatorI* _allocator = NULL, bool _ioThread = false);
+
+	/// Destroy networking context. All messages allocated from context
+	/// must be released before it's destroyed.
+	///
+	/// @param _ctx Context handle.
 	///
-	void init(uint16_t _maxConnections, uint16_t _maxListenSockets = 0, const char* _certs[] = NULL, bx::AllocatorI* _allocator = NULL);
+	void destroyContext(ContextHandle _ctx);
+
+	/// Start listen for incoming connections on context.
+	Handle listen(ContextHandle _ctx, uint32_t _ip, uint16_t _port, bool _raw = false, const char* _cert = NULL, const char* _key = NULL);
+
+	/// Start listen for incoming connections on port shared between
+	/// contexts. Each context gets its own listen socket bound with
+	/// SO_REUSEPORT, and kernel spreads incoming connections between
+	/// them. Fails with `MessageId::ListenFailed` on platforms without
+	/// SO_REUSEPORT.
+	///
+	/// @param _numShards If not zero, connection is steered to listen
+	///   socket `cpu % _numShards`, where cpu is core that received SYN.
+	///   Shards must be created in order, and thread driving each shard
+	///   should be pinned to matching core.
+	///
+	/// @returns Handle to listen socket.
+	///
+	Handle listenShared(ContextHandle _ctx, uint32_t _ip, uint16_t _port, uint16_t _numShards = 0, bool _raw = false, const char* _cert = NULL, const char* _key = NULL);
+
+	/// Start listen for incoming UDP connections on context.
+	Handle listenUdp(ContextHandle _ctx, uint32_t _ip, uint16_t _port);
+
+	/// Stop listening for incoming connections on context.
+	void stop(ContextHandle _ctx, Handle _handle);
+
+	/// Connect to remote host over UDP from context.
+	Handle connectUdp(ContextHandle _ctx, uint32_t _ip, uint16_t _port);
+
+	/// Connect to remote host from context.
+	Handle connect(ContextHandle _ctx, uint32_t _ip, uint16_t _port, bool _raw = false, bool _secure = false);
+
+	/// Connect to first of remote host addresses that accepts connection,
+	/// from context.
+	Handle connect(ContextHandle _ctx, const Address* _addrs, uint32_t _num, uint16_t _port, bool _raw = false, bool _secure = false);
+
+	/// Disconnect context connection from remote host.
+	void disconnect(ContextHandle _ctx, Handle _handle, bool _finish = false);
+
+	/// Notify sender when all prior messages of priority class on context
+	/// connection are sent.
+	void notify(ContextHandle _ctx, Handle _handle, uint64_t _userData = 0, Priority::Enum _priority = Priority::Normal);
+
+	/// Allocate outgoing message for context connection. Message is sent
+	/// with `bnet::send`, which routes it to context it was allocated
+	/// from.
+	OutgoingMessage* alloc(ContextHandle _ctx, Handle _handle, uint16_t _size, Priority::Enum _priority = Priority::Normal);
+
+	/// Allocate outgoing messages of same size for context connections.
+	void allocBatch(ContextHandle _ctx, OutgoingMessage** _msgs, const Handle* _handles, uint32_t _num, uint16_t _size, Priority::Enum _priority = Priority::Normal);
+
+	/// Send messages queued on context.
+	void flush(ContextHandle _ctx);
+
+	/// Create connection group on context.
+	GroupHandle createGroup(ContextHandle _ctx);
+
+	/// Destroy context connection group.
+	void destroyGroup(ContextHandle _ctx, GroupHandle _group);
+
+	/// Add context connection to group.
+	void addToGroup(ContextHandle _ctx, GroupHandle _group, Handle _handle);
 
-	/// Shutdown networking.
+	/// Remove context connection from group.
+	void removeFromGroup(ContextHandle _ctx, GroupHandle _group, Handle _handle);
+
+	/// Send large message on context connection.
+	void sendLarge(ContextHandle _ctx, Handle _handle, const void* _data, uint32_t _size);
+
+	/// Set largest message reassembled on context connection.
+	void setReassembly(ContextHandle _ctx, Handle _handle, uint32_t _maxSize);
+
+	/// Set idle timeout of context connection.
+	void setIdleTimeout(ContextHandle _ctx, Handle _handle, uint32_t _ms);
+
+	/// Set send queue watermarks of context connection.
+	void setSendWatermarks(ContextHandle _ctx, Handle _handle, uint32_t _low, uint32_t _high);
+
+	/// Set send queue limit of context connection.
+	void setSendLimit(ContextHandle _ctx, Handle _handle, uint32_t _size, SendLimit::Enum _policy = SendLimit::Drop);
+
+	/// Returns bytes queued on context connection.
+	uint32_t getSendQueueSize(ContextHandle _ctx, Handle _handle);
+
+	/// Returns context connection traffic statistics.
+	const TrafficStats* getStats(ContextHandle _ctx, Handle _handle);
+
+	/// Returns traffic statistics of all context connections.
+	const TrafficStats* getGlobalStats(ContextHandle _ctx);
+
+	/// Returns context connection latency summary.
+	const LatencyStats* getLatency(ContextHandle _ctx, Handle _handle, Latency::Enum _latency, bool _reset = false);
+
+	/// Returns latency summary of all context connections.
+	const LatencyStats* getGlobalLatency(ContextHandle _ctx, Latency::Enum _latency, bool _reset = false);
+
+	/// Create timer on context.
+	TimerHandle createTimer(ContextHandle _ctx, uint64_t _userData);
+
+	/// Destroy context timer.
+	void destroyTimer(ContextHandle _ctx, TimerHandle _timer);
+
+	/// Start or restart context timer.
+	void startTimer(ContextHandle _ctx, TimerHandle _timer, uint32_t _ms, uint32_t _periodMs = 0);
+
+	/// Stop context timer.
+	void stopTimer(ContextHandle _ctx, TimerHandle _timer);
+
+	/// Set compression dictionary on context.
+	void setDictionary(ContextHandle _ctx, uint8_t _id, const void* _data, uint16_t _size);
+
+	/// Offer compression on context connection.
+	void setCompression(ContextHandle _ctx, Handle _handle, Codec::Enum _codec, uint8_t _dictionary = 0, uint16_t _threshold = 64);
+
+	/// Set compression offered on new context connections.
+	void setDefaultCompression(ContextHandle _ctx, Codec::Enum _codec, uint8_t _dictionary = 0, uint16_t _threshold = 64);
+
+	/// Returns context connection compression statistics.
+	const CompressionStats* getCompressionStats(ContextHandle _ctx, Handle _handle);
+
+	/// Resolve host name on context.
+	void resolve(ContextHandle _ctx, const char* _host, uint64_t _userData = 0);
+
+	/// Set host name resolver of context.
+	void setResolver(ContextHandle _ctx, ResolveFn _fn, void* _userData = NULL);
+
+	/// Process receive on context.
+	IncomingMessage* recv(ContextHandle _ctx);
+
+	/// Process receive on context, and return up to `_max` messages.
+	uint32_t recv(ContextHandle _ctx, IncomingMessage** _msgs, uint32_t _max);
+
+	/// Enable zero-copy receive for context connection.
+	void setZeroCopy(ContextHandle _ctx, Handle _handle, bool _enable = true);
+
+	/// Returns context message pool statistics.
+	const PoolStats* getPoolStats(ContextHandle _ctx);
+
+	/// Set maximum memory kept in context message pool free lists.
+	void setPoolLimit(ContextHandle _ctx, uint32_t _size);
+
+	/// Returns context receive buffer statistics.
+	const RecvBufferStats* getRecvBufferStats(ContextHandle _ctx);
+
+	/// Initialize networking, and create default context used by
+	/// functions without context handle.
+	///
+	/// @param _maxConnections Maximum concurrent outgoing connections.
+	/// @param _maxListenSockets Maximum number of listen ports.
+	/// @param _certs SSL certificates.
+	/// @param _allocator Custom allocator.
+	/// @param _ioThread Run socket updates on dedicated I/O thread. `send`
+	///   and `recv` then only exchange messages with I/O thread through
+	///   lock-free queues.
+	///
+	void init(uint16_t _maxConnections, uint16_t _maxListenSockets = 0, const char* _certs[] = NULL, bx::AllocatorI* _allocator = NULL, bool _ioThread = false);
+
+	/// Shutdown networking, and destroy default context.
 	void shutdown();
 
 	/// Start listen for incoming connections.
@@ -79,6 +485,16 @@ namespace bnet
 	///
 	Handle listen(uint32_t _ip, uint16_t _port, bool _raw = false, const char* _cert = NULL, const char* _key = NULL);
 
+	/// Start listen for incoming UDP connections. Each peer gets its own
+	/// connected socket, and its messages are sent and received with the
+	/// same API as TCP connection messages. Peer must echo cookie sent
+	/// to its address before socket is created for it. Fails with
+	/// `MessageId::ListenFailed` when `BNET_CONFIG_UDP` is not enabled.
+	///
+	/// @returns Handle to listen socket.
+	///
+	Handle listenUdp(uint32_t _ip, uint16_t _port);
+
 	/// Stop listening for incoming connections.
 	///
 	/// @param _handle Handle to connection object.
@@ -97,7 +513,39 @@ namespace bnet
 	///
 	Handle connect(uint32_t _ip, uint16_t _port, bool _raw = false, bool _secure = false);
 
-	/// Disconnect from remote host.
+	/// Connect to remote host with multiple addresses, usually IPv6 and
+	/// IPv4 addresses returned by `bnet::resolve`. Connect to next
+	/// address is started `BNET_CONFIG_CONNECT_STAGGER_MS` after previous
+	/// one, or as soon as all previous ones failed, and first connect to
+	/// complete is kept. Address that is slow or doesn't respond only
+	/// delays connect by stagger time.
+	///
+	/// @param _addrs Addresses, in order they are tried. Only first
+	///   `BNET_CONFIG_MAX_ADDRESSES` are used.
+	/// @param _num Number of addresses.
+	/// @param _port Port.
+	/// @param _raw Non-structured messages.
+	/// @param _secure Create TLS/SSL connection.
+	///
+	/// @returns Handle to connection object.
+	///
+	Handle connect(const Address* _addrs, uint32_t _num, uint16_t _port, bool _raw = false, bool _secure = false);
+
+	/// Connect to remote host over UDP. Connection is retried until host
+	/// accepts it, or `MessageId::ConnectFailed` is received after
+	/// `BNET_CONFIG_CONNECT_TIMEOUT_SECONDS`. Connection without traffic
+	/// for `BNET_CONFIG_UDP_TIMEOUT_SECONDS` is lost with
+	/// `DisconnectReason::Timeout`.
+	///
+	/// @param _ip IPv4 address.
+	/// @param _port Port.
+	///
+	/// @returns Handle to connection object.
+	///
+	Handle connectUdp(uint32_t _ip, uint16_t _port);
+
+	/// Disconnect from remote host. Handle is stale once this returns,
+	/// messages sent to it are dropped.
 	///
 	/// @param _handle Handle to connection object.
 	/// @param _finish Send all pending messages before closing
@@ -105,17 +553,26 @@ namespace bnet
 	///
 	void disconnect(Handle _handle, bool _finish = false);
 
-	/// Notify sender when all prior messages are sent.
-	void notify(Handle _handle, uint64_t _userData = 0);
+	/// Notify sender when all prior messages of priority class are sent.
+	/// Messages of other classes might still be queued, disconnect with
+	/// `_finish` waits for all of them.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _userData User data returned with `MessageId::Notify`.
+	/// @param _priority Priority class of messages to wait for.
+	///
+	void notify(Handle _handle, uint64_t _userData = 0, Priority::Enum _priority = Priority::Normal);
 
 	/// Allocate outgoing message.
 	///
 	/// @param _handle Handle to connection object.
 	/// @param _size Message size.
+	/// @param _priority Send priority class. Messages sent with
+	///   `bnet::broadcast` use priority class of payload message.
 	///
 	/// @returns Outgoing message object.
 	///
-	OutgoingMessage* alloc(Handle _handle, uint16_t _size);
+	OutgoingMessage* alloc(Handle _handle, uint16_t _size, Priority::Enum _priority = Priority::Normal);
 
 	/// Send message.
 	///
@@ -123,19 +580,377 @@ namespace bnet
 	///
 	void send(OutgoingMessage* _msg);
 
+	/// Send message on UDP connection channel. Messages must fit single
+	/// datagram, `BNET_CONFIG_UDP_MTU` minus 12 bytes of headers, larger
+	/// messages are dropped. Unreliable messages are never delayed by
+	/// reliable messages waiting for acknowledgement.
+	///
+	/// @param _msg Message object allocated with `bnet::alloc` call.
+	/// @param _channel Delivery guarantee, ignored by TCP connections.
+	///
+	void send(OutgoingMessage* _msg, Channel::Enum _channel);
+
+	/// Allocate outgoing messages of same size, one per connection.
+	///
+	/// @param _msgs Array receiving outgoing messages.
+	/// @param _handles Handles to connection objects.
+	/// @param _num Number of messages.
+	/// @param _size Message size.
+	/// @param _priority Send priority class.
+	///
+	void allocBatch(OutgoingMessage** _msgs, const Handle* _handles, uint32_t _num, uint16_t _size, Priority::Enum _priority = Priority::Normal);
+
+	/// Queue messages without sending them. Queued messages are sent by
+	/// `bnet::flush` or next `bnet::recv` call, with single write per
+	/// connection.
+	///
+	/// @param _msgs Messages allocated with `bnet::alloc` call.
+	/// @param _num Number of messages.
+	///
+	void sendBatch(OutgoingMessage** _msgs, uint32_t _num);
+
+	/// Send messages queued by `bnet::sendBatch`.
+	void flush();
+
+	/// Send same message to multiple connections. Message is framed once,
+	/// and its data is shared by all connections until last one sent it.
+	///
+	/// @param _msg Message allocated with `bnet::alloc` call, its handle
+	///   is ignored.
+	/// @param _handles Handles to connection objects.
+	/// @param _num Number of handles.
+	///
+	void broadcast(OutgoingMessage* _msg, const Handle* _handles, uint32_t _num);
+
+	/// Send same message to all connections in group.
+	///
+	/// @param _msg Message allocated with `bnet::alloc` call, its handle
+	///   is ignored.
+	/// @param _group Group of connections, created on same context as
+	///   message.
+	///
+	void broadcast(OutgoingMessage* _msg, GroupHandle _group);
+
+	/// Create connection group. Connections are removed from all groups
+	/// when they are destroyed.
+	///
+	/// @returns Group handle, or `invalidGroupHandle` when all
+	///   `BNET_CONFIG_MAX_GROUPS` groups are in use.
+	///
+	GroupHandle createGroup();
+
+	/// Destroy connection group.
+	void destroyGroup(GroupHandle _group);
+
+	/// Add connection to group.
+	///
+	/// @param _group Group handle.
+	/// @param _handle Handle to connection object.
+	///
+	void addToGroup(GroupHandle _group, Handle _handle);
+
+	/// Remove connection from group.
+	///
+	/// @param _group Group handle.
+	/// @param _handle Handle to connection object.
+	///
+	void removeFromGroup(GroupHandle _group, Handle _handle);
+
+	/// Send message larger than `maxMessageSize`. Data is copied and split
+	/// into fragments, which are sent in `Priority::Low` class one at a
+	/// time, so large transfer delays higher classes by at most one
+	/// fragment. Not available for raw connections.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _data Message data, first byte is message id.
+	/// @param _size Message size.
+	///
+	void sendLarge(Handle _handle, const void* _data, uint32_t _size);
+
+	/// Set largest message reassembled on receive. Fragments of large
+	/// messages up to `_maxSize` are reassembled and returned as single
+	/// message. Larger messages are returned by `bnet::recv` as stream of
+	/// `MessageId::Fragment` messages.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _maxSize Maximum reassembled message size. When `0` all
+	///   large messages are streamed.
+	///
+	void setReassembly(Handle _handle, uint32_t _maxSize);
+
+	/// Set idle timeout. Connection that doesn't receive any data for
+	/// `_ms` milliseconds is disconnected, and `MessageId::LostConnection`
+	/// is received with `DisconnectReason::Timeout`. Detects peers that
+	/// are gone without closing connection. Connections start with
+	/// `BNET_CONFIG_IDLE_TIMEOUT_MS` timeout.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _ms Timeout in milliseconds, rounded up to timer resolution
+	///   `BNET_CONFIG_TIMER_TICK_MS`. When `0` connection never times out.
+	///
+	void setIdleTimeout(Handle _handle, uint32_t _ms);
+
+	/// Set send queue watermarks. Once bytes queued on connection reach
+	/// `_high`, `MessageId::SendQueueFull` is received, and once they
+	/// drop to `_low` again, `MessageId::SendQueueDrained` is received.
+	/// Producers should stop sending to connection between the two, so
+	/// peer that doesn't read can't grow queue without bound. Connections
+	/// start with `BNET_CONFIG_SEND_LOW_WATERMARK` and
+	/// `BNET_CONFIG_SEND_HIGH_WATERMARK`.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _low Low watermark in bytes, must be below `_high`.
+	/// @param _high High watermark in bytes. When `0` no messages are
+	///   received.
+	///
+	void setSendWatermarks(Handle _handle, uint32_t _low, uint32_t _high);
+
+	/// Set send queue limit. Messages that would grow queue past limit
+	/// are dropped, or connection is closed, depending on `_policy`.
+	/// Fragments of large messages and notify markers are never dropped.
+	/// Connections start with `BNET_CONFIG_SEND_LIMIT` limit.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _size Limit in bytes. When `0` queue is unlimited.
+	/// @param _policy What happens to messages past limit.
+	///
+	void setSendLimit(Handle _handle, uint32_t _size, SendLimit::Enum _policy = SendLimit::Drop);
+
+	/// Returns bytes of messages queued on connection that are not handed
+	/// to socket yet. Messages sent from other threads, while context is
+	/// driven by I/O thread, are accounted once I/O thread picks them up.
+	///
+	/// @param _handle Handle to connection object.
+	///
+	uint32_t getSendQueueSize(Handle _handle);
+
+	/// Returns connection traffic statistics, or NULL for invalid handle.
+	/// Counters are cheap to keep, and are always enabled. Average
+	/// handshake time is `handshakeUs/handshakes`.
+	///
+	/// @param _handle Handle to connection object.
+	///
+	const TrafficStats* getStats(Handle _handle);
+
+	/// Returns traffic statistics summed over live connections, and
+	/// connections closed since `bnet::init`.
+	const TrafficStats* getGlobalStats();
+
+	/// Returns connection latency summary, or NULL for invalid handle,
+	/// and when library is built without `BNET_CONFIG_LATENCY_HISTOGRAM`.
+	/// Send latency of UDP message is measured until it's written to
+	/// datagram. Receive latency is recorded by thread calling
+	/// `bnet::recv`, and must be queried from same thread.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _latency Which latency is returned.
+	/// @param _reset Clear histogram once summary is taken.
+	///
+	const LatencyStats* getLatency(Handle _handle, Latency::Enum _latency, bool _reset = false);
+
+	/// Returns latency summary of all connections, including closed
+	/// ones. Global histograms are kept, and reset, separately from
+	/// connection histograms.
+	const LatencyStats* getGlobalLatency(Latency::Enum _latency, bool _reset = false);
+
+	/// Create timer. Timer is stopped until it's started with
+	/// `bnet::startTimer`.
+	///
+	/// @param _userData Returned with timer message.
+	///
+	/// @returns Timer handle, or `invalidTimerHandle` when all
+	///   `BNET_CONFIG_MAX_TIMERS` timers are in use.
+	///
+	TimerHandle createTimer(uint64_t _userData);
+
+	/// Destroy timer. Stale handle of destroyed timer is ignored by all
+	/// timer functions.
+	void destroyTimer(TimerHandle _timer);
+
+	/// Start timer. When timer expires, `MessageId::Timer` message is
+	/// received by `bnet::recv`, with invalid handle. Data of message is
+	/// message id, `TimerHandle` and user data passed to
+	/// `bnet::createTimer` as 64-bit integer, both in host byte order.
+	/// Messages of destroyed timers are not received.
+	/// Periodic timers are used for keepalives, and other periodic work
+	/// that needs to run on context thread.
+	///
+	/// @param _timer Timer handle.
+	/// @param _ms Time until timer expires in milliseconds, rounded up to
+	///   timer resolution `BNET_CONFIG_TIMER_TICK_MS`.
+	/// @param _periodMs Timer is restarted with this period after it
+	///   expires. When `0` timer expires once.
+	///
+	void startTimer(TimerHandle _timer, uint32_t _ms, uint32_t _periodMs = 0);
+
+	/// Stop timer. Timer message that was already received by
+	/// `bnet::recv` is not removed.
+	void stopTimer(TimerHandle _timer);
+
+	/// Set pre-shared compression dictionary. Small messages have little
+	/// repetition of their own, but compress well against sample data
+	/// both peers know. Both peers must set same data under same id,
+	/// dictionaries that don't match are not used. Dictionary must not
+	/// be changed while connections use it.
+	///
+	/// @param _id Dictionary id, from 1 to `BNET_CONFIG_MAX_DICTIONARIES`-1.
+	/// @param _data Dictionary data, it's copied.
+	/// @param _size Dictionary size, only last 64KB can be referenced.
+	///
+	void setDictionary(uint8_t _id, const void* _data, uint16_t _size);
+
+	/// Offer compression of messages sent on framed connection. Offer is
+	/// sent to peer, and messages are compressed once peer answers it can
+	/// decompress them, so peer doesn't have to enable anything. Offer is
+	/// usually made with `bnet::setDefaultCompression`, or right after
+	/// `bnet::connect`, or on `MessageId::IncomingConnection`. Ignored for
+	/// raw and UDP connections.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _codec Codec, `Codec::None` stops compression.
+	/// @param _dictionary Dictionary id set with `bnet::setDictionary`,
+	///   or 0 for none. Compression falls back to no dictionary if peer
+	///   doesn't have matching one.
+	/// @param _threshold Messages smaller than this are sent as is.
+	///   Messages that don't get smaller are always sent as is.
+	///
+	void setCompression(Handle _handle, Codec::Enum _codec, uint8_t _dictionary = 0, uint16_t _threshold = 64);
+
+	/// Set compression offered on every framed connection made by
+	/// `bnet::connect`, or accepted by listen socket, after this call.
+	/// Offer is sent with handshake, before any user message, and
+	/// `bnet::setCompression` overrides it per connection.
+	///
+	/// @param _codec Codec, `Codec::None` stops offering compression.
+	/// @param _dictionary Dictionary id set with `bnet::setDictionary`,
+	///   or 0 for none.
+	/// @param _threshold Messages smaller than this are sent as is.
+	///
+	void setDefaultCompression(Codec::Enum _codec, uint8_t _dictionary = 0, uint16_t _threshold = 64);
+
+	/// Returns connection compression statistics, or NULL for invalid
+	/// handle. Compression pays off when `compressUs` is worth bytes
+	/// saved, `sentRaw - sentCompressed`.
+	const CompressionStats* getCompressionStats(Handle _handle);
+
 	/// Process receive.
 	///
 	/// @returns Incomming message object. Must be released by calling `bnet::release`.
 	///
 	IncomingMessage* recv();
 
+	/// Process receive once, and return all messages that are ready, up
+	/// to `_max`.
+	///
+	/// @param _msgs Array receiving incoming messages. Each must be
+	///   released by calling `bnet::release` or `bnet::releaseBatch`.
+	/// @param _max Size of `_msgs` array.
+	///
+	/// @returns Number of messages returned.
+	///
+	uint32_t recv(IncomingMessage** _msgs, uint32_t _max);
+
 	/// Release incoming message.
 	///
 	/// @param Message returned by `bnet::recv` call.
 	///
 	void release(IncomingMessage* _msg);
 
-	/// Convert name to IP address.
+	/// Release incoming messages.
+	///
+	/// @param _msgs Messages returned by `bnet::recv` call.
+	/// @param _num Number of messages.
+	///
+	void releaseBatch(IncomingMessage** _msgs, uint32_t _num);
+
+	/// Enable zero-copy receive. Framed messages returned by `bnet::recv`
+	/// point directly into connection receive buffer, and connection
+	/// doesn't receive more data once buffer is full of messages that are
+	/// not released yet. Ignored for raw connections, and for connections
+	/// driven by io_uring engine.
+	///
+	/// @param _handle Handle to connection object.
+	/// @param _enable Enable zero-copy receive.
+	///
+	void setZeroCopy(Handle _handle, bool _enable = true);
+
+	/// Copy zero-copy message, so it can be kept after connection
+	/// receive buffer is reused. Original message is released.
+	///
+	/// @param Message returned by `bnet::recv` call.
+	///
+	/// @returns Message that must be released by calling `bnet::release`.
+	///   Messages that are not zero-copy views are returned as is.
+	///
+	IncomingMessage* detach(IncomingMessage* _msg);
+
+	/// Returns message pool statistics.
+	const PoolStats* getPoolStats();
+
+	/// Set maximum memory kept in message pool free lists.
+	///
+	/// @param _size Memory limit in bytes. When `0` released messages
+	///   are returned to allocator immediately.
+	///
+	void setPoolLimit(uint32_t _size);
+
+	/// Returns receive buffer statistics. Connections hold receive buffer
+	/// only while they have unconsumed data, buffer starts at
+	/// `BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE` and grows up to
+	/// `BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE`.
+	const RecvBufferStats* getRecvBufferStats();
+
+	/// Resolve host name without blocking. Result is returned by
+	/// `bnet::recv` as `MessageId::Resolved` message, with invalid handle.
+	/// Data of message is message id, first IPv4 address as 32-bit
+	/// integer, which is 0 if there is none, `_userData` as 64-bit
+	/// integer, both in host byte order, followed by number of addresses
+	/// as 8-bit integer, and `bnet::Address` array. Number of addresses
+	/// is 0 if host name is not resolved. Results are cached for their
+	/// TTL, so repeated lookups don't reach resolver.
+	///
+	/// @param _host Name or IPv4 string.
+	/// @param _userData Returned with result.
+	///
+	void resolve(const char* _host, uint64_t _userData = 0);
+
+	/// Set host name resolver, used instead of `getaddrinfo`, for example
+	/// to resolve names from local hosts table in tests. Cached results
+	/// are cleared.
+	///
+	/// @param _fn Resolver, or NULL for default.
+	/// @param _userData User data passed to resolver.
+	///
+	void setResolver(ResolveFn _fn, void* _userData = NULL);
+
+	/// Returns IPv4 address.
+	///
+	/// @param _ip IPv4 address.
+	///
+	Address toAddress(uint32_t _ip);
+
+	/// Parse IPv4 or IPv6 address string.
+	///
+	/// @param _str Numeric address.
+	/// @param _addr Receives address.
+	///
+	/// @returns False if string is not numeric address.
+	///
+	bool toAddress(const char* _str, Address& _addr);
+
+	/// Convert name to IPv6 and IPv4 addresses. Blocks until name is
+	/// resolved, see `bnet::resolve`.
+	///
+	/// @param _name Name, or numeric address.
+	/// @param _addrs Receives addresses, families are interleaved.
+	/// @param _max Size of `_addrs` array.
+	///
+	/// @returns Number of addresses.
+	///
+	uint32_t toAddresses(const char* _name, Address* _addrs, uint32_t _max);
+
+	/// Convert name to IP address. Blocks until name is resolved, see
+	/// `bnet::resolve`.
 	///
 	/// @param _addr Name or IPv4 string.
 	///
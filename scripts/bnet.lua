@@ -29,6 +29,12 @@ project "bnet"
 
 	configuration {}
 
+	if _OPTIONS["with-io-uring"] then
+		defines {
+			"BNET_CONFIG_IO_URING=1",
+		}
+	end
+
 	files {
 		path.join(BNET_DIR, "include/**.h"),
 		path.join(BNET_DIR, "src/**.cpp"),
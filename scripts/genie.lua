@@ -8,6 +8,11 @@ newoption {
 	description = "Enable OpenSSL integration.",
 }
 
+newoption {
+	trigger = "with-io-uring",
+	description = "Enable io_uring I/O engine (Linux only).",
+}
+
 solution "bnet"
 	configurations {
 		"Debug",
@@ -129,7 +134,42 @@ function exampleProject(_name, _uuid)
 	strip()
 end
 
+function testProject(_name, _uuid)
+
+	project ("test-" .. _name)
+		uuid (_uuid)
+		kind "ConsoleApp"
+
+	configuration {}
+
+	includedirs {
+		path.join(BX_DIR, "include"),
+		path.join(BNET_DIR, "include"),
+		path.join(BNET_DIR, "src"),
+	}
+
+	files {
+		path.join(BNET_DIR, "tests", _name .. ".cpp"),
+		path.join(BNET_DIR, "tests/test.h"),
+	}
+
+	links {
+		"bnet",
+	}
+
+	configuration { "vs* or mingw*" }
+		links {
+			"ws2_32",
+		}
+
+	configuration {}
+
+	strip()
+end
+
 dofile "bnet.lua"
 dofile "example-common.lua"
 exampleProject("00-chat", "1544c710-ad76-11e0-9f1c-0800200c9a66")
 exampleProject("01-http", "35161d20-ab2b-11e0-9f1c-0800200c9a66")
+testProject("lz4", "6d429c55-7e8a-4320-a8fc-bf60990463e5")
+testProject("udp", "79cc689e-f03d-4333-9e98-b4f3078082a7")
@@ -80,6 +80,23 @@ namespace bnet
 #endif // BX_PLATFORM_
 	}
 
+#if BNET_CONFIG_IO_URING
+	struct UringTag
+	{
+		enum Enum
+		{
+			None,
+			Send,
+			Recv,
+			Accept,
+
+			Mask = 7
+		};
+	};
+
+	void ctxUringCancel(Context* _ctx, Handle _handle, SOCKET _socket, uint32_t _numOrphans);
+#endif // BNET_CONFIG_IO_URING
+
 	static void setSockOpts(SOCKET _socket)
 	{
 		int result;
@@ -93,56 +110,333 @@ namespace bnet
 		BX_UNUSED(result);
 	}
 
+	static uint64_t msToTicks(uint32_t _ms)
+	{
+		return uint64_t(bx::getHPFrequency() )*_ms/1000;
+	}
+
+	/// Returns 1 when nonblocking connect completed, 0 while it's in
+	/// progress, and -1 when it failed.
+	static int32_t getConnectStatus(SOCKET _socket)
+	{
+		if (!issocketready(_socket) )
+		{
+			return 0;
+		}
+
+		int err = 0;
+		socklen_t len = sizeof(err);
+		if (0 != ::getsockopt(_socket, SOL_SOCKET, SO_ERROR, (char*)&err, &len)
+		||  0 != err)
+		{
+			return -1;
+		}
+
+		return 1;
+	}
+
+	/// Addresses raced by connection. Connect to next address is started
+	/// after stagger delay, or as soon as all started connects failed.
+	struct ConnectRace
+	{
+		Address addrs[BNET_CONFIG_MAX_ADDRESSES];
+		SOCKET sockets[BNET_CONFIG_MAX_ADDRESSES];
+		uint64_t nextStart;
+		uint16_t port;
+		uint8_t num;
+		uint8_t started;
+		uint8_t watched; // Socket added to poller by Context::watch.
+		bool secure;
+	};
+
+	/// Zero-copy receive bookkeeping, stored after view Message.
+	struct RecvView
+	{
+		Message* next;
+		uint32_t start; // Ring position of view data.
+		bool released;
+	};
+
+	/// Broadcast payload referenced by shared Message, stored after it.
+	static Message*& getPayload(Message* _msg)
+	{
+		return *(Message**)(_msg + 1);
+	}
+
+	static void writeUint16(uint8_t* _dst, uint16_t _value)
+	{
+		_value = bx::toLittleEndian(_value);
+		memcpy(_dst, &_value, sizeof(_value) );
+	}
+
+	static uint16_t readUint16(const uint8_t* _src)
+	{
+		uint16_t value;
+		memcpy(&value, _src, sizeof(value) );
+		return bx::toHostEndian(value, true);
+	}
+
+	/// Compression of framed connection. Statistics are kept in timer
+	/// ticks, and converted when they are read.
+	struct CompressionState
+	{
+		uint64_t sentRaw;
+		uint64_t sentCompressed;
+		uint64_t recvCompressed;
+		uint64_t recvRaw;
+		uint64_t compressTicks;
+		uint64_t decompressTicks;
+		uint16_t threshold;
+		uint8_t codec;           // Codec of sent messages, once peer answered.
+		uint8_t dictionary;
+		uint8_t offerCodec;      // Codec offered to peer.
+		uint8_t offerDictionary;
+	};
+
+	static void setPriority(Message* _msg, Priority::Enum _priority)
+	{
+		MessageHeader* header = getHeader(_msg);
+		header->flags &= ~MessageFlags::Priority;
+		header->flags |= uint8_t( (_priority+1) << MessageFlags::PriorityShift);
+	}
+
+	/// Returns send priority class of outgoing message. Internal frames
+	/// are sent before user messages, large message fragments and
+	/// disconnect marker are sent as low priority.
+	static Priority::Enum getPriority(Message* _msg)
+	{
+		const uint8_t flags = getHeader(_msg)->flags;
+		if (0 != (flags & MessageFlags::Control) )
+		{
+			return Priority::High;
+		}
+
+		if (0 != (flags & MessageFlags::Stream)
+		||  Internal::Disconnect == getMarker(_msg) )
+		{
+			return Priority::Low;
+		}
+
+		const uint32_t priority = (flags & MessageFlags::Priority) >> MessageFlags::PriorityShift;
+		return 0 == priority ? Priority::Normal : Priority::Enum(priority-1);
+	}
+
+#if BNET_CONFIG_UDP
+	static Channel::Enum getChannel(Message* _msg)
+	{
+		return Channel::Enum( (getHeader(_msg)->flags & MessageFlags::Channel) >> MessageFlags::ChannelShift);
+	}
+
+	/// Protocol id sent with connect datagram, so stray datagrams don't
+	/// create connections.
+	static const uint32_t UdpMagic = BX_MAKEFOURCC('b', 'n', 'e', 't');
+
+	/// Creates UDP socket connected to _remote. Socket of accepted
+	/// connection is bound to listen address with SO_REUSEPORT, and
+	/// kernel routes peer's datagrams to it instead of listen socket.
+	static SOCKET createUdpSocket(const sockaddr_in* _local, const sockaddr_in& _remote)
+	{
+		SOCKET sock = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (INVALID_SOCKET == sock)
+		{
+			return sock;
+		}
+
+		int reuse = 1;
+		if ( (NULL != _local
+		&&    (SOCKET_ERROR == ::setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (char*)&reuse, sizeof(reuse) )
+		||     SOCKET_ERROR == ::bind(sock, (const sockaddr*)_local, sizeof(sockaddr_in) ) ) )
+		||  SOCKET_ERROR == ::connect(sock, (const sockaddr*)&_remote, sizeof(_remote) ) )
+		{
+			::closesocket(sock);
+			return INVALID_SOCKET;
+		}
+
+		setNonBlock(sock);
+		return sock;
+	}
+
+	/// Secret for UDP connect cookies. Falls back to timer when random
+	/// device is not available, which only makes cookies guessable.
+	static void initUdpSecret(uint64_t _secret[2])
+	{
+		int fd = ::open("/dev/urandom", O_RDONLY);
+		const bool ok = 0 <= fd
+			&& ssize_t(2*sizeof(uint64_t) ) == ::read(fd, _secret, 2*sizeof(uint64_t) )
+			;
+
+		if (0 <= fd)
+		{
+			::close(fd);
+		}
+
+		if (!ok)
+		{
+			BX_TRACE("Random device is not available.");
+			_secret[0] = uint64_t(bx::getHPCounter() );
+			_secret[1] = uint64_t(uintptr_t(_secret) ) ^ _secret[0]*UINT64_C(0x9e3779b97f4a7c15);
+		}
+	}
+
+	/// Reliable message kept until acknowledged.
+	struct UdpSent
+	{
+		Message* msg;
+		uint64_t time; // Last time message was sent.
+	};
+
+	/// State of UDP connection, allocated only for UDP connections.
+	struct UdpState
+	{
+		UdpState()
+			: resendTime(UINT64_MAX)
+			, lastRecv(bx::getHPCounter() )
+			, lastSend(0)
+			, cookie(0)
+			, listenHandle(invalidHandle)
+			, ip(0)
+			, port(0)
+			, sendSeq(0)
+			, sendBase(0)
+			, sendSequenced(0)
+			, recvSeq(0)
+			, recvSequenced(UINT16_MAX)
+			, recvNewest(0)
+			, acceptPending(false)
+			, ackPending(false)
+			, finish(false)
+		{
+			memset(sent, 0, sizeof(sent) );
+			memset(received, 0, sizeof(received) );
+		}
+
+		UdpSent sent[BNET_CONFIG_UDP_WINDOW];
+		Message* received[BNET_CONFIG_UDP_WINDOW]; // Reliable messages received ahead of order.
+		MessageQueue waiting; // Reliable messages and markers waiting for space in send window.
+		uint64_t resendTime;
+		uint64_t lastRecv;
+		uint64_t lastSend;
+		uint64_t cookie;     // Sent by host in challenge, echoed with connect.
+		Handle listenHandle; // Listen socket of accepted connection.
+		uint32_t ip;
+		uint16_t port;
+		uint16_t sendSeq;       // Next reliable message.
+		uint16_t sendBase;      // Oldest reliable message not acknowledged yet.
+		uint16_t sendSequenced; // Next sequenced message.
+		uint16_t recvSeq;       // Next reliable message delivered in order.
+		uint16_t recvSequenced; // Newest sequenced message delivered.
+		uint16_t recvNewest;    // Newest reliable message received.
+		bool acceptPending;
+		bool ackPending;
+		bool finish;
+	};
+#endif // BNET_CONFIG_UDP
+
 	class Connection
 	{
 	public:
-		Connection()
-			: m_socket(INVALID_SOCKET)
+		Connection(Context* _ctx)
+			: m_ctx(_ctx)
+			, m_idleTicks(0)
+			, m_lastRecv(0)
+			, m_socket(INVALID_SOCKET)
 			, m_handle(invalidHandle)
-			, m_incomingBuffer( (uint8_t*)BX_ALLOC(g_allocator, BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE) )
-			, m_incoming(BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE)
-			, m_recv(m_incoming, (char*)m_incomingBuffer)
+			, m_incomingBuffer(NULL)
+			, m_incoming(BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE)
+			, m_recv(m_incoming, NULL)
 #if BNET_CONFIG_OPENSSL
 			, m_ssl(NULL)
 #endif // BNET_CONFIG_OPENSSL
+			, m_viewHead(NULL)
+			, m_viewTail(NULL)
+			, m_assembly(NULL)
+			, m_assemblyOffset(0)
+			, m_assemblyMax(0)
+			, m_incomingSize(BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE)
+			, m_incomingPeak(0)
+			, m_parse(0)
 			, m_len(-1)
 			, m_raw(false)
+			, m_zeroCopy(false)
+			, m_viewSlack(false)
+			, m_destroyPending(false)
 			, m_tcpHandshake(true)
 			, m_sslHandshake(false)
+			, m_recvPending(false)
+			, m_sendPending(false)
+			, m_sendOffset(0)
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			, m_sendLatency(NULL)
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+			, m_race(NULL)
+#if BNET_CONFIG_IO_URING
+			, m_uring(false)
+			, m_sendFailed(false)
+			, m_numInflight(0)
+			, m_uringStash(NULL)
+			, m_uringStashSize(0)
+#endif // BNET_CONFIG_IO_URING
+#if BNET_CONFIG_UDP
+			, m_udp(NULL)
+#endif // BNET_CONFIG_UDP
 		{
-			BX_TRACE("ctor %d", m_handle);
+			BX_TRACE("ctor %d", m_handle.idx);
+			memset(m_skipped, 0, sizeof(m_skipped) );
 		}
 
 		~Connection()
 		{
-			BX_TRACE("dtor %d", m_handle);
-			BX_FREE(g_allocator, m_incomingBuffer);
-		}
+			BX_TRACE("dtor %d", m_handle.idx);
+			resizeIncoming(0);
+			finishRace(m_socket);
+			stopTimers();
 
-		void connect(Handle _handle, uint32_t _ip, uint16_t _port, bool _raw, SSL_CTX* _sslCtx)
-		{
-			init(_handle, _raw);
+#if BNET_CONFIG_UDP
+			if (NULL != m_udp)
+			{
+				BX_DELETE(ctxAllocator(m_ctx), m_udp);
+			}
+#endif // BNET_CONFIG_UDP
 
-			m_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-			if (INVALID_SOCKET == m_socket)
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			if (NULL != m_sendLatency)
 			{
-				ctxPush(m_handle, MessageId::ConnectFailed);
-				return;
+				BX_DELETE(ctxAllocator(m_ctx), m_sendLatency);
 			}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
 
-			setSockOpts(m_socket);
-			setNonBlock(m_socket);
+#if BNET_CONFIG_IO_URING
+			BX_FREE(ctxAllocator(m_ctx), m_uringStash);
+#endif // BNET_CONFIG_IO_URING
+		}
+
+		void connect(Handle _handle, const Address* _addrs, uint32_t _num, uint16_t _port, bool _raw, SSL_CTX* _sslCtx)
+		{
+			init(_handle, _raw);
 
 			const bool ssl = _sslCtx != NULL;
-			int err = connectsocket(m_socket, _ip, _port, ssl);
 
-			if (0 != err
-			&&  !(isInProgress() || isWouldBlock() ) )
+			if (1 < _num)
 			{
-				::closesocket(m_socket);
-				m_socket = INVALID_SOCKET;
+				m_race = BX_NEW(ctxAllocator(m_ctx), ConnectRace);
+				m_race->num = uint8_t(_num < BNET_CONFIG_MAX_ADDRESSES ? _num : BNET_CONFIG_MAX_ADDRESSES);
+				m_race->started = 0;
+				m_race->port = _port;
+				m_race->secure = ssl;
+				memcpy(m_race->addrs, _addrs, m_race->num*sizeof(Address) );
+
+				m_socket = startRace(bx::getHPCounter() );
+				m_race->watched = m_race->started-1;
+			}
+			else if (1 == _num)
+			{
+				m_socket = connectAddress(_addrs[0], _port, ssl);
+			}
 
-				ctxPush(m_handle, MessageId::ConnectFailed);
+			if (INVALID_SOCKET == m_socket)
+			{
+				finishRace(INVALID_SOCKET);
+				connectFailed(ConnectFailure::Error);
 				return;
 			}
 
@@ -165,12 +459,8 @@ namespace bnet
 			init(_handle, _raw);
 
 			m_socket = _socket;
-			Message* msg = msgAlloc(m_handle, 9, true);
-			msg->data[0] = MessageId::IncomingConnection;
-			*( (uint16_t*)&msg->data[1]) = _listenHandle.idx;
-			*( (uint32_t*)&msg->data[3]) = _ip;
-			*( (uint16_t*)&msg->data[7]) = _port;
-			ctxPush(msg);
+			m_stats.accepted = 1;
+			pushIncoming(_listenHandle, _ip, _port);
 
 #if BNET_CONFIG_OPENSSL
 			if (NULL != _sslCtx)
@@ -192,8 +482,92 @@ namespace bnet
 #endif // BNET_CONFIG_OPENSSL
 		}
 
+		void connectUdp(Handle _handle, uint32_t _ip, uint16_t _port)
+		{
+			init(_handle, false);
+
+#if BNET_CONFIG_UDP
+			sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr) );
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(_ip);
+			addr.sin_port = htons(_port);
+
+			m_socket = createUdpSocket(NULL, addr);
+			if (INVALID_SOCKET != m_socket)
+			{
+				// Handshake lasts until host accepts connection.
+				initUdp(invalidHandle, _ip, _port);
+				return;
+			}
+#else
+			BX_UNUSED(_ip);
+			BX_UNUSED(_port);
+			BX_TRACE("BNET_CONFIG_UDP is not enabled.");
+#endif // BNET_CONFIG_UDP
+
+			connectFailed(ConnectFailure::Error);
+		}
+
+#if BNET_CONFIG_UDP
+		void acceptUdp(Handle _handle, Handle _listenHandle, SOCKET _socket, uint32_t _ip, uint16_t _port)
+		{
+			init(_handle, false);
+
+			m_socket = _socket;
+			m_stats.accepted = 1;
+			pushIncoming(_listenHandle, _ip, _port);
+
+			initUdp(_listenHandle, _ip, _port);
+			m_tcpHandshake = false;
+			m_udp->acceptPending = true;
+		}
+
+		/// Returns true if connection was accepted from peer by listen
+		/// socket.
+		bool isUdpPeer(Handle _listenHandle, uint32_t _ip, uint16_t _port) const
+		{
+			return NULL != m_udp
+				&& INVALID_SOCKET != m_socket
+				&& m_udp->listenHandle.idx == _listenHandle.idx
+				&& m_udp->listenHandle.gen == _listenHandle.gen
+				&& m_udp->ip   == _ip
+				&& m_udp->port == _port
+				;
+		}
+
+		/// Returns false if connection wasn't accepted by UDP listen
+		/// socket.
+		bool getUdpPeerKey(uint64_t& _key) const
+		{
+			if (NULL == m_udp
+			||  !isValid(m_udp->listenHandle) )
+			{
+				return false;
+			}
+
+			_key = UdpPeers::makeKey(m_udp->listenHandle.idx, m_udp->ip, m_udp->port);
+			return true;
+		}
+#endif // BNET_CONFIG_UDP
+
 		void disconnect(DisconnectReason::Enum _reason = DisconnectReason::None)
 		{
+			if (INVALID_SOCKET != m_socket)
+			{
+				if (0 != m_stats.handshakes)
+				{
+					++m_stats.disconnects[_reason];
+				}
+				else if (DisconnectReason::None != _reason)
+				{
+					++m_stats.connectFailures[ConnectFailure::Handshake];
+				}
+			}
+
+			finishRace(m_socket);
+			stopTimers();
+
 #if BNET_CONFIG_OPENSSL
 			if (m_ssl)
 			{
@@ -203,6 +577,32 @@ namespace bnet
 			}
 #endif // BNET_CONFIG_OPENSSL
 
+#if BNET_CONFIG_IO_URING
+			// Messages referenced by in-flight sends are released when their
+			// completions arrive.
+			uint32_t numOrphans = 0;
+			for (Message* msg = m_inflight.pop(); NULL != msg; msg = m_inflight.pop() )
+			{
+				msg->handle = invalidHandle;
+				++numOrphans;
+			}
+			m_numInflight = 0;
+			m_sendFailed  = false;
+
+			if (m_uring
+			&&  INVALID_SOCKET != m_socket)
+			{
+				ctxUringCancel(m_ctx, m_handle, m_socket, numOrphans);
+			}
+#endif // BNET_CONFIG_IO_URING
+
+#if BNET_CONFIG_UDP
+			if (NULL != m_udp)
+			{
+				disconnectUdp();
+			}
+#endif // BNET_CONFIG_UDP
+
 			if (INVALID_SOCKET != m_socket)
 			{
 				::closesocket(m_socket);
@@ -214,978 +614,6402 @@ namespace bnet
 				release(msg);
 			}
 
+			for (uint32_t ii = 0; ii < Priority::Count; ++ii)
+			{
+				for (Message* msg = m_queued[ii].pop(); NULL != msg; msg = m_queued[ii].pop() )
+				{
+					release(msg);
+				}
+
+				m_skipped[ii] = 0;
+			}
+
+			m_sendQueued = 0;
+			m_sendQueuedNum = 0;
+			m_sendFull   = false;
+
+			if (NULL != m_assembly)
+			{
+				release(m_assembly);
+				m_assembly = NULL;
+			}
+
+			m_sendOffset  = 0;
+			m_sendPending = false;
+
 			if (_reason != DisconnectReason::None)
 			{
-				Message* msg = msgAlloc(m_handle, 2, true);
+				Message* msg = msgAlloc(m_ctx, m_handle, 2, true);
 				msg->data[0] = MessageId::LostConnection;
 				msg->data[1] = _reason;
-				ctxPush(msg);
+				ctxPush(m_ctx, msg);
 			}
+
+			if (m_destroyPending)
+			{
+				ctxDestroy(m_ctx, m_handle);
+			}
+		}
+
+		/// Tells user connection couldn't be established, and closes it.
+		void connectFailed(ConnectFailure::Enum _failure)
+		{
+			++m_stats.connectFailures[_failure];
+			ctxPush(m_ctx, m_handle, MessageId::ConnectFailed);
+			disconnect();
 		}
 
 		void send(Message* _msg)
 		{
-			BX_CHECK(m_raw || _msg->data[0] >= MessageId::UserDefined, "Sending message with MessageId below UserDefined is not allowed!");
-			if (INVALID_SOCKET != m_socket)
+			if (queue(_msg) )
 			{
-				m_outgoing.push(_msg);
 				update();
 			}
 		}
 
-		void update()
+		/// Queues message without sending it. Returns true if connection
+		/// must be updated to send it.
+		bool queue(Message* _msg)
 		{
+			const bool large = 0 != (getHeader(_msg)->flags & MessageFlags::Stream);
+			BX_CHECK(large
+				|| m_raw
+				|| 0 != (getHeader(_msg)->flags & MessageFlags::Control)
+				|| _msg->data[0] >= MessageId::UserDefined
+				, "Sending message with MessageId below UserDefined is not allowed!"
+				);
+			if (large
+			&&  (m_raw || isUdp() ) )
+			{
+				BX_TRACE("Large messages are not available for raw and UDP connections.");
+				release(_msg);
+				return false;
+			}
+
 			if (INVALID_SOCKET != m_socket)
 			{
-				updateSocket();
+				const Priority::Enum priority = getPriority(_msg);
 
-				if (!m_tcpHandshake
-				&&  !m_sslHandshake)
+				// Compressed user messages are sent as control frames, so
+				// it's decided before compression if message can be dropped.
+				const bool droppable = isDroppable(_msg);
+
+				if (Codec::None != m_compression.codec)
 				{
-					updateIncomingMessages();
+					_msg = compress(_msg);
+				}
+
+				if (!enqueue(_msg, droppable) )
+				{
+					return false;
+				}
+
+				if (isUdp() )
+				{
+					m_outgoing.push(_msg);
+				}
+				else
+				{
+					m_queued[priority].push(_msg);
+				}
+
+#if BNET_CONFIG_IO_URING
+				if (m_uring)
+				{
+					// Sent by io_uring engine on next Context::recv.
+					return false;
 				}
+#endif // BNET_CONFIG_IO_URING
+
+				// When socket send buffer is full, frame is resumed once
+				// socket becomes writable.
+				return !m_sendPending;
 			}
+
+			release(_msg);
+			return false;
 		}
 
-		bool hasSocket() const
+		/// Fragments of large message and internal frames are never
+		/// dropped, stream would be corrupted otherwise.
+		static bool isDroppable(Message* _msg)
 		{
-			return INVALID_SOCKET != m_socket;
+			const uint8_t flags = getHeader(_msg)->flags;
+			return Internal::None == getMarker(_msg) && 0 == (flags & (MessageFlags::Stream|MessageFlags::Control) );
 		}
 
-	private:
-		void init(Handle _handle, bool _raw)
+		/// Accounts message entering send queue. Returns false if message
+		/// was dropped, or connection was closed, because send limit was
+		/// reached.
+		bool enqueue(Message* _msg, bool _droppable)
 		{
-			m_handle = _handle;
-			m_tcpHandshake = true;
-			m_sslHandshake = false;
-			m_tcpHandshakeTimeout = bx::getHPCounter() + bx::getHPFrequency()*BNET_CONFIG_CONNECT_TIMEOUT_SECONDS;
-			m_len = -1;
-			m_raw = _raw;
+			if (0 != m_sendLimit
+			&&  m_sendLimit < m_sendQueued + _msg->size)
+			{
+				if (SendLimit::Disconnect == m_sendPolicy)
+				{
+					BX_TRACE("Disconnect %d - Send queue limit reached.", m_handle.idx);
+					release(_msg);
+					disconnect(DisconnectReason::SendQueueLimit);
+					return false;
+				}
+
+				if (_droppable)
+				{
+					BX_TRACE("Message dropped %d - Send queue limit reached.", m_handle.idx);
+					release(_msg);
+					return false;
+				}
+			}
+
+			m_sendQueued += _msg->size;
+			++m_sendQueuedNum;
 
-			BX_TRACE("init %d", m_handle);
+			if (!m_sendFull
+			&&  0 != m_sendHigh
+			&&  m_sendHigh <= m_sendQueued)
+			{
+				m_sendFull = true;
+				ctxPush(m_ctx, m_handle, MessageId::SendQueueFull);
+			}
+
+			return true;
 		}
 
-		void read(bx::WriteRingBuffer& _out, uint32_t _len)
+		/// Accounts message leaving send queue, once it's handed to socket.
+		/// Clock is read once per send call, _now is 0 until it's read.
+		void dequeue(Message* _msg, int64_t& _now)
 		{
-			bx::ReadRingBuffer incoming(m_incoming, (char*)m_incomingBuffer, _len);
-			_out.write(incoming, _len);
-			incoming.end();
+			m_sendQueued -= _msg->size;
+			--m_sendQueuedNum;
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+#	if BNET_CONFIG_IO_URING
+			// io_uring sends are measured once they complete.
+			if (!m_uring)
+#	endif // BNET_CONFIG_IO_URING
+			{
+				recordSend(_msg, _now);
+			}
+#else
+			BX_UNUSED(_now);
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+			if (m_sendFull
+			&&  m_sendLow >= m_sendQueued)
+			{
+				m_sendFull = false;
+				ctxPush(m_ctx, m_handle, MessageId::SendQueueDrained);
+			}
 		}
 
-		void read(uint32_t _len)
+		Message* popOutgoing(int64_t& _now)
 		{
-			m_incoming.consume(_len);
+			Message* msg = m_outgoing.pop();
+			dequeue(msg, _now);
+			return msg;
 		}
 
-		void read(char* _data, uint32_t _len)
+		void setSendWatermarks(uint32_t _low, uint32_t _high)
 		{
-			bx::ReadRingBuffer incoming(m_incoming, (char*)m_incomingBuffer, _len);
-			incoming.read(_data, _len);
-			incoming.end();
+			m_sendLow  = _low;
+			m_sendHigh = _high;
 		}
 
-		void peek(char* _data, uint32_t _len)
+		void setSendLimit(uint32_t _size, SendLimit::Enum _policy)
 		{
-			bx::ReadRingBuffer incoming(m_incoming, (char*)m_incomingBuffer, _len);
-			incoming.read(_data, _len);
+			m_sendLimit  = _size;
+			m_sendPolicy = uint8_t(_policy);
 		}
 
-		void updateIncomingMessages()
+		uint32_t getSendQueueSize() const
 		{
-			if (m_raw)
+			return m_sendQueued;
+		}
+
+		const TrafficStats& getStats() const
+		{
+			return m_stats;
+		}
+
+		/// Returns counters with current queue and receive buffer state.
+		void getStats(TrafficStats& _stats) const
+		{
+			_stats = m_stats;
+			_stats.connections       = hasSocket() ? 1 : 0;
+			_stats.sendQueueMessages = m_sendQueuedNum;
+			_stats.sendQueueBytes    = m_sendQueued;
+			_stats.recvBufferUsed    = m_incoming.available();
+			_stats.recvBufferSize    = NULL != m_incomingBuffer ? m_incoming.m_size : 0;
+		}
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		/// Returns NULL until first message is measured.
+		Histogram* getSendLatency()
+		{
+			return m_sendLatency;
+		}
+
+		/// Messages are stamped when they're sent by user, markers and
+		/// internal frames are not measured.
+		void recordSend(Message* _msg, int64_t& _now)
+		{
+			const int64_t time = getHeader(_msg)->time;
+			if (0 != time)
 			{
-				uint32_t available = bx::uint32_min(m_incoming.available(), maxMessageSize-1);
+				_now = 0 != _now ? _now : bx::getHPCounter();
 
-				if (0 < available)
+				if (NULL == m_sendLatency)
 				{
-					Message* msg = msgAlloc(m_handle, available+1, true);
-					msg->data[0] = MessageId::RawData;
-					read( (char*)&msg->data[1], available);
-					ctxPush(msg);
+					m_sendLatency = BX_NEW(ctxAllocator(m_ctx), Histogram);
 				}
+
+				const uint64_t latency = uint64_t(_now - time);
+				m_sendLatency->record(latency);
+				ctxLatency(m_ctx, Latency::Send).record(latency);
 			}
-			else
+		}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+		void update()
+		{
+			if (INVALID_SOCKET != m_socket)
 			{
-				uint32_t available = bx::uint32_min(m_incoming.available(), maxMessageSize);
+#if BNET_CONFIG_UDP
+				if (NULL != m_udp)
+				{
+					updateUdp();
+					return;
+				}
+#endif // BNET_CONFIG_UDP
 
-				while (0 < available)
+				updateSocket();
+
+				if (!m_tcpHandshake
+				&&  !m_sslHandshake)
 				{
-					if (-1 == m_len)
-					{
-						if (2 > available)
-						{
-							return;
-						}
-						else
-						{
-							uint16_t len;
-							read((char*)&len, 2);
-							m_len = bx::toHostEndian(len, true);
-						}
-					}
-					else
-					{
-						if (m_len > int(available) )
-						{
-							return;
-						}
-						else
-						{
-							Message* msg = msgAlloc(m_handle, m_len, true);
-							read( (char*)msg->data, m_len);
-							uint8_t id = msg->data[0];
+					updateIncomingMessages();
+				}
+			}
 
-							if (id < MessageId::UserDefined)
-							{
-								msgRelease(msg);
+			releaseIncoming();
+		}
 
-								BX_TRACE("Disconnect %d - Invalid message id.", m_handle);
-								disconnect(DisconnectReason::InvalidMessageId);
-								return;
-							}
+		bool hasSocket() const
+		{
+			return INVALID_SOCKET != m_socket;
+		}
 
-							ctxPush(msg);
+		SOCKET getSocket() const
+		{
+			return m_socket;
+		}
 
-							m_len = -1;
-						}
-					}
+		/// Framed messages are returned as views into receive buffer. Not
+		/// available for raw and io_uring connections, since they can't
+		/// leave data in socket when receive buffer is full.
+		void setZeroCopy(bool _enable)
+		{
+			if (m_raw
+			||  isUdp() )
+			{
+				return;
+			}
 
-					available = bx::uint32_min(m_incoming.available(), maxMessageSize);
-				}
+#if BNET_CONFIG_IO_URING
+			if (m_uring)
+			{
+				return;
+			}
+#endif // BNET_CONFIG_IO_URING
+
+			m_zeroCopy = _enable;
+
+			if (_enable
+			&&  NULL != m_incomingBuffer
+			&&  !m_viewSlack)
+			{
+				// Slack after ring keeps views contiguous across wrap.
+				resizeIncoming(BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE);
 			}
 		}
 
-		void updateSocket()
+		void releaseView(Message* _msg)
 		{
-			if (updateTcpHandshake()
-			&&  updateSslHandshake() )
+			getView(_msg)->released = true;
+			consume();
+			releaseIncoming();
+		}
+
+		void setReassembly(uint32_t _maxSize)
+		{
+			m_assemblyMax = _maxSize;
+		}
+
+		void setIdleTimeout(uint32_t _ms)
+		{
+			TimerWheel& timers = ctxTimers(m_ctx);
+			m_idleTicks = timers.msToTicks(_ms);
+
+			if (0 == m_idleTicks)
 			{
-				int bytes;
+				timers.remove(&m_idleTimer);
+				return;
+			}
 
-#if BNET_CONFIG_OPENSSL
-				if (NULL != m_ssl)
-				{
-					bytes = m_recv.recv(m_ssl);
-				}
-				else
-#endif // BNET_CONFIG_OPENSSL
+			timers.add(&m_idleTimer, _ms);
+			m_lastRecv = timers.getTick();
+		}
+
+		/// Called by context when connection timer expires.
+		void timeout(TimerKind::Enum _kind)
+		{
+			switch (_kind)
+			{
+			case TimerKind::Connect:
+				// Timer isn't stopped when handshake is done, it's just
+				// ignored.
+				if (m_tcpHandshake)
 				{
-					bytes = m_recv.recv(m_socket);
+					BX_TRACE("Disconnect %d - Connect timeout.", m_handle.idx);
+					connectFailed(ConnectFailure::Timeout);
 				}
+				break;
 
-				if (1 > bytes)
+			case TimerKind::Idle:
 				{
-					if (0 == bytes)
+					// Receive only records time, timer is moved once it
+					// expires.
+					TimerWheel& timers = ctxTimers(m_ctx);
+					const uint64_t expires = m_lastRecv + m_idleTicks;
+					if (expires > timers.getTick() )
 					{
-						BX_TRACE("Disconnect %d - Host closed connection.", m_handle);
-						disconnect(DisconnectReason::HostClosed);
-						return;
+						timers.addAt(&m_idleTimer, expires);
 					}
-					else if (!isWouldBlock() )
+					else
 					{
-						TRACE_SSL_ERROR();
-						BX_TRACE("Disconnect %d - Receive failed. %d", m_handle, getLastError() );
-						disconnect(DisconnectReason::RecvFailed);
-						return;
+						BX_TRACE("Disconnect %d - Idle timeout.", m_handle.idx);
+						disconnect(DisconnectReason::Timeout);
 					}
 				}
+				break;
 
-				if (!m_sslHandshake)
+#if BNET_CONFIG_UDP
+			case TimerKind::Udp:
+				if (INVALID_SOCKET != m_socket)
 				{
-					if (m_raw)
-					{
-						for (Message* msg = m_outgoing.peek(); NULL != msg; msg = m_outgoing.peek() )
-						{
-							Internal::Enum id = Internal::Enum(*(msg->data - 2) );
-							if (Internal::None != id)
-							{
-								if (!processInternal(id, msg) )
-								{
-									return;
-								}
-							}
-							else if (!send( (char*)msg->data, msg->size) )
-							{
-								return;
-							}
-
-							release(m_outgoing.pop() );
-						}
-					}
-					else
-					{
-						for (Message* msg = m_outgoing.peek(); NULL != msg; msg = m_outgoing.peek() )
-						{
-							Internal::Enum id = Internal::Enum(*(msg->data - 2) );
-							if (Internal::None != id)
-							{
-								*( (uint16_t*)msg->data - 1) = msg->size;
-								if (!processInternal(id, msg) )
-								{
-									return;
-								}
-							}
-							else
-							{
-								*( (uint16_t*)msg->data - 1) = bx::toLittleEndian(msg->size);
-								if (!send( (char*)msg->data - 2, msg->size+2) )
-								{
-									return;
-								}
-							}
-
-							release(m_outgoing.pop() );
-						}
-					}
+					tickUdp(bx::getHPCounter() );
 				}
+				break;
+#endif // BNET_CONFIG_UDP
+
+			default:
+				break;
 			}
 		}
 
-		bool processInternal(Internal::Enum _id, Message* _msg)
+		/// Offers compression to peer. Messages are compressed once peer
+		/// answers it can decompress them.
+		void setCompression(Codec::Enum _codec, uint8_t _dictionary, uint16_t _threshold)
 		{
-			switch (_id)
+			if (m_raw
+			||  isUdp() )
 			{
-			case Internal::Disconnect:
-				{
-					Message* msg = msgAlloc(_msg->handle, 2, true);
-					msg->data[0] = 0;
-					msg->data[1] = Internal::Disconnect;
-					ctxPush(msg);
+				BX_TRACE("Compression is not available for raw and UDP connections.");
+				return;
+			}
 
-					BX_TRACE("Disconnect %d - Client closed connection (finish).", m_handle);
-					disconnect();
-				}
-				return false;
+			m_compression.codec = Codec::None;
+			m_compression.dictionary = 0;
+			m_compression.offerCodec = uint8_t(_codec);
+			m_compression.offerDictionary = _dictionary;
+			m_compression.threshold = _threshold;
 
-			case Internal::Notify:
-				{
-					Message* msg = msgAlloc(_msg->handle, _msg->size+1, true);
-					msg->data[0] = MessageId::Notify;
-					memcpy(&msg->data[1], _msg->data, _msg->size);
-					ctxPush(msg);
-				}
-				return true;
+			if (Codec::None != _codec)
+			{
+				const Lz4Dictionary* dict = ctxDictionary(m_ctx, _dictionary);
 
-			default:
-				break;
+				Message* msg = msgAlloc(m_ctx, m_handle, 8);
+				getHeader(msg)->flags = MessageFlags::Control;
+				msg->data[0] = 0;
+				msg->data[1] = ControlFrame::Offer;
+				msg->data[2] = uint8_t(_codec);
+				msg->data[3] = NULL != dict ? _dictionary : 0;
+				const uint32_t hash = bx::toLittleEndian(NULL != dict ? dict->hash : 0);
+				memcpy(&msg->data[4], &hash, sizeof(hash) );
+				ctxQueue(m_ctx, msg);
 			}
+		}
 
-			BX_CHECK(false, "You shoud not be here!");
-			return true;
+		void getCompressionStats(CompressionStats& _stats) const
+		{
+			const uint64_t freq = bx::getHPFrequency();
+			_stats.sentRaw        = m_compression.sentRaw;
+			_stats.sentCompressed = m_compression.sentCompressed;
+			_stats.recvCompressed = m_compression.recvCompressed;
+			_stats.recvRaw        = m_compression.recvRaw;
+			_stats.compressUs     = m_compression.compressTicks*1000000/freq;
+			_stats.decompressUs   = m_compression.decompressTicks*1000000/freq;
+			_stats.codec          = m_compression.codec;
+			_stats.dictionary     = m_compression.dictionary;
 		}
 
-		bool updateTcpHandshake()
+		bool hasViews() const
 		{
-			if (!m_tcpHandshake)
+			return NULL != m_viewHead;
+		}
+
+		/// Connection is destroyed once it is closed, and all views are
+		/// released.
+		void setDestroyPending()
+		{
+			m_destroyPending = true;
+		}
+
+		bool isDestroyPending() const
+		{
+			return m_destroyPending;
+		}
+
+		bool isSecure() const
+		{
+#if BNET_CONFIG_OPENSSL
+			return NULL != m_ssl;
+#else
+			return false;
+#endif // BNET_CONFIG_OPENSSL
+		}
+
+		bool isUdp() const
+		{
+#if BNET_CONFIG_UDP
+			return NULL != m_udp;
+#else
+			return false;
+#endif // BNET_CONFIG_UDP
+		}
+
+		/// Returns true if partially written frame is waiting for socket
+		/// to become writable.
+		bool isSendPending() const
+		{
+			return INVALID_SOCKET != m_socket
+				&& m_sendPending
+				;
+		}
+
+		/// Returns true if connection must be updated even without
+		/// readiness event (handshake in progress, or more data might
+		/// be pending in edge-triggered mode). UDP connections are
+		/// updated on readiness, resend, keepalive and timeout are
+		/// driven by timer.
+		bool needsUpdate() const
+		{
+			return INVALID_SOCKET != m_socket
+				&& !isUdp()
+				&& (m_tcpHandshake || m_sslHandshake || m_recvPending)
+				;
+		}
+
+#if BNET_CONFIG_IO_URING
+		void setUring(bool _uring)
+		{
+			m_uring = _uring;
+		}
+
+		bool isUring() const
+		{
+			return m_uring;
+		}
+
+		bool hasOutgoing()
+		{
+			return NULL != m_outgoing.peek()
+				|| NULL != m_queued[Priority::High].peek()
+				|| NULL != m_queued[Priority::Normal].peek()
+				|| NULL != m_queued[Priority::Low].peek()
+				|| NULL != m_inflight.peek()
+				;
+		}
+
+		/// Data received by io_uring engine. Returns false if receive
+		/// buffer is full. Data that didn't fit is kept, and receive must
+		/// be paused until it's drained on update.
+		bool uringRecv(const uint8_t* _data, uint32_t _len)
+		{
+			++m_stats.recvCalls;
+			m_stats.bytesReceived += _len;
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			m_recvTime = bx::getHPCounter();
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+			touch();
+
+			if (0 == m_uringStashSize)
 			{
-				return true;
+				const uint32_t size = uringWrite(_data, _len);
+				_data += size;
+				_len  -= size;
 			}
 
-			uint64_t now = bx::getHPCounter();
-			if (now > m_tcpHandshakeTimeout)
+			if (0 < _len
+			&&  INVALID_SOCKET != m_socket)
 			{
-				BX_TRACE("Disconnect %d - Connect timeout.", m_handle);
-				ctxPush(m_handle, MessageId::ConnectFailed);
-				disconnect();
-				return false;
+				// Receives completed before pause are kept after data
+				// that's already waiting.
+				m_uringStash = (uint8_t*)BX_REALLOC(ctxAllocator(m_ctx), m_uringStash, m_uringStashSize + _len);
+				memcpy(&m_uringStash[m_uringStashSize], _data, _len);
+				m_uringStashSize += _len;
+				m_recvPending = true;
 			}
 
-			m_tcpHandshake = !issocketready(m_socket);
-			return !m_tcpHandshake;
+			releaseIncoming();
+
+			return 0 == m_uringStashSize;
 		}
 
-		bool updateSslHandshake()
+		/// Moves data kept by `uringRecv` into receive buffer.
+		void uringDrain()
 		{
-#if BNET_CONFIG_OPENSSL
-			if (NULL != m_ssl
-			&&  m_sslHandshake)
+			const uint32_t size = uringWrite(m_uringStash, m_uringStashSize);
+			m_uringStashSize -= size;
+			memmove(m_uringStash, &m_uringStash[size], m_uringStashSize);
+
+			if (0 == m_uringStashSize)
 			{
-				int err = SSL_do_handshake(m_ssl);
+				BX_FREE(ctxAllocator(m_ctx), m_uringStash);
+				m_uringStash = NULL;
+				m_recvPending = false;
+			}
+		}
 
-				if (1 == err)
+		/// Returns number of bytes written into receive buffer, it stops
+		/// short once buffer is full, and it can't grow.
+		uint32_t uringWrite(const uint8_t* _data, uint32_t _len)
+		{
+			uint32_t total = 0;
+
+			while (total < _len
+			&&     INVALID_SOCKET != m_socket)
+			{
+				reserveIncoming();
+
+				const uint32_t size = m_recv.write( (const char*)&_data[total], _len - total);
+				if (0 == size)
 				{
-					m_sslHandshake = false;
-#	if BNET_CONFIG_DEBUG
-					X509* cert = SSL_get_peer_certificate(m_ssl);
-					BX_TRACE("Server certificate:");
+					break;
+				}
 
-					char* temp;
-					temp = X509_NAME_oneline(X509_get_subject_name(cert), 0, 0);
-					BX_TRACE("\t subject: %s", temp);
-					OPENSSL_free(temp);
+				total += size;
 
-					temp = X509_NAME_oneline(X509_get_issuer_name(cert), 0, 0);
-					BX_TRACE("\t issuer: %s", temp);
-					OPENSSL_free(temp);
+				trackIncoming();
+				updateIncomingMessages();
+			}
 
-					X509_free(cert);
-#	endif // BNET_CONFIG_DEBUG
+			return total;
+		}
 
-					long result = SSL_get_verify_result(m_ssl);
-					if (X509_V_OK != result)
-					{
-						BX_TRACE("Disconnect %d - SSL verify failed %d.", m_handle, result);
-						ctxPush(m_handle, MessageId::ConnectFailed);
-						disconnect();
-						return false;
-					}
+		/// Queue linked sends for all queued messages, up to
+		/// BNET_CONFIG_IO_URING_MAX_LINKED_SENDS. Only one chain per
+		/// connection is in flight, so frames can't be reordered. Returns
+		/// false if submission queue has no room for whole chain.
+		bool uringSend(Uring& _uring)
+		{
+			if (INVALID_SOCKET == m_socket
+			||  0 != m_numInflight)
+			{
+				return true;
+			}
 
-					BX_TRACE("SSL connection using %s", SSL_get_cipher(m_ssl) );
+			if (BNET_CONFIG_IO_URING_MAX_LINKED_SENDS > _uring.getSqSpace() )
+			{
+				// Chain must not be split by flushing full submission
+				// queue in the middle of it.
+				_uring.submit();
+				if (BNET_CONFIG_IO_URING_MAX_LINKED_SENDS > _uring.getSqSpace() )
+				{
+					return false;
 				}
-				else
+			}
+
+			Message* chain[BNET_CONFIG_IO_URING_MAX_LINKED_SENDS];
+			uint32_t num = 0;
+			int64_t now = 0; // Sends are measured once they complete.
+
+			// Leftovers from previous chain that was cut short.
+			for (Message* msg = m_inflight.pop(); NULL != msg; msg = m_inflight.pop() )
+			{
+				chain[num++] = msg;
+			}
+
+			for (Message* msg = peekOutgoing(); NULL != msg && num < BX_COUNTOF(chain); msg = peekOutgoing() )
+			{
+				Internal::Enum id = getMarker(msg);
+				if (Internal::None != id)
 				{
-					int sslError = SSL_get_error(m_ssl, err);
-					switch (sslError)
+					if (0 != num)
 					{
-					case SSL_ERROR_WANT_READ:
-						SSL_read(m_ssl, NULL, 0);
+						// Wait until all prior messages are sent.
 						break;
+					}
 
-					case SSL_ERROR_WANT_WRITE:
-						SSL_write(m_ssl, NULL, 0);
-						break;
+					if (!m_raw)
+					{
+						*( (uint16_t*)msg->data - 1) = uint16_t(msg->size);
+					}
 
-					default:
-						TRACE_SSL_ERROR();
-						break;
+					if (!processInternal(id, msg) )
+					{
+						return true;
 					}
+
+					release(popOutgoing(now) );
+					continue;
+				}
+
+				if (!m_raw)
+				{
+					*( (uint16_t*)msg->data - 1) = bx::toLittleEndian(uint16_t(msg->size) );
 				}
+
+				chain[num++] = popOutgoing(now);
+			}
+
+			for (uint32_t ii = 0; ii < num; ++ii)
+			{
+				Message* msg = chain[ii];
+				uint32_t offset = 0 == ii ? m_sendOffset : 0;
+				m_inflight.push(msg);
+				_uring.send(m_socket
+					, getFrame(msg) + offset
+					, getFrameSize(msg) - offset
+					, uint64_t(uintptr_t(msg) ) | UringTag::Send
+					, ii != num-1
+					);
 			}
-#endif // BNET_CONFIG_OPENSSL
 
+			m_numInflight = uint16_t(num);
+			m_stats.sendCalls += num;
 			return true;
 		}
 
-		bool send(const char* _data, uint32_t _len)
+		/// Returns true if there is more to send.
+		bool uringSendComplete(Message* _msg, int32_t _result, int64_t& _now)
 		{
-			int bytes;
-			uint32_t offset = 0;
-			do
+			// Once chain is cut short, head stays in flight and remaining
+			// links complete with -ECANCELED.
+			BX_CHECK(m_sendFailed || _msg == m_inflight.peek(), "Send completion out of order!");
+			--m_numInflight;
+
+			if (!m_sendFailed)
 			{
-#if BNET_CONFIG_OPENSSL
-				if (NULL != m_ssl)
+				uint32_t size = getFrameSize(_msg) - m_sendOffset;
+				if (0 <= _result
+				&&  uint32_t(_result) == size)
 				{
-					bytes = SSL_write(m_ssl
-						, &_data[offset]
-						, _len
-						);
+					m_stats.bytesSent += _result;
+					++m_stats.messagesSent;
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+					recordSend(_msg, _now);
+#else
+					BX_UNUSED(_now);
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+					m_sendOffset = 0;
+					release(m_inflight.pop() );
 				}
-				else
-#endif // BNET_CONFIG_OPENSSL
+				else if (0 < _result)
 				{
-					bytes = ::send(m_socket
-						, &_data[offset]
-						, _len
-						, 0
-						);
+					m_stats.bytesSent += _result;
+					m_sendOffset += _result;
+					m_sendFailed = true;
 				}
-
-				if (0 > bytes)
+				else if (-ECANCELED == _result
+				     ||  -EAGAIN    == _result
+				     ||  -EINTR     == _result)
 				{
-					if (-1 == bytes
-					&&  !isWouldBlock() )
-					{
-						BX_TRACE("Disconnect %d - Send failed.", m_handle);
-						disconnect(DisconnectReason::SendFailed);
-						return false;
-					}
+					m_stats.sendWouldBlock += -EAGAIN == _result;
+					m_sendFailed = true;
 				}
 				else
 				{
-					_len -= bytes;
-					offset += bytes;
+					BX_TRACE("Disconnect %d - Send failed. %d", m_handle.idx, -_result);
+					disconnect(DisconnectReason::SendFailed);
+					return false;
 				}
+			}
 
-			} while (0 < _len);
+			if (0 == m_numInflight)
+			{
+				m_sendFailed = false;
+				return hasOutgoing();
+			}
 
-			return true;
+			return false;
 		}
+#endif // BNET_CONFIG_IO_URING
 
-		uint64_t m_tcpHandshakeTimeout;
-		SOCKET m_socket;
-		Handle m_handle;
-		uint8_t* m_incomingBuffer;
-		bx::RingBufferControl m_incoming;
-		RecvRingBuffer m_recv;
-		MessageQueue m_outgoing;
-#if BNET_CONFIG_OPENSSL
-		SSL* m_ssl;
-#endif // BNET_CONFIG_OPENSSL
+	private:
+		void init(Handle _handle, bool _raw)
+		{
+			m_handle = _handle;
+			m_tcpHandshake = true;
+			m_sslHandshake = false;
+			m_recvPending = false;
+#if BNET_CONFIG_IO_URING
+			m_uring = false;
+#endif // BNET_CONFIG_IO_URING
+			m_len = -1;
+			m_raw = _raw;
+			memset(&m_compression, 0, sizeof(m_compression) );
+			memset(&m_stats, 0, sizeof(m_stats) );
+			m_connectStart = bx::getHPCounter();
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			if (NULL != m_sendLatency)
+			{
+				m_sendLatency->reset();
+			}
+			m_recvTime = m_connectStart;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+			m_sendQueued = 0;
+			m_sendQueuedNum = 0;
+			m_sendLow    = BNET_CONFIG_SEND_LOW_WATERMARK;
+			m_sendHigh   = BNET_CONFIG_SEND_HIGH_WATERMARK;
+			m_sendLimit  = BNET_CONFIG_SEND_LIMIT;
+			m_sendPolicy = SendLimit::Drop;
+			m_sendFull   = false;
+
+			m_connectTimer.key = (TimerKind::Connect<<16) | _handle.idx;
+			m_idleTimer.key    = (TimerKind::Idle<<16) | _handle.idx;
+#if BNET_CONFIG_UDP
+			m_udpTimer.key     = (TimerKind::Udp<<16) | _handle.idx;
+#endif // BNET_CONFIG_UDP
+			ctxTimers(m_ctx).add(&m_connectTimer, BNET_CONFIG_CONNECT_TIMEOUT_SECONDS*1000);
+			setIdleTimeout(BNET_CONFIG_IDLE_TIMEOUT_MS);
+
+			BX_TRACE("init %d", m_handle.idx);
+		}
 
-		int m_len;
-		bool m_raw;
-		bool m_tcpHandshake;
-		bool m_sslHandshake;
-	};
+		void touch()
+		{
+			if (0 != m_idleTicks)
+			{
+				m_lastRecv = ctxTimers(m_ctx).getTick();
+			}
+		}
 
-	typedef FreeList<Connection> Connections;
+		/// Records handshake time, once connection is established.
+		void established()
+		{
+			if (0 == m_stats.handshakes
+			&&  !m_tcpHandshake
+			&&  !m_sslHandshake)
+			{
+				m_stats.handshakes  = 1;
+				m_stats.handshakeUs = uint64_t(bx::getHPCounter() - m_connectStart)*1000000/bx::getHPFrequency();
+			}
+		}
 
-	class ListenSocket
-	{
-	public:
-		ListenSocket()
-			: m_socket(INVALID_SOCKET)
-			, m_handle(invalidHandle)
-			, m_raw(false)
-			, m_secure(false)
-			, m_cert(NULL)
-			, m_key(NULL)
+		void pushReceived(Message* _msg)
 		{
+			++m_stats.messagesReceived;
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			getHeader(_msg)->time = m_recvTime;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+			ctxPush(m_ctx, _msg);
 		}
 
-		~ListenSocket()
+		void stopTimers()
 		{
-			close();
+			TimerWheel& timers = ctxTimers(m_ctx);
+			timers.remove(&m_connectTimer);
+			timers.remove(&m_idleTimer);
+#if BNET_CONFIG_UDP
+			timers.remove(&m_udpTimer);
+#endif // BNET_CONFIG_UDP
 		}
 
-		void close()
+		void pushIncoming(Handle _listenHandle, uint32_t _ip, uint16_t _port)
 		{
-			if (INVALID_SOCKET != m_socket)
-			{
-				::closesocket(m_socket);
-				m_socket = INVALID_SOCKET;
-			}
+			Message* msg = msgAlloc(m_ctx, m_handle, 9, true);
+			msg->data[0] = MessageId::IncomingConnection;
+			*( (uint16_t*)&msg->data[1]) = _listenHandle.idx;
+			*( (uint32_t*)&msg->data[3]) = _ip;
+			*( (uint16_t*)&msg->data[7]) = _port;
+			ctxPush(m_ctx, msg);
+		}
 
-#if BNET_CONFIG_OPENSSL
-			if (NULL != m_cert)
+		/// Takes receive buffer from context pool, or grows it when last
+		/// receive filled it. Returns false when buffer is full.
+		bool reserveIncoming()
+		{
+			if (NULL == m_incomingBuffer)
 			{
-				X509_free(m_cert);
-				m_cert = NULL;
+				resizeIncoming(m_zeroCopy ? BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE : m_incomingSize);
 			}
-
-			if (NULL != m_key)
+			else if (NULL == m_viewHead
+			     &&  m_incoming.m_size < m_incomingSize)
 			{
-				EVP_PKEY_free(m_key);
-				m_key = NULL;
+				resizeIncoming(m_incomingSize);
 			}
-#endif // BNET_CONFIG_OPENSSL
+
+			return !m_recv.isFull();
 		}
 
-		void listen(Handle _handle, uint32_t _ip, uint16_t _port, bool _raw, const char* _cert, const char* _key)
+		/// Buffer grows once receive fills it, so partial message larger
+		/// than buffer can be received.
+		void trackIncoming()
 		{
-			m_handle = _handle;
-			m_raw = _raw;
+			m_incomingPeak = bx::uint32_max(m_incomingPeak, m_incoming.distance(m_incoming.m_read, m_incoming.m_current) );
 
-#if BNET_CONFIG_OPENSSL
-			if (NULL != _cert)
+			if (m_recv.isFull() )
 			{
-				BIO* mem = BIO_new_mem_buf(const_cast<char*>(_cert), -1);
-				m_cert = PEM_read_bio_X509(mem, NULL, NULL, NULL);
-				BIO_free(mem);
+				m_incomingSize = bx::uint32_min(m_incoming.m_size*2, BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE);
 			}
+		}
 
-			if (NULL != _key)
+		/// Returns drained receive buffer to context pool. Next buffer is
+		/// smaller if this one was mostly unused.
+		void releaseIncoming()
+		{
+			if (NULL != m_incomingBuffer
+			&&  NULL == m_viewHead
+			&&  0 == parseAvailable() )
 			{
-				BIO* mem = BIO_new_mem_buf(const_cast<char*>(_key), -1);
-				m_key = PEM_read_bio_PrivateKey(mem, NULL, NULL, NULL);
-				BIO_free(mem);
+				if (m_incomingPeak < m_incomingSize/4)
+				{
+					m_incomingSize = bx::uint32_max(m_incomingSize/2, BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE);
+				}
+
+				m_incomingPeak = 0;
+				resizeIncoming(0);
 			}
+		}
 
-			m_secure = NULL != m_key && NULL != m_cert;
-#endif // BNET_CONFIG_OPENSSL
+		/// Moves unparsed data into new receive buffer, or releases buffer
+		/// when _size is 0. Views must not reference old buffer.
+		void resizeIncoming(uint32_t _size)
+		{
+			BX_CHECK(NULL == m_viewHead, "Receive buffer is referenced by zero-copy messages!");
 
-			if (!m_secure
-			&&  (NULL != _cert || NULL != _key) )
-			{
-#if BNET_CONFIG_OPENSSL
-				BX_TRACE("Certificate of key is not set correctly.");
-#else
-				BX_TRACE("BNET_CONFIG_OPENSSL is not enabled.");
-#endif // BNET_CONFIG_OPENSSL
-				ctxPush(m_handle, MessageId::ListenFailed);
-				return;
-			}
+			const bool slack = 0 != _size && m_zeroCopy;
+			const uint32_t available = 0 != _size ? parseAvailable() : 0;
 
-			m_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-			if (INVALID_SOCKET == m_socket)
+			uint8_t* buffer = NULL;
+			if (0 != _size)
 			{
-				BX_TRACE("Create socket failed.");
-				ctxPush(m_handle, MessageId::ListenFailed);
-				return;
+				BX_CHECK(available < _size, "Receive buffer is too small!");
+				buffer = (uint8_t*)ctxAllocRecvBuffer(m_ctx, _size + (slack ? maxMessageSize : 0) );
+				parse( (char*)buffer, available);
 			}
-			setSockOpts(m_socket);
 
-			m_addr.sin_family = AF_INET;
-			m_addr.sin_addr.s_addr = htonl(_ip);
-			m_addr.sin_port = htons(_port);
-
-			if (SOCKET_ERROR == ::bind(m_socket, (sockaddr*)&m_addr, sizeof(m_addr) )
-			||  SOCKET_ERROR == ::listen(m_socket, SOMAXCONN) )
+			if (NULL != m_incomingBuffer)
 			{
-				::closesocket(m_socket);
-				m_socket = INVALID_SOCKET;
-
-				BX_TRACE("Bind or listen socket failed.");
-				ctxPush(m_handle, MessageId::ListenFailed);
-				return;
+				ctxFreeRecvBuffer(m_ctx, m_incomingBuffer, m_incoming.m_size + (m_viewSlack ? maxMessageSize : 0) );
 			}
 
-			setNonBlock(m_socket);
+			m_incoming.~RingBufferControl();
+			::new (&m_incoming) bx::RingBufferControl(0 != _size ? _size : BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE);
+			m_incoming.reserve(available);
+			m_incoming.commit(available);
+
+			m_incomingBuffer = buffer;
+			m_recv.reset( (char*)buffer);
+			m_viewSlack = slack;
+			m_parse = 0;
 		}
 
-		void update()
+		/// Bytes received, but not parsed yet.
+		uint32_t parseAvailable() const
 		{
-			sockaddr_in addr;
-			socklen_t len = sizeof(addr);
-			SOCKET socket = ::accept(m_socket, (sockaddr*)&addr, &len);
-			if (INVALID_SOCKET != socket)
-			{
-				uint32_t ip = ntohl(addr.sin_addr.s_addr);
-				uint16_t port = ntohs(addr.sin_port);
-				ctxAccept(m_handle, socket, ip, port, m_raw, m_cert, m_key);
-			}
+			return m_incoming.distance(m_parse, m_incoming.m_current);
 		}
 
-	private:
-		sockaddr_in m_addr;
-		SOCKET m_socket;
-		Handle m_handle;
-		bool m_raw;
-		bool m_secure;
-		X509* m_cert;
-		EVP_PKEY* m_key;
-	};
-
-	typedef FreeList<ListenSocket> ListenSockets;
-
-	class Context
-	{
-	public:
-		Context()
-			: m_connections(NULL)
-			, m_listenSockets(NULL)
-			, m_sslCtx(NULL)
-			, m_sslCtxServer(NULL)
+		void parse(char* _data, uint32_t _len)
 		{
+			const uint32_t wrap = bx::uint32_min(_len, m_incoming.m_size - m_parse);
+			memcpy(_data, &m_incomingBuffer[m_parse], wrap);
+			memcpy(&_data[wrap], m_incomingBuffer, _len - wrap);
+			m_parse = (m_parse + _len) % m_incoming.m_size;
 		}
 
-		~Context()
+		/// Returns contiguous view of next _len bytes. Part wrapped around
+		/// end of ring is mirrored into slack area after the ring.
+		uint8_t* parseView(uint32_t _len)
 		{
+			uint8_t* data = &m_incomingBuffer[m_parse];
+			const uint32_t wrap = m_incoming.m_size - m_parse;
+			if (_len > wrap)
+			{
+				memcpy(&m_incomingBuffer[m_incoming.m_size], m_incomingBuffer, _len - wrap);
+			}
+
+			m_parse = (m_parse + _len) % m_incoming.m_size;
+			return data;
 		}
 
-		void init(uint16_t _maxConnections, uint16_t _maxListenSockets, const char* _certs[])
+		/// Frees ring space up to first view that is not released yet.
+		void consume()
 		{
-#if BNET_CONFIG_OPENSSL
-			CRYPTO_get_mem_functions(&m_sslMalloc, &m_sslRealloc, &m_sslFree);
-			CRYPTO_set_mem_functions(sslMalloc, sslRealloc, sslFree);
-			SSL_library_init();
-#	if BNET_CONFIG_DEBUG
-			SSL_load_error_strings();
-#	endif // BNET_CONFIG_DEBUG
-			m_sslCtx = SSL_CTX_new(SSLv23_client_method() );
-			SSL_CTX_set_verify(m_sslCtx, SSL_VERIFY_NONE, NULL);
-			if (NULL != _certs)
+			while (NULL != m_viewHead
+			&&     getView(m_viewHead)->released)
 			{
-				X509_STORE* store = SSL_CTX_get_cert_store(m_sslCtx);
-				for (const char** cert = _certs; NULL != *cert; ++cert )
-				{
-					BIO* mem = BIO_new_mem_buf(const_cast<char*>(*cert), -1);
-					X509* x509 = PEM_read_bio_X509(mem, NULL, NULL, NULL);
-					X509_STORE_add_cert(store, x509);
-					X509_free(x509);
-					BIO_free(mem);
-				}
+				Message* msg = m_viewHead;
+				m_viewHead = getView(msg)->next;
+				getHeader(msg)->flags = 0;
+				msgRelease(msg);
 			}
 
-			if (_maxListenSockets)
+			if (NULL == m_viewHead)
 			{
-				m_sslCtxServer = SSL_CTX_new(SSLv23_server_method());
+				m_viewTail = NULL;
 			}
-#else
-			m_sslCtx = &sslDummyContext;
-			m_sslCtxServer = &sslDummyContext;
-			BX_UNUSED(_certs);
-#endif // BNET_CONFIG_OPENSSL
 
-			_maxConnections = _maxConnections == 0 ? 1 : _maxConnections;
-
-			m_connections = BX_NEW(g_allocator, Connections)(_maxConnections);
+			const uint32_t end = NULL != m_viewHead ? getView(m_viewHead)->start : m_parse;
+			m_incoming.consume(m_incoming.distance(m_incoming.m_read, end) );
+		}
 
-			if (0 != _maxListenSockets)
-			{
-				m_listenSockets = BX_NEW(g_allocator, ListenSockets)(_maxListenSockets);
-			}
+		static RecvView* getView(Message* _msg)
+		{
+			return (RecvView*)(_msg + 1);
 		}
 
-		void shutdown()
+		Message* allocView(uint16_t _len)
 		{
-			for (Message* msg = m_incoming.pop(); NULL != msg; msg = m_incoming.pop() )
-			{
-				release(msg);
-			}
+			Message* msg = msgAlloc(m_ctx, m_handle, sizeof(RecvView), true);
+			getHeader(msg)->flags = MessageFlags::View;
 
-			BX_DELETE(g_allocator, m_connections);
+			RecvView* view = getView(msg);
+			view->next = NULL;
+			view->start = m_parse;
+			view->released = false;
 
-			if (NULL != m_listenSockets)
-			{
-				BX_DELETE(g_allocator, m_listenSockets);
-			}
+			msg->data = parseView(_len);
+			msg->size = _len;
 
-#if BNET_CONFIG_OPENSSL
-			if (NULL != m_sslCtx)
+			if (NULL == m_viewTail)
 			{
-				SSL_CTX_free(m_sslCtx);
+				m_viewHead = msg;
 			}
-			m_sslCtx = NULL;
-
-			if (NULL != m_sslCtxServer)
+			else
 			{
-				SSL_CTX_free(m_sslCtxServer);
+				getView(m_viewTail)->next = msg;
 			}
-			m_sslCtxServer = NULL;
-			CRYPTO_set_mem_functions(m_sslMalloc, m_sslRealloc, m_sslFree);
-#endif // BNET_CONFIG_OPENSSL
+
+			m_viewTail = msg;
+
+			return msg;
 		}
 
-		Handle listen(uint32_t _ip, uint16_t _port, bool _raw, const char* _cert, const char* _key)
+		void updateIncomingMessages()
 		{
-			ListenSocket* listenSocket = m_listenSockets->create();
-			if (NULL != listenSocket)
+			if (m_raw)
 			{
-				Handle handle = { m_listenSockets->getHandle(listenSocket) };
-				listenSocket->listen(handle, _ip, _port, _raw, _cert, _key);
-				return handle;
+				uint32_t available = bx::uint32_min(parseAvailable(), maxMessageSize-1);
+
+				if (0 < available)
+				{
+					Message* msg = msgAlloc(m_ctx, m_handle, available+1, true);
+					msg->data[0] = MessageId::RawData;
+					parse( (char*)&msg->data[1], available);
+					consume();
+					pushReceived(msg);
+				}
 			}
+			else
+			{
+				uint32_t available = bx::uint32_min(parseAvailable(), maxMessageSize);
+
+				while (0 < available)
+				{
+					if (-1 == m_len)
+					{
+						if (2 > available)
+						{
+							return;
+						}
+						else
+						{
+							uint16_t len;
+							parse( (char*)&len, 2);
+							consume();
+							m_len = bx::toHostEndian(len, true);
+						}
+					}
+					else
+					{
+						if (m_len > int(available) )
+						{
+							return;
+						}
+						else
+						{
+							Message* msg;
+							if (m_zeroCopy
+							&&  0 < m_len)
+							{
+								if (m_incomingBuffer[m_parse] < MessageId::UserDefined
+								&&  m_incomingBuffer[m_parse] != MessageId::Fragment
+								&&  0 != m_incomingBuffer[m_parse])
+								{
+									BX_TRACE("Disconnect %d - Invalid message id.", m_handle.idx);
+									disconnect(DisconnectReason::InvalidMessageId);
+									return;
+								}
+
+								msg = allocView(uint16_t(m_len) );
+							}
+							else
+							{
+								msg = msgAlloc(m_ctx, m_handle, m_len, true);
+								parse( (char*)msg->data, m_len);
+								uint8_t id = msg->data[0];
+
+								if (id < MessageId::UserDefined
+								&&  id != MessageId::Fragment
+								&&  0 != id)
+								{
+									msgRelease(msg);
+
+									BX_TRACE("Disconnect %d - Invalid message id.", m_handle.idx);
+									disconnect(DisconnectReason::InvalidMessageId);
+									return;
+								}
+							}
+
+							consume();
+
+							if (0 < m_len
+							&&  0 == msg->data[0])
+							{
+								msg = recvControl(msg);
+								if (INVALID_SOCKET == m_socket)
+								{
+									return;
+								}
+							}
+
+							if (NULL != msg
+							&&  0 < msg->size
+							&&  MessageId::Fragment == msg->data[0])
+							{
+								msg = reassemble(msg);
+								if (INVALID_SOCKET == m_socket)
+								{
+									return;
+								}
+							}
+
+							if (NULL != msg)
+							{
+								pushReceived(msg);
+							}
+
+							m_len = -1;
+						}
+					}
+
+					available = bx::uint32_min(parseAvailable(), maxMessageSize);
+				}
+			}
+		}
+
+		/// Returns reassembled message once its last fragment is received,
+		/// or fragment itself when large message is streamed to user.
+		Message* reassemble(Message* _msg)
+		{
+			const uint8_t flags = 2 <= _msg->size ? _msg->data[1] : 0;
+			uint32_t header = 2;
+
+			if (0 != (flags & FragmentFlags::First) )
+			{
+				header = 6;
+
+				uint32_t total = 0;
+				if (header <= _msg->size)
+				{
+					memcpy(&total, &_msg->data[2], sizeof(total) );
+					total = bx::toHostEndian(total, true);
+				}
+
+				if (0 == total
+				||  NULL != m_assembly)
+				{
+					return invalidFragment(_msg);
+				}
+
+				if (0 != m_assemblyMax
+				&&  total <= m_assemblyMax)
+				{
+					m_assembly = msgAlloc(m_ctx, m_handle, total, true);
+					m_assemblyOffset = 0;
+				}
+			}
+
+			if (NULL == m_assembly)
+			{
+				return _msg;
+			}
+
+			if (header > _msg->size
+			||  _msg->size - header > m_assembly->size - m_assemblyOffset)
+			{
+				return invalidFragment(_msg);
+			}
+
+			memcpy(&m_assembly->data[m_assemblyOffset], &_msg->data[header], _msg->size - header);
+			m_assemblyOffset += _msg->size - header;
+			releaseMessage(_msg);
+
+			if (0 == (flags & FragmentFlags::Last) )
+			{
+				return NULL;
+			}
+
+			Message* msg = m_assembly;
+			m_assembly = NULL;
+
+			if (m_assemblyOffset != msg->size
+			||  msg->data[0] < MessageId::UserDefined)
+			{
+				return invalidFragment(msg);
+			}
+
+			return msg;
+		}
+
+		/// Returns decompressed message, or NULL when frame is consumed
+		/// by connection.
+		Message* recvControl(Message* _msg)
+		{
+			const uint8_t type = 2 <= _msg->size ? _msg->data[1] : UINT8_MAX;
+
+			switch (type)
+			{
+			case ControlFrame::Offer:
+				if (8 <= _msg->size)
+				{
+					// Answer which codec, and dictionary, can be
+					// decompressed.
+					const uint8_t codec = Codec::Lz4 == _msg->data[2] ? uint8_t(Codec::Lz4) : uint8_t(Codec::None);
+					const Lz4Dictionary* dict = ctxDictionary(m_ctx, _msg->data[3]);
+					uint32_t hash;
+					memcpy(&hash, &_msg->data[4], sizeof(hash) );
+					const bool match = NULL != dict && dict->hash == bx::toHostEndian(hash, true);
+
+					Message* msg = msgAlloc(m_ctx, m_handle, 4);
+					getHeader(msg)->flags = MessageFlags::Control;
+					msg->data[0] = 0;
+					msg->data[1] = ControlFrame::Answer;
+					msg->data[2] = codec;
+					msg->data[3] = match ? _msg->data[3] : 0;
+					ctxQueue(m_ctx, msg);
+
+					releaseMessage(_msg);
+					return NULL;
+				}
+				break;
+
+			case ControlFrame::Answer:
+				if (4 <= _msg->size)
+				{
+					if (Codec::None != m_compression.offerCodec
+					&&  m_compression.offerCodec == _msg->data[2])
+					{
+						m_compression.codec = _msg->data[2];
+						m_compression.dictionary = m_compression.offerDictionary == _msg->data[3] ? _msg->data[3] : 0;
+					}
+
+					releaseMessage(_msg);
+					return NULL;
+				}
+				break;
+
+			case ControlFrame::Compressed:
+				if (5 < _msg->size)
+				{
+					return decompress(_msg);
+				}
+				break;
+
+			default:
+				break;
+			}
+
+			return invalidControl(_msg);
+		}
+
+		Message* decompress(Message* _msg)
+		{
+			const uint8_t dictionary = _msg->data[2];
+			const uint16_t size = readUint16(&_msg->data[3]);
+			const Lz4Dictionary* dict = ctxDictionary(m_ctx, dictionary);
+
+			if (0 == size
+			||  (0 != dictionary && NULL == dict) )
+			{
+				return invalidControl(_msg);
+			}
+
+			const uint64_t start = bx::getHPCounter();
+			Message* msg = msgAlloc(m_ctx, m_handle, size, true);
+			int32_t result = lz4Decompress(msg->data, size, &_msg->data[5], _msg->size - 5, dict);
+			m_compression.decompressTicks += bx::getHPCounter() - start;
+			m_compression.recvCompressed  += _msg->size;
+			m_compression.recvRaw         += size;
+
+			releaseMessage(_msg);
+
+			if (result != int32_t(size)
+			||  (msg->data[0] < MessageId::UserDefined && msg->data[0] != MessageId::Fragment) )
+			{
+				return invalidControl(msg);
+			}
+
+			return msg;
+		}
+
+		Message* invalidControl(Message* _msg)
+		{
+			releaseMessage(_msg);
+
+			BX_TRACE("Disconnect %d - Invalid control frame.", m_handle.idx);
+			disconnect(DisconnectReason::InvalidMessageId);
+			return NULL;
+		}
+
+		/// Returns compressed message, or original one when it's below
+		/// threshold, or doesn't get smaller. Large messages are sent as
+		/// they are, since they are fragmented after they are queued.
+		Message* compress(Message* _msg)
+		{
+			const uint32_t header = 5;
+			if (_msg->size < m_compression.threshold
+			||  _msg->size <= header + 1
+			||  0 != (getHeader(_msg)->flags & (MessageFlags::Shared|MessageFlags::Control|MessageFlags::Stream) )
+			||  Internal::None != getMarker(_msg) )
+			{
+				return _msg;
+			}
+
+			const uint64_t start = bx::getHPCounter();
+			Message* msg = msgAlloc(m_ctx, m_handle, _msg->size);
+			uint32_t size = lz4Compress(&msg->data[header]
+				, _msg->size - header - 1
+				, _msg->data
+				, _msg->size
+				, ctxLz4Table(m_ctx)
+				, ctxDictionary(m_ctx, m_compression.dictionary)
+				);
+			m_compression.compressTicks += bx::getHPCounter() - start;
+			m_compression.sentRaw += _msg->size;
+
+			if (0 == size)
+			{
+				m_compression.sentCompressed += _msg->size;
+				release(msg);
+				return _msg;
+			}
+
+			getHeader(msg)->flags = MessageFlags::Control;
+			msg->data[0] = 0;
+			msg->data[1] = ControlFrame::Compressed;
+			msg->data[2] = m_compression.dictionary;
+			writeUint16(&msg->data[3], uint16_t(_msg->size) );
+			msg->size = header + size;
+			m_compression.sentCompressed += msg->size;
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			getHeader(msg)->time = getHeader(_msg)->time;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+			release(_msg);
+			return msg;
+		}
+
+		Message* invalidFragment(Message* _msg)
+		{
+			releaseMessage(_msg);
+
+			BX_TRACE("Disconnect %d - Invalid fragment.", m_handle.idx);
+			disconnect(DisconnectReason::InvalidMessageId);
+			return NULL;
+		}
+
+		/// Views are released directly, since receive buffer is consumed
+		/// by connection.
+		void releaseMessage(Message* _msg)
+		{
+			if (0 != (getHeader(_msg)->flags & MessageFlags::View) )
+			{
+				releaseView(_msg);
+			}
+			else
+			{
+				release(_msg);
+			}
+		}
+
+		/// Disconnect marker waits until messages of all classes are sent.
+		bool isReady(uint32_t _priority)
+		{
+			Message* msg = m_queued[_priority].peek();
+			if (NULL == msg
+			||  Internal::Disconnect != getMarker(msg) )
+			{
+				return NULL != msg;
+			}
+
+			for (uint32_t ii = 0; ii < Priority::Count; ++ii)
+			{
+				if (ii != _priority
+				&&  NULL != m_queued[ii].peek() )
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		/// Messages are moved from priority class queues to outgoing queue
+		/// only when it's empty. Highest class with messages is served,
+		/// unless lower class was passed over BNET_CONFIG_PRIORITY_SHARE
+		/// times. At most BNET_CONFIG_PRIORITY_QUANTUM bytes, or single
+		/// fragment of large message, are moved at once, so message of
+		/// higher class waits for at most that much data.
+		Message* peekOutgoing()
+		{
+			Message* msg = m_outgoing.peek();
+			if (NULL != msg)
+			{
+				return msg;
+			}
+
+			uint32_t serve   = Priority::Count;
+			uint32_t starved = Priority::Count;
+			for (uint32_t ii = 0; ii < Priority::Count; ++ii)
+			{
+				if (isReady(ii) )
+				{
+					if (Priority::Count == serve)
+					{
+						serve = ii;
+					}
+					else if (Priority::Count == starved
+					     &&  BNET_CONFIG_PRIORITY_SHARE <= m_skipped[ii])
+					{
+						starved = ii;
+					}
+				}
+			}
+
+			if (Priority::Count == serve)
+			{
+				return NULL;
+			}
+
+			serve = Priority::Count != starved ? starved : serve;
+
+			for (uint32_t ii = 0; ii < Priority::Count; ++ii)
+			{
+				m_skipped[ii] = uint8_t(ii != serve && isReady(ii)
+					? bx::uint32_min(m_skipped[ii]+1, BNET_CONFIG_PRIORITY_SHARE)
+					: 0
+					);
+			}
+
+			MessageQueue& queue = m_queued[serve];
+			for (uint32_t size = 0; size < BNET_CONFIG_PRIORITY_QUANTUM;)
+			{
+				msg = queue.peek();
+				if (NULL == msg)
+				{
+					break;
+				}
+
+				const bool fragment = 0 != (getHeader(msg)->flags & MessageFlags::Stream);
+				if (0 != size
+				&&  (fragment || !isReady(serve) ) )
+				{
+					break;
+				}
+
+				m_outgoing.push(queue.pop() );
+				size += msg->size;
+
+				if (fragment)
+				{
+					break;
+				}
+			}
+
+			return m_outgoing.peek();
+		}
+
+		/// Returns false if connection was closed.
+		bool updateRecv()
+		{
+			int bytes;
+
+#if BNET_CONFIG_OPENSSL
+			if (NULL != m_ssl)
+			{
+				bytes = m_recv.recv(m_ssl);
+			}
+			else
+#endif // BNET_CONFIG_OPENSSL
+			{
+				bytes = m_recv.recv(m_socket);
+			}
+
+			++m_stats.recvCalls;
+			trackIncoming();
+
+#if BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+			// Edge is reported only once, keep reading until socket
+			// would block.
+			m_recvPending = 0 < bytes;
+#endif // BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+
+			if (1 > bytes)
+			{
+				if (0 == bytes)
+				{
+					BX_TRACE("Disconnect %d - Host closed connection.", m_handle.idx);
+					disconnect(DisconnectReason::HostClosed);
+					return false;
+				}
+				else if (!isWouldBlock() )
+				{
+					TRACE_SSL_ERROR();
+					BX_TRACE("Disconnect %d - Receive failed. %d", m_handle.idx, getLastError() );
+					disconnect(DisconnectReason::RecvFailed);
+					return false;
+				}
+
+				++m_stats.recvWouldBlock;
+			}
+			else
+			{
+				m_stats.bytesReceived += bytes;
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+				m_recvTime = bx::getHPCounter();
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+				touch();
+			}
+
+			return true;
+		}
+
+		void updateSocket()
+		{
+			if (updateTcpHandshake()
+			&&  updateSslHandshake() )
+			{
+				established();
+
+#if BNET_CONFIG_IO_URING
+				if (m_uring)
+				{
+					// I/O is driven by Context's io_uring engine, data
+					// that didn't fit into receive buffer is retried
+					// every tick.
+					if (0 != m_uringStashSize)
+					{
+						uringDrain();
+					}
+
+					return;
+				}
+#endif // BNET_CONFIG_IO_URING
+
+				if (!reserveIncoming() )
+				{
+					// Receive buffer is held by zero-copy messages, data
+					// stays in socket until they are released.
+#if BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+					m_recvPending = true;
+#endif // BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+				}
+				else if (!updateRecv() )
+				{
+					return;
+				}
+
+				if (!m_sslHandshake)
+				{
+#if BNET_CONFIG_GATHER_WRITE
+					if (!isSecure() )
+					{
+						sendGather();
+						return;
+					}
+#endif // BNET_CONFIG_GATHER_WRITE
+
+					if (m_raw)
+					{
+						for (Message* msg = peekOutgoing(); NULL != msg; msg = peekOutgoing() )
+						{
+							Internal::Enum id = getInternal(msg);
+							if (Internal::None != id)
+							{
+								if (!processInternal(id, msg) )
+								{
+									return;
+								}
+							}
+							else if (!send( (char*)msg->data, msg->size) )
+							{
+								return;
+							}
+
+							int64_t now = 0;
+							release(popOutgoing(now) );
+						}
+					}
+					else
+					{
+						for (Message* msg = peekOutgoing(); NULL != msg; msg = peekOutgoing() )
+						{
+							Internal::Enum id = getInternal(msg);
+							if (Internal::None != id)
+							{
+								*( (uint16_t*)msg->data - 1) = uint16_t(msg->size);
+								if (!processInternal(id, msg) )
+								{
+									return;
+								}
+							}
+							else
+							{
+								*( (uint16_t*)msg->data - 1) = bx::toLittleEndian(uint16_t(msg->size) );
+								if (!send( (char*)msg->data - 2, msg->size+2) )
+								{
+									return;
+								}
+							}
+
+							int64_t now = 0;
+							release(popOutgoing(now) );
+						}
+					}
+				}
+			}
+		}
+
+		Internal::Enum getInternal(Message* _msg) const
+		{
+			// Once frame is started, marker is overwritten by frame
+			// length.
+			return !m_sendPending
+				? getMarker(_msg)
+				: Internal::None
+				;
+		}
+
+		bool processInternal(Internal::Enum _id, Message* _msg)
+		{
+			switch (_id)
+			{
+			case Internal::Disconnect:
+				BX_TRACE("Disconnect %d - Client closed connection (finish).", m_handle.idx);
+				disconnect();
+				return false;
+
+			case Internal::Notify:
+				{
+					Message* msg = msgAlloc(m_ctx, _msg->handle, _msg->size+1, true);
+					msg->data[0] = MessageId::Notify;
+					memcpy(&msg->data[1], _msg->data, _msg->size);
+					ctxPush(m_ctx, msg);
+				}
+				return true;
+
+			default:
+				break;
+			}
+
+			BX_CHECK(false, "You shoud not be here!");
+			return true;
+		}
+
+		bool updateTcpHandshake()
+		{
+			if (!m_tcpHandshake)
+			{
+				return true;
+			}
+
+			if (NULL != m_race)
+			{
+				return updateRace(bx::getHPCounter() );
+			}
+
+			const int32_t status = getConnectStatus(m_socket);
+			if (0 > status)
+			{
+				BX_TRACE("Disconnect %d - Connect failed.", m_handle.idx);
+				connectFailed(ConnectFailure::Error);
+				return false;
+			}
+
+			m_tcpHandshake = 0 == status;
+			return !m_tcpHandshake;
+		}
+
+		/// Returns socket of started connect, or INVALID_SOCKET if connect
+		/// failed immediately.
+		static SOCKET connectAddress(const Address& _addr, uint16_t _port, bool _ssl)
+		{
+			const bool ipv6 = AddressFamily::Ipv6 == _addr.family;
+
+			SOCKET sock = ::socket(ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM, IPPROTO_TCP);
+			if (INVALID_SOCKET == sock)
+			{
+				return INVALID_SOCKET;
+			}
+
+			setSockOpts(sock);
+			setNonBlock(sock);
+
+			int err;
+			if (ipv6)
+			{
+				sockaddr_in6 addr;
+				memset(&addr, 0, sizeof(addr) );
+				addr.sin6_family = AF_INET6;
+				addr.sin6_port = htons(_port);
+				memcpy(&addr.sin6_addr, _addr.data, sizeof(addr.sin6_addr) );
+				err = ::connect(sock, (const sockaddr*)&addr, sizeof(addr) );
+			}
+			else
+			{
+				uint32_t ip;
+				memcpy(&ip, _addr.data, sizeof(ip) );
+				err = connectsocket(sock, ntohl(ip), _port, _ssl);
+			}
+
+			if (0 != err
+			&&  !(isInProgress() || isWouldBlock() ) )
+			{
+				::closesocket(sock);
+				return INVALID_SOCKET;
+			}
+
+			return sock;
+		}
+
+		/// Starts connects until one is in progress, and returns its
+		/// socket.
+		SOCKET startRace(uint64_t _now)
+		{
+			while (m_race->started < m_race->num)
+			{
+				const uint8_t idx = m_race->started++;
+				SOCKET sock = connectAddress(m_race->addrs[idx], m_race->port, m_race->secure);
+				m_race->sockets[idx] = sock;
+
+				if (INVALID_SOCKET != sock)
+				{
+					m_race->nextStart = _now + msToTicks(BNET_CONFIG_CONNECT_STAGGER_MS);
+					return sock;
+				}
+			}
+
+			return INVALID_SOCKET;
+		}
+
+		bool updateRace(uint64_t _now)
+		{
+			SOCKET live = INVALID_SOCKET;
+
+			for (uint32_t ii = 0; ii < m_race->started; ++ii)
+			{
+				SOCKET sock = m_race->sockets[ii];
+				if (INVALID_SOCKET == sock)
+				{
+					continue;
+				}
+
+				const int32_t status = getConnectStatus(sock);
+				if (0 < status)
+				{
+					const bool rewatch = ii != m_race->watched;
+					finishRace(sock);
+
+					m_socket = sock;
+					m_tcpHandshake = false;
+#if BNET_CONFIG_OPENSSL
+					if (NULL != m_ssl)
+					{
+						SSL_set_fd(m_ssl, (int)m_socket);
+					}
+#endif // BNET_CONFIG_OPENSSL
+
+					if (rewatch)
+					{
+						// Socket that was watched is closed, and removed
+						// from poller with it.
+						ctxWatch(m_ctx, m_handle);
+					}
+					return true;
+				}
+
+				if (0 > status)
+				{
+					::closesocket(sock);
+					m_race->sockets[ii] = INVALID_SOCKET;
+					continue;
+				}
+
+				live = INVALID_SOCKET == live ? sock : live;
+			}
+
+			if (INVALID_SOCKET == live
+			||  _now >= m_race->nextStart)
+			{
+				SOCKET sock = startRace(_now);
+				live = INVALID_SOCKET == live ? sock : live;
+			}
+
+			if (INVALID_SOCKET == live)
+			{
+				BX_TRACE("Disconnect %d - Connect failed on all addresses.", m_handle.idx);
+				m_socket = INVALID_SOCKET;
+				finishRace(INVALID_SOCKET);
+				connectFailed(ConnectFailure::Error);
+				return false;
+			}
+
+			// Connection socket is always one of sockets in race, so it's
+			// closed with connection.
+			m_socket = live;
+			return false;
+		}
+
+		/// Closes all sockets in race, except _keep.
+		void finishRace(SOCKET _keep)
+		{
+			if (NULL == m_race)
+			{
+				return;
+			}
+
+			for (uint32_t ii = 0; ii < m_race->started; ++ii)
+			{
+				if (INVALID_SOCKET != m_race->sockets[ii]
+				&&  _keep != m_race->sockets[ii])
+				{
+					::closesocket(m_race->sockets[ii]);
+				}
+			}
+
+			BX_DELETE(ctxAllocator(m_ctx), m_race);
+			m_race = NULL;
+		}
+
+		bool updateSslHandshake()
+		{
+#if BNET_CONFIG_OPENSSL
+			if (NULL != m_ssl
+			&&  m_sslHandshake)
+			{
+				int err = SSL_do_handshake(m_ssl);
+
+				if (1 == err)
+				{
+					m_sslHandshake = false;
+#	if BNET_CONFIG_DEBUG
+					X509* cert = SSL_get_peer_certificate(m_ssl);
+					BX_TRACE("Server certificate:");
+
+					char* temp;
+					temp = X509_NAME_oneline(X509_get_subject_name(cert), 0, 0);
+					BX_TRACE("\t subject: %s", temp);
+					OPENSSL_free(temp);
+
+					temp = X509_NAME_oneline(X509_get_issuer_name(cert), 0, 0);
+					BX_TRACE("\t issuer: %s", temp);
+					OPENSSL_free(temp);
+
+					X509_free(cert);
+#	endif // BNET_CONFIG_DEBUG
+
+					long result = SSL_get_verify_result(m_ssl);
+					if (X509_V_OK != result)
+					{
+						BX_TRACE("Disconnect %d - SSL verify failed %d.", m_handle.idx, result);
+						connectFailed(ConnectFailure::Handshake);
+						return false;
+					}
+
+					BX_TRACE("SSL connection using %s", SSL_get_cipher(m_ssl) );
+				}
+				else
+				{
+					int sslError = SSL_get_error(m_ssl, err);
+					switch (sslError)
+					{
+					case SSL_ERROR_WANT_READ:
+						SSL_read(m_ssl, NULL, 0);
+						break;
+
+					case SSL_ERROR_WANT_WRITE:
+						SSL_write(m_ssl, NULL, 0);
+						break;
+
+					default:
+						TRACE_SSL_ERROR();
+						break;
+					}
+				}
+			}
+#endif // BNET_CONFIG_OPENSSL
+
+			return true;
+		}
+
+		/// Writes frame starting from m_sendOffset. Returns true when
+		/// whole frame is written. If socket would block, written offset
+		/// is kept and frame is resumed on next update.
+		bool send(const char* _data, uint32_t _len)
+		{
+			while (m_sendOffset < _len)
+			{
+				int bytes;
+				bool wouldBlock;
+
+#if BNET_CONFIG_OPENSSL
+				if (NULL != m_ssl)
+				{
+					// SSL_write must be retried with the same arguments,
+					// frame stays in place until it's fully written.
+					bytes = SSL_write(m_ssl
+						, &_data[m_sendOffset]
+						, _len - m_sendOffset
+						);
+					int sslError = 0 < bytes ? SSL_ERROR_NONE : SSL_get_error(m_ssl, bytes);
+					wouldBlock = SSL_ERROR_WANT_WRITE == sslError
+						|| SSL_ERROR_WANT_READ == sslError
+						;
+				}
+				else
+#endif // BNET_CONFIG_OPENSSL
+				{
+					bytes = ::send(m_socket
+						, &_data[m_sendOffset]
+						, _len - m_sendOffset
+						, 0
+						);
+					wouldBlock = 0 > bytes && isWouldBlock();
+				}
+
+				++m_stats.sendCalls;
+
+				if (0 >= bytes)
+				{
+					if (wouldBlock)
+					{
+						++m_stats.sendWouldBlock;
+						m_sendPending = true;
+						return false;
+					}
+
+					TRACE_SSL_ERROR();
+					BX_TRACE("Disconnect %d - Send failed. %d", m_handle.idx, getLastError() );
+					disconnect(DisconnectReason::SendFailed);
+					return false;
+				}
+
+				m_sendOffset += bytes;
+				m_stats.bytesSent += bytes;
+			}
+
+			++m_stats.messagesSent;
+			m_sendOffset  = 0;
+			m_sendPending = false;
+			return true;
+		}
+
+#if BNET_CONFIG_GATHER_WRITE
+		/// Writes queued frames up to next internal marker with single
+		/// sendmsg. Returns false if socket would block or connection
+		/// was closed.
+		bool sendGather()
+		{
+			Message* msgs[BNET_CONFIG_MAX_GATHER_FRAMES];
+			iovec iov[BNET_CONFIG_MAX_GATHER_FRAMES];
+
+			for (;;)
+			{
+				peekOutgoing();
+				uint32_t num = m_outgoing.peek(msgs, BX_COUNTOF(msgs) );
+				if (0 == num)
+				{
+					return true;
+				}
+
+				Internal::Enum id = getInternal(msgs[0]);
+				if (Internal::None != id)
+				{
+					if (!m_raw)
+					{
+						*( (uint16_t*)msgs[0]->data - 1) = uint16_t(msgs[0]->size);
+					}
+
+					if (!processInternal(id, msgs[0]) )
+					{
+						return false;
+					}
+
+					int64_t now = 0;
+					release(popOutgoing(now) );
+					continue;
+				}
+
+				uint32_t numIov = 0;
+				uint32_t total  = 0;
+				for (; numIov < num; ++numIov)
+				{
+					Message* msg = msgs[numIov];
+					if (0 != numIov
+					&&  (Internal::None != getMarker(msg) || BNET_CONFIG_MAX_GATHER_SIZE <= total) )
+					{
+						// Markers are processed only after all prior
+						// frames are sent.
+						break;
+					}
+
+					if (!m_raw)
+					{
+						*( (uint16_t*)msg->data - 1) = bx::toLittleEndian(uint16_t(msg->size) );
+					}
+
+					uint32_t offset = 0 == numIov ? m_sendOffset : 0;
+					iov[numIov].iov_base = (void*)(getFrame(msg) + offset);
+					iov[numIov].iov_len  = getFrameSize(msg) - offset;
+					total += uint32_t(iov[numIov].iov_len);
+				}
+
+				msghdr hdr;
+				memset(&hdr, 0, sizeof(hdr) );
+				hdr.msg_iov    = iov;
+				hdr.msg_iovlen = numIov;
+
+				ssize_t bytes = ::sendmsg(m_socket, &hdr, 0);
+				++m_stats.sendCalls;
+				if (0 > bytes)
+				{
+					restoreMarkers(msgs, 1, numIov);
+
+					if (isWouldBlock() )
+					{
+						++m_stats.sendWouldBlock;
+						m_sendPending = true;
+						return false;
+					}
+
+					BX_TRACE("Disconnect %d - Send failed. %d", m_handle.idx, getLastError() );
+					disconnect(DisconnectReason::SendFailed);
+					return false;
+				}
+
+				uint32_t ii = 0;
+				uint32_t size = uint32_t(bytes);
+				int64_t now = 0;
+				m_stats.bytesSent += size;
+				for (; ii < numIov && iov[ii].iov_len <= size; ++ii)
+				{
+					size -= uint32_t(iov[ii].iov_len);
+					m_sendOffset = 0;
+					release(popOutgoing(now) );
+				}
+
+				m_stats.messagesSent += ii;
+
+				if (ii < numIov)
+				{
+					// First unsent frame has its length prefix written
+					// and is resumed from offset, frames behind it are
+					// framed again on next write.
+					m_sendOffset += size;
+					m_sendPending = true;
+					restoreMarkers(msgs, ii+1, numIov);
+				}
+				else
+				{
+					m_sendPending = false;
+				}
+			}
+		}
+
+		void restoreMarkers(Message** _msgs, uint32_t _first, uint32_t _num)
+		{
+			for (uint32_t ii = _first; ii < _num; ++ii)
+			{
+				if (0 == (getHeader(_msgs[ii])->flags & MessageFlags::Shared) )
+				{
+					*(_msgs[ii]->data - 2) = Internal::None;
+				}
+			}
+		}
+#endif // BNET_CONFIG_GATHER_WRITE
+
+#if BNET_CONFIG_UDP
+		void initUdp(Handle _listenHandle, uint32_t _ip, uint16_t _port)
+		{
+			if (NULL == m_udp)
+			{
+				m_udp = BX_NEW(ctxAllocator(m_ctx), UdpState);
+			}
+			else
+			{
+				m_udp->~UdpState();
+				::new (m_udp) UdpState;
+			}
+
+			m_udp->listenHandle = _listenHandle;
+			m_udp->ip   = _ip;
+			m_udp->port = _port;
+		}
+
+		/// Tells peer connection is closed, and releases messages held by
+		/// send and receive windows.
+		void disconnectUdp()
+		{
+			if (INVALID_SOCKET != m_socket)
+			{
+				const uint8_t kind = UdpKind::Disconnect;
+				::send(m_socket, (const char*)&kind, 1, 0);
+			}
+
+			for (uint32_t ii = 0; ii < BNET_CONFIG_UDP_WINDOW; ++ii)
+			{
+				if (NULL != m_udp->sent[ii].msg)
+				{
+					release(m_udp->sent[ii].msg);
+					m_udp->sent[ii].msg = NULL;
+				}
+
+				if (NULL != m_udp->received[ii])
+				{
+					release(m_udp->received[ii]);
+					m_udp->received[ii] = NULL;
+				}
+			}
+
+			for (Message* msg = m_udp->waiting.pop(); NULL != msg; msg = m_udp->waiting.pop() )
+			{
+				release(msg);
+			}
+		}
+
+		void updateUdp()
+		{
+			const uint64_t now = bx::getHPCounter();
+			if (recvUdp(now) )
+			{
+				tickUdp(now);
+			}
+		}
+
+		/// Resends handshake or unacknowledged messages, sends queued
+		/// ones, and rearms timer for next resend, keepalive or timeout.
+		void tickUdp(uint64_t _now)
+		{
+			if (m_tcpHandshake)
+			{
+				// Connect is resent until host accepts it.
+				if (_now - m_udp->lastSend >= msToTicks(BNET_CONFIG_UDP_RESEND_MS) )
+				{
+					uint8_t connect[UdpConnectSize] = { UdpKind::Connect };
+					const uint32_t magic = bx::toLittleEndian(UdpMagic);
+					memcpy(&connect[1], &magic, sizeof(magic) );
+					memcpy(&connect[5], &m_udp->cookie, sizeof(m_udp->cookie) );
+					::send(m_socket, (const char*)connect, sizeof(connect), 0);
+					m_udp->lastSend = _now;
+				}
+
+				scheduleUdp(_now);
+				return;
+			}
+
+			established();
+
+			if (_now - m_udp->lastRecv > msToTicks(BNET_CONFIG_UDP_TIMEOUT_SECONDS*1000) )
+			{
+				BX_TRACE("Disconnect %d - Timeout.", m_handle.idx);
+				disconnect(DisconnectReason::Timeout);
+				return;
+			}
+
+			sendUdp(_now);
+
+			if (INVALID_SOCKET != m_socket)
+			{
+				scheduleUdp(_now);
+			}
+		}
+
+		/// Timer expires at earliest of handshake resend, reliable
+		/// message resend, keepalive, and timeout.
+		void scheduleUdp(uint64_t _now)
+		{
+			const UdpState& udp = *m_udp;
+
+			uint64_t next;
+			if (m_tcpHandshake)
+			{
+				next = udp.lastSend + msToTicks(BNET_CONFIG_UDP_RESEND_MS);
+			}
+			else
+			{
+				next = udp.lastSend + msToTicks(BNET_CONFIG_UDP_KEEPALIVE_MS);
+
+				const uint64_t timeout = udp.lastRecv + msToTicks(BNET_CONFIG_UDP_TIMEOUT_SECONDS*1000) + 1;
+				next = timeout < next ? timeout : next;
+				next = udp.resendTime < next ? udp.resendTime : next;
+			}
+
+			// Rounded up, so timer never expires before deadline.
+			const uint64_t wait = next > _now ? next - _now : 0;
+			ctxTimers(m_ctx).add(&m_udpTimer, uint32_t(wait*1000/bx::getHPFrequency() ) + 1);
+		}
+
+		/// Returns false if connection was closed.
+		bool recvUdp(uint64_t _now)
+		{
+			UdpBatch& batch = ctxUdpBatch(m_ctx);
+
+			for (;;)
+			{
+				int num = batch.recv(m_socket);
+				++m_stats.recvCalls;
+				if (0 > num)
+				{
+					if (isWouldBlock()
+					||  EINTR == getLastError() )
+					{
+						++m_stats.recvWouldBlock;
+						return true;
+					}
+
+					// Connected socket reports ICMP port unreachable from
+					// host.
+					BX_TRACE("Disconnect %d - Receive failed. %d", m_handle.idx, getLastError() );
+					if (m_tcpHandshake)
+					{
+						connectFailed(ConnectFailure::Error);
+					}
+					else
+					{
+						disconnect(DisconnectReason::RecvFailed);
+					}
+					return false;
+				}
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+				m_recvTime = bx::getHPCounter();
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+				for (int ii = 0; ii < num; ++ii)
+				{
+					m_stats.bytesReceived += batch.getSize(ii);
+					if (!recvDatagram(batch.getData(ii), batch.getSize(ii), _now) )
+					{
+						return false;
+					}
+				}
+
+				if (BNET_CONFIG_UDP_BATCH != num)
+				{
+					return true;
+				}
+			}
+		}
+
+		/// Returns false if connection was closed.
+		bool recvDatagram(const uint8_t* _data, uint32_t _size, uint64_t _now)
+		{
+			if (0 == _size)
+			{
+				return true;
+			}
+
+			switch (_data[0])
+			{
+			case UdpKind::Connect:
+				if (isValid(m_udp->listenHandle) )
+				{
+					// Accept was lost, and peer resent connect.
+					m_udp->acceptPending = true;
+					m_udp->lastRecv = _now;
+				}
+				return true;
+
+			case UdpKind::Accept:
+				m_tcpHandshake = false;
+				m_udp->lastRecv = _now;
+				return true;
+
+			case UdpKind::Challenge:
+				if (m_tcpHandshake
+				&&  UdpChallengeSize == _size)
+				{
+					// Cookie is opaque to peer, connect is resent with it
+					// right away.
+					memcpy(&m_udp->cookie, &_data[1], sizeof(m_udp->cookie) );
+					m_udp->lastSend = 0;
+				}
+				return true;
+
+			case UdpKind::Disconnect:
+				BX_TRACE("Disconnect %d - Host closed connection.", m_handle.idx);
+				disconnect(DisconnectReason::HostClosed);
+				return false;
+
+			case UdpKind::Ack:
+				if (4 <= _size
+				&&  _data[3] <= UdpAckBitsSize
+				&&  4u + _data[3] == _size)
+				{
+					m_udp->lastRecv = _now;
+					ackUdp(readUint16(&_data[1]), &_data[4], _data[3]);
+				}
+				return true;
+
+			case UdpKind::Data:
+				break;
+
+			default:
+				return true;
+			}
+
+			if (UdpAckHeaderSize > _size)
+			{
+				return true;
+			}
+
+			// Data from host also means accept was lost.
+			m_tcpHandshake = false;
+			m_udp->lastRecv = _now;
+			touch();
+
+			ackUdp(readUint16(&_data[1]), &_data[3], 4);
+
+			for (uint32_t offset = UdpAckHeaderSize; offset + UdpRecordHeaderSize <= _size;)
+			{
+				const uint8_t channel = _data[offset];
+				const uint16_t seq  = readUint16(&_data[offset+1]);
+				const uint16_t size = readUint16(&_data[offset+3]);
+				offset += UdpRecordHeaderSize;
+
+				if (0 == size
+				||  size > _size - offset
+				||  Channel::Count <= channel)
+				{
+					// Malformed datagram, rest of it is ignored.
+					return true;
+				}
+
+				const uint8_t* data = &_data[offset];
+				offset += size;
+
+				if (data[0] < MessageId::UserDefined)
+				{
+					BX_TRACE("Disconnect %d - Invalid message id.", m_handle.idx);
+					disconnect(DisconnectReason::InvalidMessageId);
+					return false;
+				}
+
+				switch (channel)
+				{
+				case Channel::Unreliable:
+					pushReceived(allocUdp(data, size) );
+					break;
+
+				case Channel::UnreliableSequenced:
+					// Older message than already delivered one is stale.
+					if (seqGreater(seq, m_udp->recvSequenced) )
+					{
+						m_udp->recvSequenced = seq;
+						pushReceived(allocUdp(data, size) );
+					}
+					break;
+
+				default:
+					recvReliable(seq, data, size);
+					break;
+				}
+			}
+
+			return true;
+		}
+
+		Message* allocUdp(const uint8_t* _data, uint16_t _size)
+		{
+			Message* msg = msgAlloc(m_ctx, m_handle, _size, true);
+			memcpy(msg->data, _data, _size);
+			return msg;
+		}
+
+		/// Reliable messages received ahead of order are kept until
+		/// missing ones arrive.
+		void recvReliable(uint16_t _seq, const uint8_t* _data, uint16_t _size)
+		{
+			UdpState& udp = *m_udp;
+			udp.ackPending = true;
+
+			const int16_t ahead = int16_t(_seq - udp.recvSeq);
+			if (0 > ahead
+			||  BNET_CONFIG_UDP_WINDOW <= ahead)
+			{
+				// Duplicate, or beyond receive window.
+				return;
+			}
+
+			if (0 != ahead)
+			{
+				if (seqGreater(_seq, udp.recvNewest) )
+				{
+					udp.recvNewest = _seq;
+				}
+
+				Message*& slot = udp.received[_seq % BNET_CONFIG_UDP_WINDOW];
+				if (NULL == slot)
+				{
+					slot = allocUdp(_data, _size);
+				}
+				return;
+			}
+
+			pushReceived(allocUdp(_data, _size) );
+
+			for (++udp.recvSeq;; ++udp.recvSeq)
+			{
+				Message*& slot = udp.received[udp.recvSeq % BNET_CONFIG_UDP_WINDOW];
+				if (NULL == slot)
+				{
+					break;
+				}
+
+				pushReceived(slot);
+				slot = NULL;
+			}
+		}
+
+		/// Peer received all reliable messages before _ack, and ones
+		/// after it marked in _bits, little endian bit per message.
+		void ackUdp(uint16_t _ack, const uint8_t* _bits, uint32_t _size)
+		{
+			UdpState& udp = *m_udp;
+			if (seqGreater(_ack, udp.sendSeq) )
+			{
+				return;
+			}
+
+			for (; seqGreater(_ack, udp.sendBase); ++udp.sendBase)
+			{
+				releaseSent(udp.sendBase);
+			}
+
+			for (uint32_t ii = 0, num = _size*8; ii < num; ++ii)
+			{
+				const uint16_t seq = uint16_t(_ack + 1 + ii);
+				if (0 != (_bits[ii/8] & (1<<(ii%8) ) )
+				&&  !seqGreater(udp.sendBase, seq)
+				&&  seqGreater(udp.sendSeq, seq) )
+				{
+					releaseSent(seq);
+				}
+			}
+
+			while (udp.sendBase != udp.sendSeq
+			&&     NULL == udp.sent[udp.sendBase % BNET_CONFIG_UDP_WINDOW].msg)
+			{
+				++udp.sendBase;
+			}
+		}
+
+		void releaseSent(uint16_t _seq)
+		{
+			UdpSent& sent = m_udp->sent[_seq % BNET_CONFIG_UDP_WINDOW];
+			if (NULL != sent.msg)
+			{
+				release(sent.msg);
+				sent.msg = NULL;
+			}
+		}
+
+		bool isSendWindowFull() const
+		{
+			return BNET_CONFIG_UDP_WINDOW <= uint16_t(m_udp->sendSeq - m_udp->sendBase);
+		}
+
+		/// Sends queued messages, resends unacknowledged ones, and
+		/// acknowledges received ones, batched into datagrams.
+		void sendUdp(uint64_t _now)
+		{
+			UdpState& udp = *m_udp;
+
+			if (udp.acceptPending)
+			{
+				const uint8_t kind = UdpKind::Accept;
+				::send(m_socket, (const char*)&kind, 1, 0);
+				udp.acceptPending = false;
+			}
+
+			uint8_t header[UdpAckHeaderSize];
+			header[0] = UdpKind::Data;
+			writeUint16(&header[1], udp.recvSeq);
+
+			uint32_t ackBits = 0;
+			for (uint32_t ii = 0; ii < 32; ++ii)
+			{
+				if (NULL != udp.received[(udp.recvSeq + 1 + ii) % BNET_CONFIG_UDP_WINDOW])
+				{
+					ackBits |= UINT32_C(1) << ii;
+				}
+			}
+			ackBits = bx::toLittleEndian(ackBits);
+			memcpy(&header[3], &ackBits, sizeof(ackBits) );
+
+			UdpBatch& batch = ctxUdpBatch(m_ctx);
+			batch.begin(header, sizeof(header) );
+
+			const uint64_t resend = msToTicks(BNET_CONFIG_UDP_RESEND_MS);
+			if (_now >= udp.resendTime)
+			{
+				udp.resendTime = UINT64_MAX;
+				for (uint16_t seq = udp.sendBase; seq != udp.sendSeq; ++seq)
+				{
+					UdpSent& sent = udp.sent[seq % BNET_CONFIG_UDP_WINDOW];
+					if (NULL != sent.msg)
+					{
+						if (_now - sent.time >= resend)
+						{
+							appendUdp(batch, Channel::ReliableOrdered, seq, sent.msg, _now);
+							sent.time = _now;
+						}
+
+						if (sent.time + resend < udp.resendTime)
+						{
+							udp.resendTime = sent.time + resend;
+						}
+					}
+				}
+			}
+
+			while (NULL != udp.waiting.peek()
+			&&     !isSendWindowFull() )
+			{
+				sendQueued(batch, udp.waiting.pop(), _now);
+			}
+
+			for (Message* msg = m_outgoing.pop(); NULL != msg; msg = m_outgoing.pop() )
+			{
+				// Only reliable messages and markers wait for window, so
+				// unreliable ones are never delayed by lost datagrams.
+				if (Channel::ReliableOrdered == getChannel(msg)
+				&&  (NULL != udp.waiting.peek() || isSendWindowFull() ) )
+				{
+					udp.waiting.push(msg);
+				}
+				else
+				{
+					sendQueued(batch, msg, _now);
+				}
+			}
+
+			if (udp.ackPending
+			||  _now - udp.lastSend >= msToTicks(BNET_CONFIG_UDP_KEEPALIVE_MS) )
+			{
+				batch.appendHeader();
+			}
+
+			if (udp.ackPending)
+			{
+				sendAckUdp();
+			}
+
+			flushUdp(batch, _now);
+
+			if (udp.finish
+			&&  udp.sendBase == udp.sendSeq
+			&&  NULL == udp.waiting.peek() )
+			{
+				BX_TRACE("Disconnect %d - Client closed connection (finish).", m_handle.idx);
+				disconnect();
+			}
+		}
+
+		/// Ack bits of data header cover only 32 messages after ack. When
+		/// messages beyond that were received, separate ack covering them
+		/// is sent, so they are not resent after single lost datagram.
+		void sendAckUdp()
+		{
+			const UdpState& udp = *m_udp;
+			const int16_t span = int16_t(udp.recvNewest - udp.recvSeq);
+			if (32 >= span)
+			{
+				return;
+			}
+
+			uint8_t ack[4 + UdpAckBitsSize];
+			const uint32_t size = bx::uint32_min( (uint32_t(span) + 7)/8, UdpAckBitsSize);
+			ack[0] = UdpKind::Ack;
+			writeUint16(&ack[1], udp.recvSeq);
+			ack[3] = uint8_t(size);
+			memset(&ack[4], 0, size);
+
+			for (uint32_t ii = 0, num = size*8; ii < num; ++ii)
+			{
+				if (NULL != udp.received[(udp.recvSeq + 1 + ii) % BNET_CONFIG_UDP_WINDOW])
+				{
+					ack[4 + ii/8] |= uint8_t(1<<(ii%8) );
+				}
+			}
+
+			::send(m_socket, (const char*)ack, 4 + size, 0);
+			m_stats.bytesSent += 4 + size;
+		}
+
+		void sendQueued(UdpBatch& _batch, Message* _msg, uint64_t _now)
+		{
+			int64_t now = int64_t(_now);
+			dequeue(_msg, now);
+
+			switch (getMarker(_msg) )
+			{
+			case Internal::Disconnect:
+				// Connection is closed once all reliable messages are
+				// acknowledged.
+				m_udp->finish = true;
+				release(_msg);
+				return;
+
+			case Internal::Notify:
+				processInternal(Internal::Notify, _msg);
+				release(_msg);
+				return;
+
+			default:
+				break;
+			}
+
+			if (UdpMaxMessageSize < _msg->size)
+			{
+				BX_TRACE("Message size %d exceeds UDP datagram.", _msg->size);
+				release(_msg);
+				return;
+			}
+
+			++m_stats.messagesSent;
+
+			const Channel::Enum channel = getChannel(_msg);
+			switch (channel)
+			{
+			case Channel::Unreliable:
+				appendUdp(_batch, channel, 0, _msg, _now);
+				release(_msg);
+				break;
+
+			case Channel::UnreliableSequenced:
+				appendUdp(_batch, channel, m_udp->sendSequenced++, _msg, _now);
+				release(_msg);
+				break;
+
+			default:
+				{
+					const uint16_t seq = m_udp->sendSeq++;
+					UdpSent& sent = m_udp->sent[seq % BNET_CONFIG_UDP_WINDOW];
+					sent.msg  = _msg;
+					sent.time = _now;
+					if (_now + msToTicks(BNET_CONFIG_UDP_RESEND_MS) < m_udp->resendTime)
+					{
+						m_udp->resendTime = _now + msToTicks(BNET_CONFIG_UDP_RESEND_MS);
+					}
+					appendUdp(_batch, channel, seq, _msg, _now);
+				}
+				break;
+			}
+		}
+
+		void appendUdp(UdpBatch& _batch, Channel::Enum _channel, uint16_t _seq, Message* _msg, uint64_t _now)
+		{
+			const uint32_t size = UdpRecordHeaderSize + _msg->size;
+
+			uint8_t* record = _batch.append(size);
+			if (NULL == record)
+			{
+				flushUdp(_batch, _now);
+				record = _batch.append(size);
+			}
+
+			record[0] = uint8_t(_channel);
+			writeUint16(&record[1], _seq);
+			writeUint16(&record[3], uint16_t(_msg->size) );
+			memcpy(&record[UdpRecordHeaderSize], _msg->data, _msg->size);
+		}
+
+		void flushUdp(UdpBatch& _batch, uint64_t _now)
+		{
+			if (!_batch.isEmpty() )
+			{
+				m_stats.bytesSent += _batch.send(m_socket);
+				++m_stats.sendCalls;
+				m_udp->lastSend   = _now;
+				m_udp->ackPending = false;
+			}
+		}
+#endif // BNET_CONFIG_UDP
+
+		const uint8_t* getFrame(Message* _msg) const
+		{
+			return m_raw ? _msg->data : _msg->data - 2;
+		}
+
+		uint32_t getFrameSize(Message* _msg) const
+		{
+			return m_raw ? _msg->size : _msg->size + 2;
+		}
+
+		Context* m_ctx;
+		Timer m_connectTimer;
+		Timer m_idleTimer;
+		uint64_t m_idleTicks;
+		uint64_t m_lastRecv; // Timer wheel tick.
+		SOCKET m_socket;
+		Handle m_handle;
+		uint8_t* m_incomingBuffer;
+		bx::RingBufferControl m_incoming;
+		RecvRingBuffer m_recv;
+		MessageQueue m_outgoing;
+		MessageQueue m_queued[Priority::Count];
+		uint8_t m_skipped[Priority::Count]; // Times class was passed over.
+#if BNET_CONFIG_OPENSSL
+		SSL* m_ssl;
+#endif // BNET_CONFIG_OPENSSL
+
+		Message* m_viewHead;
+		Message* m_viewTail;
+		Message* m_assembly;
+		uint32_t m_assemblyOffset;
+		uint32_t m_assemblyMax;
+		uint32_t m_incomingSize; // Size of next receive buffer.
+		uint32_t m_incomingPeak; // Most data held by current buffer.
+		uint32_t m_parse;
+		int m_len;
+		bool m_raw;
+		bool m_zeroCopy;
+		bool m_viewSlack;
+		bool m_destroyPending;
+		bool m_tcpHandshake;
+		bool m_sslHandshake;
+		bool m_recvPending;
+		bool m_sendPending;
+		bool m_sendFull; // SendQueueFull was sent, waiting for low watermark.
+		uint8_t m_sendPolicy;
+		uint32_t m_sendOffset;
+		uint32_t m_sendQueued; // Bytes of messages not handed to socket yet.
+		uint32_t m_sendQueuedNum;
+		uint32_t m_sendLow;
+		uint32_t m_sendHigh;
+		uint32_t m_sendLimit;
+		CompressionState m_compression;
+		TrafficStats m_stats; // Counters only, gauges are filled by `getStats`.
+		int64_t m_connectStart;
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		Histogram* m_sendLatency; // Allocated once first message is measured.
+		int64_t m_recvTime; // Time of last receive, frames completed by it are stamped with it.
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+		ConnectRace* m_race;
+
+#if BNET_CONFIG_IO_URING
+		MessageQueue m_inflight;
+		bool m_uring;
+		bool m_sendFailed;
+		uint16_t m_numInflight;
+		uint8_t* m_uringStash; // Received data that didn't fit into receive buffer.
+		uint32_t m_uringStashSize;
+#endif // BNET_CONFIG_IO_URING
+
+#if BNET_CONFIG_UDP
+		UdpState* m_udp;
+		Timer m_udpTimer;
+#endif // BNET_CONFIG_UDP
+	};
+
+	typedef FreeList<Connection> Connections;
+
+	class ListenSocket
+	{
+	public:
+		ListenSocket(Context* _ctx)
+			: m_ctx(_ctx)
+			, m_socket(INVALID_SOCKET)
+			, m_handle(invalidHandle)
+			, m_raw(false)
+			, m_secure(false)
+			, m_udp(false)
+			, m_cert(NULL)
+			, m_key(NULL)
+		{
+		}
+
+		~ListenSocket()
+		{
+			close();
+		}
+
+		void close()
+		{
+			if (INVALID_SOCKET != m_socket)
+			{
+				::closesocket(m_socket);
+				m_socket = INVALID_SOCKET;
+			}
+
+#if BNET_CONFIG_OPENSSL
+			if (NULL != m_cert)
+			{
+				X509_free(m_cert);
+				m_cert = NULL;
+			}
+
+			if (NULL != m_key)
+			{
+				EVP_PKEY_free(m_key);
+				m_key = NULL;
+			}
+#endif // BNET_CONFIG_OPENSSL
+		}
+
+		void listen(Handle _handle, uint32_t _ip, uint16_t _port, bool _raw, const char* _cert, const char* _key, bool _shared = false, uint16_t _numShards = 0)
+		{
+			m_handle = _handle;
+			m_raw = _raw;
+
+#if BNET_CONFIG_OPENSSL
+			if (NULL != _cert)
+			{
+				BIO* mem = BIO_new_mem_buf(const_cast<char*>(_cert), -1);
+				m_cert = PEM_read_bio_X509(mem, NULL, NULL, NULL);
+				BIO_free(mem);
+			}
+
+			if (NULL != _key)
+			{
+				BIO* mem = BIO_new_mem_buf(const_cast<char*>(_key), -1);
+				m_key = PEM_read_bio_PrivateKey(mem, NULL, NULL, NULL);
+				BIO_free(mem);
+			}
+
+			m_secure = NULL != m_key && NULL != m_cert;
+#endif // BNET_CONFIG_OPENSSL
+
+			if (!m_secure
+			&&  (NULL != _cert || NULL != _key) )
+			{
+#if BNET_CONFIG_OPENSSL
+				BX_TRACE("Certificate of key is not set correctly.");
+#else
+				BX_TRACE("BNET_CONFIG_OPENSSL is not enabled.");
+#endif // BNET_CONFIG_OPENSSL
+				ctxPush(m_ctx, m_handle, MessageId::ListenFailed);
+				return;
+			}
+
+			m_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+			if (INVALID_SOCKET == m_socket)
+			{
+				BX_TRACE("Create socket failed.");
+				ctxPush(m_ctx, m_handle, MessageId::ListenFailed);
+				return;
+			}
+			setSockOpts(m_socket);
+
+			if (_shared
+			&&  !setReusePort() )
+			{
+				::closesocket(m_socket);
+				m_socket = INVALID_SOCKET;
+
+				BX_TRACE("SO_REUSEPORT is not supported.");
+				ctxPush(m_ctx, m_handle, MessageId::ListenFailed);
+				return;
+			}
+
+			m_addr.sin_family = AF_INET;
+			m_addr.sin_addr.s_addr = htonl(_ip);
+			m_addr.sin_port = htons(_port);
+
+			if (SOCKET_ERROR == ::bind(m_socket, (sockaddr*)&m_addr, sizeof(m_addr) )
+			||  SOCKET_ERROR == ::listen(m_socket, SOMAXCONN)
+			||  (0 != _numShards && !setCpuSteering(_numShards) ) )
+			{
+				::closesocket(m_socket);
+				m_socket = INVALID_SOCKET;
+
+				BX_TRACE("Bind or listen socket failed.");
+				ctxPush(m_ctx, m_handle, MessageId::ListenFailed);
+				return;
+			}
+
+			setNonBlock(m_socket);
+		}
+
+		/// Listen socket only receives connect datagrams, accepted
+		/// connection gets its own socket bound to same port.
+		void listenUdp(Handle _handle, uint32_t _ip, uint16_t _port)
+		{
+			m_handle = _handle;
+			m_udp = true;
+
+#if BNET_CONFIG_UDP
+			m_socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			if (INVALID_SOCKET == m_socket)
+			{
+				BX_TRACE("Create socket failed.");
+				ctxPush(m_ctx, m_handle, MessageId::ListenFailed);
+				return;
+			}
+
+			memset(&m_addr, 0, sizeof(m_addr) );
+			m_addr.sin_family = AF_INET;
+			m_addr.sin_addr.s_addr = htonl(_ip);
+			m_addr.sin_port = htons(_port);
+
+			if (!setReusePort()
+			||  SOCKET_ERROR == ::bind(m_socket, (sockaddr*)&m_addr, sizeof(m_addr) ) )
+			{
+				::closesocket(m_socket);
+				m_socket = INVALID_SOCKET;
+
+				BX_TRACE("Bind socket failed.");
+				ctxPush(m_ctx, m_handle, MessageId::ListenFailed);
+				return;
+			}
+
+			setNonBlock(m_socket);
+#else
+			BX_UNUSED(_ip);
+			BX_UNUSED(_port);
+			BX_TRACE("BNET_CONFIG_UDP is not enabled.");
+			ctxPush(m_ctx, m_handle, MessageId::ListenFailed);
+#endif // BNET_CONFIG_UDP
+		}
+
+		bool setReusePort()
+		{
+#if BNET_CONFIG_REUSEPORT
+			int reuse = 1;
+			return SOCKET_ERROR != ::setsockopt(m_socket, SOL_SOCKET, SO_REUSEPORT, (char*)&reuse, sizeof(reuse) );
+#else
+			return false;
+#endif // BNET_CONFIG_REUSEPORT
+		}
+
+		bool setCpuSteering(uint16_t _numShards)
+		{
+#if BNET_CONFIG_REUSEPORT && defined(SO_ATTACH_REUSEPORT_CBPF)
+			// TCP socket joins reuseport group on listen, program must be
+			// attached after. Program is shared by whole group, and returns
+			// index of socket in group, which is order of listen calls.
+			sock_filter code[] =
+			{
+				{ BPF_LD  | BPF_W   | BPF_ABS, 0, 0, uint32_t(SKF_AD_OFF + SKF_AD_CPU) },
+				{ BPF_ALU | BPF_MOD | BPF_K,   0, 0, _numShards },
+				{ BPF_RET | BPF_A,             0, 0, 0 },
+			};
+
+			sock_fprog prog;
+			prog.len = BX_COUNTOF(code);
+			prog.filter = code;
+			return SOCKET_ERROR != ::setsockopt(m_socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog) );
+#else
+			BX_UNUSED(_numShards);
+			BX_TRACE("CPU steering is not supported.");
+			return false;
+#endif // BNET_CONFIG_REUSEPORT && defined(SO_ATTACH_REUSEPORT_CBPF)
+		}
+
+		void update()
+		{
+#if BNET_CONFIG_UDP
+			if (m_udp)
+			{
+				updateUdp();
+				return;
+			}
+#endif // BNET_CONFIG_UDP
+
+			for (;;)
+			{
+				sockaddr_in addr;
+				socklen_t len = sizeof(addr);
+				SOCKET socket = ::accept(m_socket, (sockaddr*)&addr, &len);
+				if (INVALID_SOCKET == socket)
+				{
+					return;
+				}
+
+				accept(socket, addr);
+			}
+		}
+
+		void accept(SOCKET _socket, const sockaddr_in& _addr)
+		{
+			setNonBlock(_socket);
+
+			uint32_t ip = ntohl(_addr.sin_addr.s_addr);
+			uint16_t port = ntohs(_addr.sin_port);
+			Handle handle = ctxAccept(m_ctx, m_handle, _socket, ip, port, m_raw, m_cert, m_key);
+			if (!isValid(handle) )
+			{
+				BX_TRACE("Accept failed - Too many connections.");
+				::closesocket(_socket);
+			}
+		}
+
+		SOCKET getSocket() const
+		{
+			return m_socket;
+		}
+
+		bool isUdp() const
+		{
+			return m_udp;
+		}
+
+	private:
+#if BNET_CONFIG_UDP
+		void updateUdp()
+		{
+			UdpBatch& batch = ctxUdpBatch(m_ctx);
+
+			for (int num = BNET_CONFIG_UDP_BATCH; BNET_CONFIG_UDP_BATCH == num;)
+			{
+				num = batch.recv(m_socket);
+
+				for (int ii = 0; ii < num; ++ii)
+				{
+					const uint8_t* data = batch.getData(ii);
+					uint32_t magic = 0;
+					if (UdpConnectSize == batch.getSize(ii)
+					&&  UdpKind::Connect == data[0]
+					&&  (memcpy(&magic, &data[1], sizeof(magic) ), UdpMagic == bx::toHostEndian(magic, true) ) )
+					{
+						uint64_t cookie;
+						memcpy(&cookie, &data[5], sizeof(cookie) );
+						ctxAcceptUdp(m_ctx, m_handle, m_socket, m_addr, batch.getAddr(ii), cookie);
+					}
+				}
+			}
+		}
+#endif // BNET_CONFIG_UDP
+
+		Context* m_ctx;
+		sockaddr_in m_addr;
+		SOCKET m_socket;
+		Handle m_handle;
+		bool m_raw;
+		bool m_secure;
+		bool m_udp;
+		X509* m_cert;
+		EVP_PKEY* m_key;
+	};
+
+	typedef FreeList<ListenSocket> ListenSockets;
+
+	static bool parseIpv4(const char* _addr, uint32_t& _ip)
+	{
+		uint32_t a0, a1, a2, a3;
+		char dummy;
+		if (4 == sscanf(_addr, "%u.%u.%u.%u%c", &a0, &a1, &a2, &a3, &dummy)
+		&&  a0 <= 0xff
+		&&  a1 <= 0xff
+		&&  a2 <= 0xff
+		&&  a3 <= 0xff)
+		{
+			_ip = (a0<<24) | (a1<<16) | (a2<<8) | a3;
+			return true;
+		}
+
+		return false;
+	}
+
+	static bool fromSockaddr(const sockaddr* _sa, Address& _addr)
+	{
+		memset(&_addr, 0, sizeof(_addr) );
+
+		if (AF_INET == _sa->sa_family)
+		{
+			_addr.family = AddressFamily::Ipv4;
+			memcpy(_addr.data, &( (const sockaddr_in*)_sa)->sin_addr, 4);
+			return true;
+		}
+
+		if (AF_INET6 == _sa->sa_family)
+		{
+			_addr.family = AddressFamily::Ipv6;
+			memcpy(_addr.data, &( (const sockaddr_in6*)_sa)->sin6_addr, 16);
+			return true;
+		}
+
+		return false;
+	}
+
+	/// Returns first IPv4 address, or 0 if there is none.
+	static uint32_t getIpv4(const Address* _addrs, uint32_t _num)
+	{
+		for (uint32_t ii = 0; ii < _num; ++ii)
+		{
+			if (AddressFamily::Ipv4 == _addrs[ii].family)
+			{
+				uint32_t ip;
+				memcpy(&ip, _addrs[ii].data, sizeof(ip) );
+				return ntohl(ip);
+			}
+		}
+
+		return 0;
+	}
+
+	/// Default resolver, blocks until getaddrinfo returns. Families are
+	/// interleaved, starting with family of first address, so connect
+	/// racing addresses tries both families early.
+	static bool resolveAddrInfo(const char* _host, Address* _addrs, uint32_t* _num, uint32_t* _ttl, void* /*_userData*/)
+	{
+		*_ttl = BNET_CONFIG_RESOLVER_TTL_SECONDS;
+
+#if BX_PLATFORM_XBOX360 || BX_PLATFORM_NACL
+		// No DNS resolution on these platforms
+		BX_UNUSED(_host);
+		BX_UNUSED(_addrs);
+		*_num = 0;
+		return false;
+#else
+		struct addrinfo* result = NULL;
+		struct addrinfo hints;
+		memset(&hints, 0, sizeof(hints) );
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		Address found[2][BNET_CONFIG_MAX_ADDRESSES];
+		uint32_t num[2] = { 0, 0 };
+		uint8_t first = AddressFamily::Ipv4;
+
+		int res = getaddrinfo(_host, NULL, &hints, &result);
+
+		if (0 == res)
+		{
+			for (struct addrinfo* it = result; NULL != it; it = it->ai_next)
+			{
+				Address addr;
+				if (!fromSockaddr(it->ai_addr, addr) )
+				{
+					continue;
+				}
+
+				if (it == result)
+				{
+					first = addr.family;
+				}
+
+				Address* list = found[addr.family];
+				uint32_t& count = num[addr.family];
+				bool duplicate = false;
+				for (uint32_t ii = 0; ii < count && !duplicate; ++ii)
+				{
+					duplicate = 0 == memcmp(&list[ii], &addr, sizeof(addr) );
+				}
+
+				if (!duplicate
+				&&  BNET_CONFIG_MAX_ADDRESSES > count)
+				{
+					list[count++] = addr;
+				}
+			}
+		}
+
+		if (NULL != result)
+		{
+			freeaddrinfo(result);
+		}
+
+		const uint32_t max = *_num;
+		uint32_t total = 0;
+		for (uint32_t ii = 0; total < max && (ii < num[0] || ii < num[1]); ++ii)
+		{
+			for (uint32_t jj = 0; jj < 2; ++jj)
+			{
+				const uint8_t family = uint8_t(first^jj);
+				if (ii < num[family]
+				&&  total < max)
+				{
+					_addrs[total++] = found[family][ii];
+				}
+			}
+		}
+
+		*_num = total;
+		return 0 != total;
+#endif // BX_PLATFORM_
+	}
+
+	static void addStats(TrafficStats& _dst, const TrafficStats& _src)
+	{
+		_dst.bytesSent         += _src.bytesSent;
+		_dst.bytesReceived     += _src.bytesReceived;
+		_dst.messagesSent      += _src.messagesSent;
+		_dst.messagesReceived  += _src.messagesReceived;
+		_dst.sendCalls         += _src.sendCalls;
+		_dst.recvCalls         += _src.recvCalls;
+		_dst.sendWouldBlock    += _src.sendWouldBlock;
+		_dst.recvWouldBlock    += _src.recvWouldBlock;
+		_dst.handshakeUs       += _src.handshakeUs;
+		_dst.handshakes        += _src.handshakes;
+		_dst.accepted          += _src.accepted;
+		_dst.connections       += _src.connections;
+		_dst.sendQueueMessages += _src.sendQueueMessages;
+		_dst.sendQueueBytes    += _src.sendQueueBytes;
+		_dst.recvBufferUsed    += _src.recvBufferUsed;
+		_dst.recvBufferSize    += _src.recvBufferSize;
+
+		for (uint32_t ii = 0; ii < DisconnectReason::Count; ++ii)
+		{
+			_dst.disconnects[ii] += _src.disconnects[ii];
+		}
+
+		for (uint32_t ii = 0; ii < ConnectFailure::Count; ++ii)
+		{
+			_dst.connectFailures[ii] += _src.connectFailures[ii];
+		}
+	}
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+	/// Receive latency of connection slot, touched only by thread
+	/// calling `recv`. Histogram is allocated once first message of slot
+	/// is measured, and it's reset once message of connection with
+	/// different generation is received.
+	struct RecvLatency
+	{
+		RecvLatency()
+			: histogram(NULL)
+			, gen(0)
+		{
+		}
+
+		Histogram* histogram;
+		uint16_t gen;
+	};
+
+	static uint64_t ticksToNs(uint64_t _ticks, uint64_t _freq)
+	{
+		return _ticks/_freq*1000000000 + _ticks%_freq*1000000000/_freq;
+	}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+	/// Application timer.
+	struct UserTimer
+	{
+		UserTimer()
+			: userData(0)
+			, period(0)
+			, gen(0)
+		{
+		}
+
+		Timer timer;
+		uint64_t userData;
+		uint64_t period; // Timer wheel ticks, 0 if timer expires once.
+		uint16_t gen;
+	};
+
+#if BNET_CONFIG_IO_THREAD
+	/// Context whose I/O thread is running on calling thread.
+	static __thread Context* s_ioThreadCtx = NULL;
+#endif // BNET_CONFIG_IO_THREAD
+
+	class Context
+	{
+	public:
+		Context(bx::AllocatorI* _allocator)
+			: m_allocator(_allocator)
+			, m_pool(_allocator)
+#if BNET_CONFIG_IO_THREAD
+			, m_ioPool(_allocator, 1)
+#endif // BNET_CONFIG_IO_THREAD
+			, m_poolLimit(BNET_CONFIG_MESSAGE_POOL_SIZE)
+			, m_recvBufferPool(_allocator)
+			, m_connections(NULL)
+			, m_listenSockets(NULL)
+			, m_lz4Table(NULL)
+			, m_offerCodec(Codec::None)
+			, m_offerDictionary(0)
+			, m_offerThreshold(0)
+			, m_resolver(_allocator)
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			, m_recvLatency(NULL)
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+#if BNET_CONFIG_IO_URING
+			, m_uringSerial(NULL)
+			, m_uringListenSerial(NULL)
+			, m_uringNextSerial(0)
+			, m_uringOrphans(0)
+#endif // BNET_CONFIG_IO_URING
+#if BNET_CONFIG_IO_THREAD
+			, m_wakeFd(-1)
+			, m_wakePending(0)
+			, m_apiWaiting(0)
+			, m_ioThread(false)
+			, m_quit(false)
+#endif // BNET_CONFIG_IO_THREAD
+			, m_sslCtx(NULL)
+			, m_sslCtxServer(NULL)
+		{
+			memset(m_dictionaries, 0, sizeof(m_dictionaries) );
+			memset(&m_retiredStats, 0, sizeof(m_retiredStats) );
+		}
+
+		~Context()
+		{
+		}
+
+		void init(uint16_t _maxConnections, uint16_t _maxListenSockets, const char* _certs[], bool _ioThread)
+		{
+#if BNET_CONFIG_OPENSSL
+			m_sslCtx = SSL_CTX_new(SSLv23_client_method() );
+			SSL_CTX_set_verify(m_sslCtx, SSL_VERIFY_NONE, NULL);
+			if (NULL != _certs)
+			{
+				X509_STORE* store = SSL_CTX_get_cert_store(m_sslCtx);
+				for (const char** cert = _certs; NULL != *cert; ++cert )
+				{
+					BIO* mem = BIO_new_mem_buf(const_cast<char*>(*cert), -1);
+					X509* x509 = PEM_read_bio_X509(mem, NULL, NULL, NULL);
+					X509_STORE_add_cert(store, x509);
+					X509_free(x509);
+					BIO_free(mem);
+				}
+			}
+
+			if (_maxListenSockets)
+			{
+				m_sslCtxServer = SSL_CTX_new(SSLv23_server_method());
+			}
+#else
+			m_sslCtx = &sslDummyContext;
+			m_sslCtxServer = &sslDummyContext;
+			BX_UNUSED(_certs);
+#endif // BNET_CONFIG_OPENSSL
+
+			_maxConnections = _maxConnections == 0 ? 1 : _maxConnections;
+
+			m_resolver.init(resolveAddrInfo, NULL, resolverWake, this);
+			m_timers.init(bx::getHPCounter() );
+
+			m_connections = BX_NEW(m_allocator, Connections)(m_allocator, _maxConnections);
+			m_flush.init(m_allocator, _maxConnections);
+			m_closed.init(m_allocator, _maxConnections);
+
+#if BNET_CONFIG_UDP
+			m_udpPeers.init(m_allocator, _maxConnections);
+			initUdpSecret(m_udpSecret);
+#endif // BNET_CONFIG_UDP
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			m_recvLatency = (RecvLatency*)BX_ALLOC(m_allocator, _maxConnections*sizeof(RecvLatency) );
+			for (uint32_t ii = 0; ii < _maxConnections; ++ii)
+			{
+				::new (&m_recvLatency[ii]) RecvLatency;
+			}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+			if (0 != _maxListenSockets)
+			{
+				m_listenSockets = BX_NEW(m_allocator, ListenSockets)(m_allocator, _maxListenSockets);
+			}
+
+#if BNET_CONFIG_EPOLL
+			if (m_poller.init() )
+			{
+				m_pending.init(m_allocator, _maxConnections);
+				m_writable.init(m_allocator, _maxConnections);
+
+#	if BNET_CONFIG_IO_URING
+				if (m_uring.init(BNET_CONFIG_IO_URING_ENTRIES
+					, BNET_CONFIG_IO_URING_NUM_BUFFERS
+					, BNET_CONFIG_IO_URING_BUFFER_SIZE
+					) )
+				{
+					m_sending.init(m_allocator, _maxConnections);
+					m_uringSerial = (uint32_t*)BX_ALLOC(m_allocator, _maxConnections*sizeof(uint32_t) );
+					memset(m_uringSerial, 0, _maxConnections*sizeof(uint32_t) );
+
+					if (0 != _maxListenSockets)
+					{
+						m_uringListenSerial = (uint32_t*)BX_ALLOC(m_allocator, _maxListenSockets*sizeof(uint32_t) );
+						memset(m_uringListenSerial, 0, _maxListenSockets*sizeof(uint32_t) );
+					}
+				}
+				else
+				{
+					BX_TRACE("io_uring is not available, falling back to epoll.");
+				}
+#	endif // BNET_CONFIG_IO_URING
+			}
+			else
+			{
+				BX_TRACE("epoll is not available, falling back to polling all sockets.");
+			}
+#endif // BNET_CONFIG_EPOLL
+
+			if (_ioThread)
+			{
+#if BNET_CONFIG_IO_THREAD
+				startThread();
+#else
+				BX_TRACE("BNET_CONFIG_IO_THREAD is not enabled.");
+#endif // BNET_CONFIG_IO_THREAD
+			}
+		}
+
+		void shutdown()
+		{
+			// Resolver threads wake I/O thread, so they are stopped first.
+			m_resolver.stop();
+
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				stopThread();
+			}
+#endif // BNET_CONFIG_IO_THREAD
+
+			m_resolver.shutdown();
+
+#if BNET_CONFIG_IO_URING
+			if (m_uring.isValid() )
+			{
+				shutdownUring();
+			}
+#endif // BNET_CONFIG_IO_URING
+
+			for (Message* msg = m_incoming.pop(); NULL != msg; msg = m_incoming.pop() )
+			{
+				release(msg);
+			}
+
+			for (uint16_t ii = 0, num = m_groupHandle.getNumHandles(); ii < num; ++ii)
+			{
+				BX_DELETE(m_allocator, m_groups[m_groupHandle.getHandleAt(ii)]);
+			}
+			m_groupHandle.reset();
+			m_timerHandle.reset();
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			for (uint32_t ii = 0, num = m_connections->getMaxHandles(); ii < num; ++ii)
+			{
+				if (NULL != m_recvLatency[ii].histogram)
+				{
+					BX_DELETE(m_allocator, m_recvLatency[ii].histogram);
+				}
+			}
+
+			BX_FREE(m_allocator, m_recvLatency);
+			m_recvLatency = NULL;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+			BX_DELETE(m_allocator, m_connections);
+
+			// Connections that are still open are freed without
+			// destructor, so their timers are never unlinked.
+			m_timers.reset();
+			m_flush.shutdown();
+			m_closed.shutdown();
+#if BNET_CONFIG_UDP
+			m_udpPeers.shutdown();
+#endif // BNET_CONFIG_UDP
+			m_recvBufferPool.purge();
+
+			for (uint32_t ii = 0; ii < BNET_CONFIG_MAX_DICTIONARIES; ++ii)
+			{
+				BX_FREE(m_allocator, m_dictionaries[ii]);
+				m_dictionaries[ii] = NULL;
+			}
+
+			BX_FREE(m_allocator, m_lz4Table);
+			m_lz4Table = NULL;
+
+			if (NULL != m_listenSockets)
+			{
+				BX_DELETE(m_allocator, m_listenSockets);
+			}
+
+#if BNET_CONFIG_EPOLL
+			if (m_poller.isValid() )
+			{
+				m_poller.shutdown();
+				m_pending.shutdown();
+				m_writable.shutdown();
+			}
+#endif // BNET_CONFIG_EPOLL
+
+#if BNET_CONFIG_OPENSSL
+			if (NULL != m_sslCtx)
+			{
+				SSL_CTX_free(m_sslCtx);
+			}
+			m_sslCtx = NULL;
+
+			if (NULL != m_sslCtxServer)
+			{
+				SSL_CTX_free(m_sslCtxServer);
+			}
+			m_sslCtxServer = NULL;
+#endif // BNET_CONFIG_OPENSSL
+		}
+
+		Handle listen(uint32_t _ip, uint16_t _port, bool _raw, const char* _cert, const char* _key, bool _shared = false, uint16_t _numShards = 0)
+		{
+			ApiScope scope(this);
+
+			ListenSocket* listenSocket = m_listenSockets->create(this);
+			if (NULL != listenSocket)
+			{
+				Handle handle = m_listenSockets->makeHandle(m_listenSockets->getHandle(listenSocket) );
+				listenSocket->listen(handle, _ip, _port, _raw, _cert, _key, _shared, _numShards);
+				watch(listenSocket);
+				return handle;
+			}
+
+			return invalidHandle;
+		}
+
+		Handle listenUdp(uint32_t _ip, uint16_t _port)
+		{
+			ApiScope scope(this);
+
+			ListenSocket* listenSocket = m_listenSockets->create(this);
+			if (NULL != listenSocket)
+			{
+				Handle handle = m_listenSockets->makeHandle(m_listenSockets->getHandle(listenSocket) );
+				listenSocket->listenUdp(handle, _ip, _port);
+				watch(listenSocket);
+				return handle;
+			}
+
+			return invalidHandle;
+		}
+
+		void stop(Handle _handle)
+		{
+			ApiScope scope(this);
+
+			if (!m_listenSockets->isValid(_handle) )
+			{
+				BX_TRACE("Stop %d - Invalid handle.", _handle.idx);
+				return;
+			}
+
+			ListenSocket* listenSocket = { m_listenSockets->getFromHandle(_handle.idx) };
+#if BNET_CONFIG_IO_URING
+			if (NULL != m_uringListenSerial
+			&&  0 != m_uringListenSerial[_handle.idx])
+			{
+				m_uringListenSerial[_handle.idx] = 0;
+				m_uring.cancel(listenSocket->getSocket(), UringTag::None);
+			}
+#endif // BNET_CONFIG_IO_URING
+			listenSocket->close();
+			m_listenSockets->destroy(listenSocket);
+		}
+
+		Handle accept(Handle _listenHandle, SOCKET _socket, uint32_t _ip, uint16_t _port, bool _raw, X509* _cert, EVP_PKEY* _key)
+		{
+			Connection* connection = m_connections->create(this);
+			if (NULL != connection)
+			{
+				Handle handle = m_connections->makeHandle(m_connections->getHandle(connection) );
+				bool secure = NULL != _cert && NULL != _key;
+				connection->accept(handle, _listenHandle, _socket, _ip, _port, _raw, secure?m_sslCtxServer:NULL, _cert, _key);
+				offerCompression(connection, _raw);
+				watch(connection);
+				return handle;
+			}
+
+			return invalidHandle;
+		}
+
+		Handle connect(const Address* _addrs, uint32_t _num, uint16_t _port, bool _raw, bool _secure)
+		{
+			ApiScope scope(this);
+
+			Connection* connection = m_connections->create(this);
+			if (NULL != connection)
+			{
+				Handle handle = m_connections->makeHandle(m_connections->getHandle(connection) );
+				connection->connect(handle, _addrs, _num, _port, _raw, _secure?m_sslCtx:NULL);
+				offerCompression(connection, _raw);
+				watch(connection);
+				return handle;
+			}
+
+			return invalidHandle;
+		}
+
+		/// Adds connection socket to poller, after it was replaced by
+		/// connect race.
+		void rewatch(Handle _handle)
+		{
+#if BNET_CONFIG_EPOLL
+			Connection* connection = m_connections->getFromHandle(_handle.idx);
+			if (m_poller.isValid()
+#	if BNET_CONFIG_IO_URING
+			&&  !connection->isUring()
+#	endif // BNET_CONFIG_IO_URING
+			&&  connection->hasSocket() )
+			{
+				m_poller.add(connection->getSocket(), _handle.idx);
+			}
+#else
+			BX_UNUSED(_handle);
+#endif // BNET_CONFIG_EPOLL
+		}
+
+		Handle connectUdp(uint32_t _ip, uint16_t _port)
+		{
+			ApiScope scope(this);
+
+			Connection* connection = m_connections->create(this);
+			if (NULL != connection)
+			{
+				Handle handle = m_connections->makeHandle(m_connections->getHandle(connection) );
+				connection->connectUdp(handle, _ip, _port);
+				watch(connection);
+				return handle;
+			}
+
+			return invalidHandle;
+		}
+
+#if BNET_CONFIG_UDP
+		/// Peer must echo cookie sent in challenge before any state is
+		/// allocated for it, so connects with spoofed source address
+		/// never create sockets or use connection slots.
+		void acceptUdp(Handle _listenHandle, SOCKET _listenSocket, const sockaddr_in& _local, const sockaddr_in& _remote, uint64_t _cookie)
+		{
+			const uint32_t ip = ntohl(_remote.sin_addr.s_addr);
+			const uint16_t port = ntohs(_remote.sin_port);
+			const uint64_t key = UdpPeers::makeKey(_listenHandle.idx, ip, port);
+
+			const uint16_t idx = m_udpPeers.find(key);
+			if (UINT16_MAX != idx
+			&&  m_connections->getFromHandle(idx)->isUdpPeer(_listenHandle, ip, port) )
+			{
+				// Connect was resent before peer socket was connected.
+				return;
+			}
+
+			const uint64_t period = bx::getHPCounter()/(bx::getHPFrequency()*UdpCookieSeconds);
+			const uint64_t cookie = sipHash(m_udpSecret, key, period);
+			if (cookie != _cookie
+			&&  sipHash(m_udpSecret, key, period-1) != _cookie)
+			{
+				uint8_t challenge[UdpChallengeSize] = { UdpKind::Challenge };
+				memcpy(&challenge[1], &cookie, sizeof(cookie) );
+				::sendto(_listenSocket, (const char*)challenge, sizeof(challenge), 0, (const sockaddr*)&_remote, sizeof(_remote) );
+				return;
+			}
+
+			SOCKET socket = createUdpSocket(&_local, _remote);
+			if (INVALID_SOCKET == socket)
+			{
+				BX_TRACE("Accept failed - Create socket failed.");
+				return;
+			}
+
+			Connection* connection = m_connections->create(this);
+			if (NULL == connection)
+			{
+				BX_TRACE("Accept failed - Too many connections.");
+				::closesocket(socket);
+				return;
+			}
+
+			Handle handle = m_connections->makeHandle(m_connections->getHandle(connection) );
+			connection->acceptUdp(handle, _listenHandle, socket, ip, port);
+			m_udpPeers.insert(key, handle.idx);
+			watch(connection);
+		}
+
+		UdpBatch& getUdpBatch()
+		{
+			return m_udpBatch;
+		}
+#endif // BNET_CONFIG_UDP
+
+		void disconnect(Handle _handle, bool _finish)
+		{
+			ApiScope scope(this);
+
+			if (!m_connections->isValid(_handle) )
+			{
+				BX_TRACE("Disconnect %d - Invalid handle.", _handle.idx);
+				return;
+			}
+
+			// Handle is stale from now on, slot is reused once connection
+			// is closed and its zero-copy messages are released.
+			m_connections->invalidate(_handle.idx);
+			for (uint16_t ii = 0, num = m_groupHandle.getNumHandles(); ii < num; ++ii)
+			{
+				m_groups[m_groupHandle.getHandleAt(ii)]->remove(_handle.idx);
+			}
+
+			Connection* connection = { m_connections->getFromHandle(_handle.idx) };
+			connection->setDestroyPending();
+
+			if (_finish
+			&&  connection->hasSocket() )
+			{
+				Message* msg = msgAlloc(this, _handle, 0, false, Internal::Disconnect);
+				connection->send(msg);
+				updatePending(connection);
+			}
+			else
+			{
+				BX_TRACE("Disconnect %d - Client closed connection.", _handle.idx);
+				connection->disconnect();
+				tryDestroy(_handle.idx, connection);
+			}
+		}
+
+		void notify(Handle _handle, uint64_t _userData, Priority::Enum _priority)
+		{
+			BX_CHECK(_handle.idx == invalidHandle.idx // loopback
+			      || _handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			// Stale handles are rejected when message is sent.
+
+			Message* msg;
+			if (invalidHandle.idx != _handle.idx)
+			{
+				msg = msgAlloc(this, _handle, sizeof(_userData), false, Internal::Notify);
+				setPriority(msg, _priority);
+				memcpy(msg->data, &_userData, sizeof(_userData) );
+			}
+			else
+			{
+				// loopback
+				msg = msgAlloc(this, _handle, sizeof(_userData)+1, true);
+				msg->data[0] = MessageId::Notify;
+				memcpy(&msg->data[1], &_userData, sizeof(_userData) );
+			}
+
+			send(msg);
+		}
+
+		void send(Message* _msg)
+		{
+			BX_CHECK(_msg->handle.idx == invalidHandle.idx // loopback
+			      || _msg->handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _msg->handle.idx);
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			stamp(_msg);
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				m_commands.push(_msg);
+				wake();
+				return;
+			}
+#endif // BNET_CONFIG_IO_THREAD
+
+			sendMessage(_msg);
+		}
+
+		void send(Message* _msg, Channel::Enum _channel)
+		{
+			getHeader(_msg)->flags |= uint8_t(_channel << MessageFlags::ChannelShift);
+			send(_msg);
+		}
+
+		void sendLarge(Handle _handle, const uint8_t* _data, uint32_t _size)
+		{
+			BX_CHECK(0 < _size && _data[0] >= MessageId::UserDefined, "Sending message with MessageId below UserDefined is not allowed!");
+
+			for (uint32_t offset = 0; offset < _size;)
+			{
+				const bool first = 0 == offset;
+				const uint32_t header = first ? 6 : 2;
+				const uint32_t size = bx::uint32_min(_size - offset, BNET_CONFIG_FRAGMENT_SIZE);
+
+				Message* msg = msgAlloc(this, _handle, header + size);
+				getHeader(msg)->flags = MessageFlags::Stream;
+				msg->data[0] = MessageId::Fragment;
+				msg->data[1] = uint8_t(0
+					| (first                  ? FragmentFlags::First : 0)
+					| (offset + size == _size ? FragmentFlags::Last  : 0)
+					);
+
+				if (first)
+				{
+					uint32_t total = bx::toLittleEndian(_size);
+					memcpy(&msg->data[2], &total, sizeof(total) );
+				}
+
+				memcpy(&msg->data[header], &_data[offset], size);
+				offset += size;
+
+				queue(msg);
+			}
+
+			flush();
+		}
+
+		/// Queues message, it's sent on next flush.
+		void queue(Message* _msg)
+		{
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			stamp(_msg);
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				m_commands.push(_msg);
+				wake();
+				return;
+			}
+#endif // BNET_CONFIG_IO_THREAD
+
+			queueMessage(_msg);
+		}
+
+		void flush()
+		{
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				// I/O thread flushes after executing queued commands.
+				return;
+			}
+#endif // BNET_CONFIG_IO_THREAD
+
+			flushMessages();
+		}
+
+		/// Queues one shared message per connection, all referencing
+		/// `_msg` payload, which is released after last connection sent
+		/// it.
+		void broadcast(Message* _msg, const Handle* _handles, uint32_t _num)
+		{
+			uint32_t num = 0;
+			for (uint32_t ii = 0; ii < _num; ++ii)
+			{
+				num += invalidHandle.idx != _handles[ii].idx;
+			}
+
+			BX_CHECK(num < UINT16_MAX, "Too many broadcast handles %d!", num);
+			if (!share(_msg, uint16_t(num) ) )
+			{
+				return;
+			}
+
+			for (uint32_t ii = 0; ii < _num; ++ii)
+			{
+				if (invalidHandle.idx != _handles[ii].idx)
+				{
+					queue(allocShared(_msg, _handles[ii]) );
+				}
+			}
+
+			flush();
+		}
+
+		void broadcast(Message* _msg, GroupHandle _group)
+		{
+			BX_CHECK(m_groupHandle.isValid(_group.idx), "Invalid group handle %d!", _group.idx);
+
+			ApiScope scope(this);
+
+			const HandleList& group = *m_groups[_group.idx];
+			if (!share(_msg, group.getNum() ) )
+			{
+				return;
+			}
+
+			for (uint16_t ii = 0, num = group.getNum(); ii < num; ++ii)
+			{
+				queue(allocShared(_msg, m_connections->makeHandle(group.get(ii) ) ) );
+			}
+
+			flush();
+		}
+
+		GroupHandle createGroup()
+		{
+			ApiScope scope(this);
+
+			GroupHandle handle = { m_groupHandle.alloc() };
+			if (isValid(handle) )
+			{
+				HandleList* group = BX_NEW(m_allocator, HandleList);
+				group->init(m_allocator, m_connections->getMaxHandles() );
+				m_groups[handle.idx] = group;
+			}
+
+			return handle;
+		}
+
+		void destroyGroup(GroupHandle _group)
+		{
+			BX_CHECK(m_groupHandle.isValid(_group.idx), "Invalid group handle %d!", _group.idx);
+
+			ApiScope scope(this);
+
+			BX_DELETE(m_allocator, m_groups[_group.idx]);
+			m_groups[_group.idx] = NULL;
+			m_groupHandle.free(_group.idx);
+		}
+
+		void addToGroup(GroupHandle _group, Handle _handle)
+		{
+			BX_CHECK(m_groupHandle.isValid(_group.idx), "Invalid group handle %d!", _group.idx);
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				m_groups[_group.idx]->add(_handle.idx);
+			}
+		}
+
+		void removeFromGroup(GroupHandle _group, Handle _handle)
+		{
+			BX_CHECK(m_groupHandle.isValid(_group.idx), "Invalid group handle %d!", _group.idx);
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				m_groups[_group.idx]->remove(_handle.idx);
+			}
+		}
+
+		void setReassembly(Handle _handle, uint32_t _maxSize)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				Connection* connection = m_connections->getFromHandle(_handle.idx);
+				connection->setReassembly(_maxSize);
+			}
+		}
+
+		void setIdleTimeout(Handle _handle, uint32_t _ms)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle)
+			&&  m_connections->getFromHandle(_handle.idx)->hasSocket() )
+			{
+				Connection* connection = m_connections->getFromHandle(_handle.idx);
+				connection->setIdleTimeout(_ms);
+			}
+		}
+
+		void setSendWatermarks(Handle _handle, uint32_t _low, uint32_t _high)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+			BX_CHECK(_low < _high || 0 == _high, "Low watermark %d must be below high watermark %d!", _low, _high);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				Connection* connection = m_connections->getFromHandle(_handle.idx);
+				connection->setSendWatermarks(_low, _high);
+			}
+		}
+
+		void setSendLimit(Handle _handle, uint32_t _size, SendLimit::Enum _policy)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				Connection* connection = m_connections->getFromHandle(_handle.idx);
+				connection->setSendLimit(_size, _policy);
+			}
+		}
+
+		uint32_t getSendQueueSize(Handle _handle)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				return m_connections->getFromHandle(_handle.idx)->getSendQueueSize();
+			}
+
+			return 0;
+		}
+
+		const TrafficStats* getStats(Handle _handle)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (!m_connections->isValid(_handle) )
+			{
+				return NULL;
+			}
+
+			m_connections->getFromHandle(_handle.idx)->getStats(m_trafficStats);
+			return &m_trafficStats;
+		}
+
+		const TrafficStats* getGlobalStats()
+		{
+			ApiScope scope(this);
+
+			m_trafficStats = m_retiredStats;
+
+			TrafficStats stats;
+			for (uint16_t ii = 0, num = m_connections->getNumHandles(); ii < num; ++ii)
+			{
+				m_connections->getFromHandleAt(ii)->getStats(stats);
+				addStats(m_trafficStats, stats);
+			}
+
+			return &m_trafficStats;
+		}
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		const LatencyStats* getLatency(Handle _handle, Latency::Enum _latency, bool _reset)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (!m_connections->isValid(_handle) )
+			{
+				return NULL;
+			}
+
+			if (Latency::Send == _latency)
+			{
+				return getLatencyStats(m_connections->getFromHandle(_handle.idx)->getSendLatency(), _reset);
+			}
+
+			RecvLatency& recv = m_recvLatency[_handle.idx];
+			if (recv.gen != _handle.gen
+			&&  NULL != recv.histogram)
+			{
+				recv.histogram->reset();
+				recv.gen = _handle.gen;
+			}
+
+			return getLatencyStats(recv.histogram, _reset);
+		}
+
+		const LatencyStats* getGlobalLatency(Latency::Enum _latency, bool _reset)
+		{
+			ApiScope scope(this);
+			return getLatencyStats(&m_latency[_latency], _reset);
+		}
+
+		Histogram& getLatencyHistogram(Latency::Enum _latency)
+		{
+			return m_latency[_latency];
+		}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+		TimerHandle createTimer(uint64_t _userData)
+		{
+			ApiScope scope(this);
+
+			TimerHandle handle = { m_timerHandle.alloc(), 0 };
+			if (isValid(handle) )
+			{
+				UserTimer& timer = m_userTimers[handle.idx];
+				timer.timer.key = (TimerKind::User<<16) | handle.idx;
+				timer.userData = _userData;
+				timer.period = 0;
+				handle.gen = timer.gen;
+			}
+
+			return handle;
+		}
+
+		void destroyTimer(TimerHandle _timer)
+		{
+			ApiScope scope(this);
+
+			if (!isValidTimer(_timer) )
+			{
+				BX_TRACE("Destroy timer %d - Invalid handle.", _timer.idx);
+				return;
+			}
+
+			UserTimer& timer = m_userTimers[_timer.idx];
+			m_timers.remove(&timer.timer);
+			++timer.gen;
+			m_timerHandle.free(_timer.idx);
+		}
+
+		void startTimer(TimerHandle _timer, uint32_t _ms, uint32_t _periodMs)
+		{
+			ApiScope scope(this);
+
+			if (!isValidTimer(_timer) )
+			{
+				BX_TRACE("Start timer %d - Invalid handle.", _timer.idx);
+				return;
+			}
+
+			UserTimer& timer = m_userTimers[_timer.idx];
+			timer.period = m_timers.msToTicks(_periodMs);
+			m_timers.add(&timer.timer, _ms);
+		}
+
+		void stopTimer(TimerHandle _timer)
+		{
+			ApiScope scope(this);
+
+			if (!isValidTimer(_timer) )
+			{
+				BX_TRACE("Stop timer %d - Invalid handle.", _timer.idx);
+				return;
+			}
+
+			m_timers.remove(&m_userTimers[_timer.idx].timer);
+		}
+
+		static TimerHandle getTimerHandle(Message* _msg)
+		{
+			TimerHandle handle;
+			memcpy(&handle, &_msg->data[1], sizeof(handle) );
+			return handle;
+		}
+
+		bool isValidTimer(TimerHandle _timer) const
+		{
+			return _timer.idx < BNET_CONFIG_MAX_TIMERS
+				&& m_timerHandle.isValid(_timer.idx)
+				&& m_userTimers[_timer.idx].gen == _timer.gen
+				;
+		}
+
+		TimerWheel& getTimers()
+		{
+			return m_timers;
+		}
+
+		Message* recv()
+		{
+			Message* msg;
+
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				msg = popReady();
+			}
+			else
+#endif // BNET_CONFIG_IO_THREAD
+			{
+				update();
+				msg = pop();
+			}
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			if (NULL != msg)
+			{
+				int64_t now = 0;
+				recordRecv(msg, now);
+			}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+			return msg;
+		}
+
+		uint32_t recv(Message** _msgs, uint32_t _max)
+		{
+			uint32_t num = 0;
+
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				for (; num < _max && NULL != (_msgs[num] = popReady() ); ++num)
+				{
+				}
+			}
+			else
+#endif // BNET_CONFIG_IO_THREAD
+			{
+				update();
+
+				for (; num < _max && NULL != (_msgs[num] = pop() ); ++num)
+				{
+				}
+			}
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+			int64_t now = 0;
+			for (uint32_t ii = 0; ii < num; ++ii)
+			{
+				recordRecv(_msgs[ii], now);
+			}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+			return num;
+		}
+
+#if BNET_CONFIG_IO_THREAD
+		Message* popReady()
+		{
+			for (Message* msg = m_ready.pop(); NULL != msg; msg = m_ready.pop() )
+			{
+				if (invalidHandle.idx != msg->handle.idx
+				||  MessageId::Timer != msg->data[0])
+				{
+					return msg;
+				}
+
+				// Timer could be destroyed after I/O thread passed it.
+				ApiScope scope(this);
+				if (isValidTimer(getTimerHandle(msg) ) )
+				{
+					return msg;
+				}
+
+				release(msg);
+			}
+
+			return NULL;
+		}
+#endif // BNET_CONFIG_IO_THREAD
+
+		void push(Message* _msg)
+		{
+			m_incoming.push(_msg);
+		}
+
+		/// Connection disconnected by user finished closing.
+		void closed(Handle _handle)
+		{
+			m_closed.add(_handle.idx);
+		}
+
+		bx::AllocatorI* getAllocator()
+		{
+			return m_allocator;
+		}
+
+		/// Returns cached blocks of all pools to allocator.
+		void purgePool()
+		{
+			m_pool.purge();
+#if BNET_CONFIG_IO_THREAD
+			m_ioPool.purge();
+#endif // BNET_CONFIG_IO_THREAD
+		}
+
+		RecvBufferPool& getRecvBufferPool()
+		{
+			return m_recvBufferPool;
+		}
+
+		const RecvBufferStats* getRecvBufferStats()
+		{
+			ApiScope scope(this);
+
+			m_recvBufferStats = m_recvBufferPool.getStats();
+			m_recvBufferStats.connections = m_connections->getNumHandles();
+			return &m_recvBufferStats;
+		}
+
+		/// Stats are copied, with I/O thread they are combined from both
+		/// pools, and usedMax is sum of per pool high-water marks.
+		const PoolStats* getPoolStats()
+		{
+			ApiScope scope(this);
+
+#if BNET_CONFIG_IO_THREAD
+			// I/O thread is not touching its pool while API call holds
+			// lock.
+			collectFreed(0);
+			collectFreed(1);
+#endif // BNET_CONFIG_IO_THREAD
+
+			m_poolStats = m_pool.getStats();
+
+#if BNET_CONFIG_IO_THREAD
+			const PoolStats& ioStats = m_ioPool.getStats();
+			m_poolStats.hits      += ioStats.hits;
+			m_poolStats.misses    += ioStats.misses;
+			m_poolStats.used      += ioStats.used;
+			m_poolStats.usedMax   += ioStats.usedMax;
+			m_poolStats.cached    += ioStats.cached;
+			m_poolStats.cachedMax += ioStats.cachedMax;
+#endif // BNET_CONFIG_IO_THREAD
+			return &m_poolStats;
+		}
+
+		/// With I/O thread, application and I/O thread allocate from
+		/// their own pool without locking. Block freed by other thread is
+		/// pushed to lock-free queue, and owner moves it to its free lists
+		/// on next allocation.
+		void* allocMessage(uint32_t _size)
+		{
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				const uint8_t pool = isIoThread() ? 1 : 0;
+				collectFreed(pool);
+				return 0 == pool ? m_pool.alloc(_size) : m_ioPool.alloc(_size);
+			}
+#endif // BNET_CONFIG_IO_THREAD
+
+			return m_pool.alloc(_size);
+		}
+
+		void freeMessage(void* _ptr)
+		{
+#if BNET_CONFIG_IO_THREAD
+			const uint8_t pool = getHeader( (Message*)_ptr)->pool;
+			if (m_ioThread
+			&&  pool != (isIoThread() ? 1 : 0) )
+			{
+				m_poolFreed[pool].push( (Message*)_ptr);
+				return;
+			}
+
+			if (0 != pool)
+			{
+				m_ioPool.free(_ptr);
+				return;
+			}
+#endif // BNET_CONFIG_IO_THREAD
+
+			m_pool.free(_ptr);
+		}
+
+		void setPoolLimit(uint32_t _size)
+		{
+			ApiScope scope(this);
+
+			m_poolLimit = _size;
+			applyPoolLimit();
+		}
+
+		/// With I/O thread, pool limit is split between application and
+		/// I/O thread pool.
+		void applyPoolLimit()
+		{
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				m_pool.setLimit(m_poolLimit/2);
+				m_ioPool.setLimit(m_poolLimit - m_poolLimit/2);
+				return;
+			}
+
+			m_ioPool.setLimit(0);
+#endif // BNET_CONFIG_IO_THREAD
+
+			m_pool.setLimit(m_poolLimit);
+		}
+
+		void setZeroCopy(Handle _handle, bool _enable)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				Connection* connection = m_connections->getFromHandle(_handle.idx);
+				connection->setZeroCopy(_enable);
+			}
+		}
+
+		/// Dictionary must be set to same data on both peers before
+		/// compression that uses it is offered.
+		void setDictionary(uint8_t _id, const void* _data, uint16_t _size)
+		{
+			if (0 == _id
+			||  BNET_CONFIG_MAX_DICTIONARIES <= _id)
+			{
+				BX_TRACE("Set dictionary %d - Invalid dictionary id.", _id);
+				return;
+			}
+
+			ApiScope scope(this);
+
+			BX_FREE(m_allocator, m_dictionaries[_id]);
+			m_dictionaries[_id] = NULL;
+
+			if (NULL != _data
+			&&  0 != _size)
+			{
+				Lz4Dictionary* dict = (Lz4Dictionary*)BX_ALLOC(m_allocator, sizeof(Lz4Dictionary) + _size);
+				lz4InitDictionary(dict, _data, _size);
+				m_dictionaries[_id] = dict;
+			}
+		}
+
+		void setCompression(Handle _handle, Codec::Enum _codec, uint8_t _dictionary, uint16_t _threshold)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (m_connections->isValid(_handle) )
+			{
+				Connection* connection = m_connections->getFromHandle(_handle.idx);
+				connection->setCompression(_codec, _dictionary, _threshold);
+				flushMessages();
+			}
+		}
+
+		void setDefaultCompression(Codec::Enum _codec, uint8_t _dictionary, uint16_t _threshold)
+		{
+			ApiScope scope(this);
+
+			m_offerCodec = uint8_t(_codec);
+			m_offerDictionary = _dictionary;
+			m_offerThreshold = _threshold;
+		}
+
+		/// Offer is queued right after connection is created, so it's
+		/// first frame peer receives.
+		void offerCompression(Connection* _connection, bool _raw)
+		{
+			if (Codec::None != m_offerCodec
+			&&  !_raw)
+			{
+				_connection->setCompression(Codec::Enum(m_offerCodec), m_offerDictionary, m_offerThreshold);
+			}
+		}
+
+		const CompressionStats* getCompressionStats(Handle _handle)
+		{
+			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+
+			ApiScope scope(this);
+
+			if (!m_connections->isValid(_handle) )
+			{
+				return NULL;
+			}
+
+			m_connections->getFromHandle(_handle.idx)->getCompressionStats(m_compressionStats);
+			return &m_compressionStats;
+		}
+
+		const Lz4Dictionary* getDictionary(uint8_t _id) const
+		{
+			return _id < BNET_CONFIG_MAX_DICTIONARIES ? m_dictionaries[_id] : NULL;
+		}
+
+		/// Match table is shared by all connections, since only one
+		/// message is compressed at the time.
+		Lz4Table* getLz4Table()
+		{
+			if (NULL == m_lz4Table)
+			{
+				m_lz4Table = (Lz4Table*)BX_ALLOC(m_allocator, sizeof(Lz4Table) );
+				lz4InitTable(m_lz4Table);
+			}
+
+			return m_lz4Table;
+		}
+
+		void resolve(const char* _host, uint64_t _userData)
+		{
+			ApiScope scope(this);
+
+			Address addr;
+			if (toAddress(_host, addr) )
+			{
+				pushResolved(&addr, 1, _userData);
+				return;
+			}
+
+			const ResolverEntry* entry = m_resolver.find(_host);
+			if (NULL != entry)
+			{
+				pushResolved(entry->addrs, entry->num, _userData);
+				return;
+			}
+
+			m_resolver.resolve(_host, _userData);
+		}
+
+		void setResolver(ResolveFn _fn, void* _userData)
+		{
+			ApiScope scope(this);
+
+			if (NULL == _fn)
+			{
+				m_resolver.setResolver(resolveAddrInfo, NULL);
+			}
+			else
+			{
+				m_resolver.setResolver(_fn, _userData);
+			}
+		}
+
+		/// Queues message generated by connection itself.
+		void queueInternal(Message* _msg)
+		{
+			queueMessage(_msg);
+		}
+
+		void releaseView(Message* _msg)
+		{
+#if BNET_CONFIG_IO_THREAD
+			if (m_ioThread)
+			{
+				m_commands.push(_msg);
+				wake();
+				return;
+			}
+#endif // BNET_CONFIG_IO_THREAD
+
+			releaseMessageView(_msg);
+		}
+
+	private:
+		/// Serializes API calls with I/O thread. Messages queued before
+		/// the call are executed first, to preserve ordering.
+		class ApiScope
+		{
+		public:
+			ApiScope(Context* _ctx)
+				: m_ctx(_ctx)
+			{
+#if BNET_CONFIG_IO_THREAD
+				if (m_ctx->m_ioThread)
+				{
+					// I/O thread yields lock between connection updates
+					// while API call is waiting for it.
+					bx::atomicFetchAndAdd<int32_t>(&m_ctx->m_apiWaiting, 1);
+					m_ctx->m_lock.lock();
+					bx::atomicFetchAndSub<int32_t>(&m_ctx->m_apiWaiting, 1);
+					m_ctx->executeCommands();
+				}
+#endif // BNET_CONFIG_IO_THREAD
+			}
+
+			~ApiScope()
+			{
+#if BNET_CONFIG_IO_THREAD
+				if (m_ctx->m_ioThread)
+				{
+					m_ctx->m_lock.unlock();
+					m_ctx->wake();
+				}
+#endif // BNET_CONFIG_IO_THREAD
+			}
+
+		private:
+			Context* m_ctx;
+		};
+
+		void queueMessage(Message* _msg)
+		{
+			if (invalidHandle.idx == _msg->handle.idx)
+			{
+				// loopback
+				push(_msg);
+				return;
+			}
+
+			if (!m_connections->isValid(_msg->handle) )
+			{
+				release(_msg);
+				return;
+			}
+
+			// Message can be replaced by its compressed copy once queued.
+			const uint16_t idx = _msg->handle.idx;
+			Connection* connection = m_connections->getFromHandle(idx);
+			if (connection->queue(_msg) )
+			{
+				m_flush.add(idx);
+			}
+			else
+			{
+				updatePending(connection);
+			}
+		}
+
+		/// Releases lock between connection updates while API call is
+		/// waiting for it, so API call doesn't wait for whole I/O thread
+		/// tick.
+		void yieldLock()
+		{
+#if BNET_CONFIG_IO_THREAD
+			if (0 != m_apiWaiting
+			&&  isIoThread() )
+			{
+				m_lock.unlock();
+
+				// Mutex is not fair, without waiting I/O thread could
+				// take it back before API call.
+				while (0 != m_apiWaiting)
+				{
+					::sched_yield();
+				}
+
+				m_lock.lock();
+			}
+#endif // BNET_CONFIG_IO_THREAD
+		}
+
+		/// Drains each connection with queued messages once.
+		void flushMessages()
+		{
+			while (0 != m_flush.getNum() )
+			{
+				uint16_t idx = m_flush.get(m_flush.getNum()-1);
+				m_flush.remove(idx);
+
+				Connection* connection = m_connections->getFromHandle(idx);
+				connection->update();
+				updatePending(connection);
+				yieldLock();
+			}
+		}
+
+		void sendMessage(Message* _msg)
+		{
+			if (invalidHandle.idx == _msg->handle.idx)
+			{
+				// loopback
+				push(_msg);
+			}
+			else if (m_connections->isValid(_msg->handle) )
+			{
+				Connection* connection = m_connections->getFromHandle(_msg->handle.idx);
+				connection->send(_msg);
+				updatePending(connection);
+			}
+			else
+			{
+				release(_msg);
+			}
+		}
+
+		void update()
+		{
+			flushMessages();
+			updateResolver();
+			updateTimers();
+
+#if BNET_CONFIG_EPOLL
+			if (m_poller.isValid() )
+			{
+				updateReady(m_poller.wait(0) );
+			}
+			else
+#endif // BNET_CONFIG_EPOLL
+			{
+				updateAll();
+			}
+
+			updateClosed();
+		}
+
+		Message* pop()
+		{
+			Message* msg = m_incoming.pop();
+
+			while (NULL != msg)
+			{
+				if (invalidHandle.idx == msg->handle.idx) // loopback
+				{
+					if (MessageId::Timer != msg->data[0]
+					||  isValidTimer(getTimerHandle(msg) ) )
+					{
+						// Timer could be destroyed after it expired.
+						return msg;
+					}
+				}
+				else if (MessageId::ListenFailed == msg->data[0]) // listen socket handle
+				{
+					return msg;
+				}
+				else if (m_connections->isValid(msg->handle)
+				     &&  (MessageId::UserDefined > msg->data[0]
+				     ||   m_connections->getFromHandle(msg->handle.idx)->hasSocket() ) )
+				{
+					// Messages of connections disconnected by user are
+					// dropped, and so is data from closed connections.
+					return msg;
+				}
+
+				release(msg);
+				msg = m_incoming.pop();
+			}
+
+			return msg;
+		}
+
+		void releaseMessageView(Message* _msg)
+		{
+			Connection* connection = m_connections->getFromHandle(_msg->handle.idx);
+			connection->releaseView(_msg);
+
+			if (connection->isDestroyPending() )
+			{
+				tryDestroy(_msg->handle.idx, connection);
+			}
+		}
+
+	private:
+		bx::AllocatorI* m_allocator;
+		MessagePool m_pool;
+#if BNET_CONFIG_IO_THREAD
+		MessagePool m_ioPool;                // Owned by I/O thread.
+		MpscMessageQueue m_poolFreed[2];     // Blocks freed by thread that doesn't own their pool.
+#endif // BNET_CONFIG_IO_THREAD
+		uint32_t m_poolLimit;
+		RecvBufferPool m_recvBufferPool;
+		PoolStats m_poolStats;
+		RecvBufferStats m_recvBufferStats;
+		Connections* m_connections;
+		ListenSockets* m_listenSockets;
+		HandleList m_flush;
+		HandleList* m_groups[BNET_CONFIG_MAX_GROUPS];
+		bx::HandleAllocT<BNET_CONFIG_MAX_GROUPS> m_groupHandle;
+
+		HandleList m_closed;
+
+		Lz4Table* m_lz4Table;
+		Lz4Dictionary* m_dictionaries[BNET_CONFIG_MAX_DICTIONARIES];
+		uint8_t m_offerCodec; // Compression offered on new framed connections.
+		uint8_t m_offerDictionary;
+		uint16_t m_offerThreshold;
+		CompressionStats m_compressionStats;
+		TrafficStats m_trafficStats;
+		TrafficStats m_retiredStats; // Counters of destroyed connections.
+		Resolver m_resolver;
+		TimerWheel m_timers;
+		UserTimer m_userTimers[BNET_CONFIG_MAX_TIMERS];
+		bx::HandleAllocT<BNET_CONFIG_MAX_TIMERS> m_timerHandle;
+
+#if BNET_CONFIG_UDP
+		UdpBatch m_udpBatch;
+		UdpPeers m_udpPeers;
+		uint64_t m_udpSecret[2];
+#endif // BNET_CONFIG_UDP
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		Histogram m_latency[Latency::Count];
+		RecvLatency* m_recvLatency;
+		LatencyStats m_latencyStats;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+		static void resolverWake(void* _userData)
+		{
+#if BNET_CONFIG_IO_THREAD
+			Context* ctx = (Context*)_userData;
+			if (ctx->m_ioThread)
+			{
+				ctx->wake();
+			}
+#else
+			BX_UNUSED(_userData);
+#endif // BNET_CONFIG_IO_THREAD
+		}
+
+		void pushResolved(const Address* _addrs, uint32_t _num, uint64_t _userData)
+		{
+			const uint32_t ip = getIpv4(_addrs, _num);
+			const uint32_t header = 1+sizeof(ip)+sizeof(_userData)+1;
+
+			Message* msg = msgAlloc(this, invalidHandle, header + _num*sizeof(Address), true);
+			msg->data[0] = MessageId::Resolved;
+			memcpy(&msg->data[1], &ip, sizeof(ip) );
+			memcpy(&msg->data[1+sizeof(ip)], &_userData, sizeof(_userData) );
+			msg->data[header-1] = uint8_t(_num);
+			memcpy(&msg->data[header], _addrs, _num*sizeof(Address) );
+			push(msg);
+		}
+
+		void updateResolver()
+		{
+			for (ResolveRequest* req = m_resolver.pop(); NULL != req; req = m_resolver.pop() )
+			{
+				for (ResolveRequest* it = req; NULL != it; it = it->waiting)
+				{
+					pushResolved(req->addrs, req->num, it->userData);
+				}
+
+				m_resolver.free(req);
+			}
+		}
+
+		/// Cost depends only on number of expired timers, connections
+		/// without expired timers are not touched.
+		void updateTimers()
+		{
+			m_timers.update(bx::getHPCounter() );
+
+			for (Timer* timer = m_timers.pop(); NULL != timer; timer = m_timers.pop() )
+			{
+				const uint16_t idx = uint16_t(timer->key);
+				const TimerKind::Enum kind = TimerKind::Enum(timer->key>>16);
+
+				if (TimerKind::User != kind)
+				{
+					Connection* connection = m_connections->getFromHandle(idx);
+					connection->timeout(kind);
+					continue;
+				}
+
+				UserTimer& userTimer = m_userTimers[idx];
+				if (0 != userTimer.period)
+				{
+					// Period is counted from when timer expired, periods
+					// missed while context wasn't updated are skipped.
+					const uint64_t now = m_timers.getTick();
+					const uint64_t next = timer->expires + userTimer.period;
+					m_timers.addAt(timer, next > now ? next : now + userTimer.period);
+				}
+
+				const TimerHandle handle = { idx, userTimer.gen };
+				const uint32_t size = 1+sizeof(handle)+sizeof(userTimer.userData);
+				Message* msg = msgAlloc(this, invalidHandle, size, true);
+				msg->data[0] = MessageId::Timer;
+				memcpy(&msg->data[1], &handle, sizeof(handle) );
+				memcpy(&msg->data[1+sizeof(handle)], &userTimer.userData, sizeof(userTimer.userData) );
+				push(msg);
+			}
+		}
+
+		/// Frees connection slot once connection is closed, and all its
+		/// zero-copy messages are released.
+		void tryDestroy(uint16_t _idx, Connection* _connection)
+		{
+			if (!_connection->hasSocket()
+			&&  !_connection->hasViews() )
+			{
+				m_closed.remove(_idx);
+				unwatch(_idx);
+				addStats(m_retiredStats, _connection->getStats() );
+#if BNET_CONFIG_UDP
+				uint64_t key;
+				if (_connection->getUdpPeerKey(key) )
+				{
+					m_udpPeers.remove(key, _idx);
+				}
+#endif // BNET_CONFIG_UDP
+				m_connections->destroy(_connection);
+			}
+		}
+
+		void updateClosed()
+		{
+			while (0 != m_closed.getNum() )
+			{
+				uint16_t idx = m_closed.get(m_closed.getNum()-1);
+				m_closed.remove(idx);
+				tryDestroy(idx, m_connections->getFromHandle(idx) );
+			}
+		}
+
+		/// Payload references are released only by thread sending
+		/// messages, so reference count is set once before queuing.
+		bool share(Message* _msg, uint16_t _refs)
+		{
+			BX_CHECK(_msg->data[0] >= MessageId::UserDefined, "Sending message with MessageId below UserDefined is not allowed!");
+
+			if (0 == _refs)
+			{
+				release(_msg);
+				return false;
+			}
+
+			getHeader(_msg)->refs = _refs;
+			return true;
+		}
+
+		Message* allocShared(Message* _payload, Handle _handle)
+		{
+			Message* msg = msgAlloc(this, _handle, sizeof(Message*), true);
+			getHeader(msg)->flags = uint8_t(MessageFlags::Shared | (getHeader(_payload)->flags & MessageFlags::Priority) );
+			getPayload(msg) = _payload;
+
+			// Frame length prefix in front of payload is written by each
+			// connection, with same value.
+			msg->data = _payload->data;
+			msg->size = _payload->size;
+			return msg;
+		}
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		/// Stamps message sent by user, loopback messages and markers are
+		/// not measured.
+		static void stamp(Message* _msg)
+		{
+			if (invalidHandle.idx != _msg->handle.idx
+			&&  Internal::None == getMarker(_msg) )
+			{
+				getHeader(_msg)->time = bx::getHPCounter();
+			}
+		}
+
+		/// Records receive latency of message returned by `recv`. Clock
+		/// is read once per `recv` call, _now is 0 until it's read.
+		void recordRecv(Message* _msg, int64_t& _now)
+		{
+			const int64_t time = getHeader(_msg)->time;
+			if (0 != time)
+			{
+				_now = 0 != _now ? _now : bx::getHPCounter();
+
+				RecvLatency& recv = m_recvLatency[_msg->handle.idx];
+				if (NULL == recv.histogram)
+				{
+					recv.histogram = BX_NEW(m_allocator, Histogram);
+					recv.gen = _msg->handle.gen;
+				}
+				else if (recv.gen != _msg->handle.gen)
+				{
+					// Slot was reused by another connection.
+					recv.histogram->reset();
+					recv.gen = _msg->handle.gen;
+				}
+
+				const uint64_t latency = uint64_t(_now - time);
+				recv.histogram->record(latency);
+				m_latency[Latency::Recv].record(latency);
+			}
+		}
+
+		/// Histogram is NULL when nothing was measured yet.
+		const LatencyStats* getLatencyStats(Histogram* _histogram, bool _reset)
+		{
+			if (NULL == _histogram)
+			{
+				memset(&m_latencyStats, 0, sizeof(m_latencyStats) );
+				return &m_latencyStats;
+			}
+
+			const uint64_t freq = bx::getHPFrequency();
+			m_latencyStats.count  = _histogram->getCount();
+			m_latencyStats.meanNs = ticksToNs(_histogram->getMean(), freq);
+			m_latencyStats.p50Ns  = ticksToNs(_histogram->getPercentile(500), freq);
+			m_latencyStats.p99Ns  = ticksToNs(_histogram->getPercentile(990), freq);
+			m_latencyStats.p999Ns = ticksToNs(_histogram->getPercentile(999), freq);
+			m_latencyStats.maxNs  = ticksToNs(_histogram->getMax(), freq);
+
+			if (_reset)
+			{
+				_histogram->reset();
+			}
+
+			return &m_latencyStats;
+		}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+		void updateAll()
+		{
+			if (NULL != m_listenSockets)
+			{
+				for (uint16_t ii = 0, num = m_listenSockets->getNumHandles(); ii < num; ++ii)
+				{
+					ListenSocket* listenSocket = m_listenSockets->getFromHandleAt(ii);
+					listenSocket->update();
+				}
+			}
+
+			for (uint32_t ii = 0, num = m_connections->getNumHandles(); ii < num; ++ii)
+			{
+				Connection* connection = m_connections->getFromHandleAt(ii);
+				connection->update();
+			}
+		}
+
+#if BNET_CONFIG_EPOLL
+		static const uint32_t ListenKey = UINT32_C(0x10000);
+		static const uint32_t WakeKey   = UINT32_C(0x20000);
+
+		void updateReady(uint32_t _num)
+		{
+			for (uint32_t ii = 0; ii < _num; ++ii)
+			{
+				uint32_t key = m_poller.getKey(ii);
+				uint16_t idx = uint16_t(key);
+
+				if (0 != (key & WakeKey) )
+				{
+					// I/O thread wakeup, or io_uring completions, handled
+					// by I/O thread loop.
+				}
+				else if (0 != (key & ListenKey) )
+				{
+					ListenSocket* listenSocket = m_listenSockets->getFromHandle(idx);
+					listenSocket->update();
+				}
+				else
+				{
+					m_pending.add(idx);
+				}
+			}
+
+			// Ready sockets and sockets that must be serviced every tick
+			// (handshake, edge-triggered reads that haven't hit EAGAIN).
+			for (uint32_t ii = m_pending.getNum(); 0 < ii; --ii)
+			{
+				if (ii > m_pending.getNum() )
+				{
+					// Connections were removed by API call while lock
+					// was yielded.
+					continue;
+				}
+
+				uint16_t idx = m_pending.get(uint16_t(ii-1) );
+				Connection* connection = m_connections->getFromHandle(idx);
+				connection->update();
+				updateWritable(idx, connection);
+
+				if (!connection->needsUpdate() )
+				{
+					m_pending.remove(idx);
+#if BNET_CONFIG_IO_URING
+					armUring(idx, connection);
+#endif // BNET_CONFIG_IO_URING
+				}
+
+				yieldLock();
+			}
+
+#if BNET_CONFIG_IO_URING
+			if (m_uring.isValid() )
+			{
+				updateUring();
+			}
+#endif // BNET_CONFIG_IO_URING
+		}
+
+		void watch(ListenSocket* _listenSocket)
+		{
+			if (m_poller.isValid()
+			&&  INVALID_SOCKET != _listenSocket->getSocket() )
+			{
+				uint16_t idx = m_listenSockets->getHandle(_listenSocket);
+#if BNET_CONFIG_IO_URING
+				if (m_uring.isValid()
+				&&  !_listenSocket->isUdp() )
+				{
+					m_uringListenSerial[idx] = ++m_uringNextSerial;
+					if (m_uring.accept(_listenSocket->getSocket(), uringKey(UringTag::Accept, idx, m_uringListenSerial[idx]) ) )
+					{
+						return;
+					}
+
+					m_uringListenSerial[idx] = 0;
+				}
+#endif // BNET_CONFIG_IO_URING
+				m_poller.add(_listenSocket->getSocket(), idx|ListenKey);
+			}
+		}
+
+		void watch(Connection* _connection)
+		{
+			if (m_poller.isValid()
+			&&  _connection->hasSocket() )
+			{
+				uint16_t idx = m_connections->getHandle(_connection);
+#if BNET_CONFIG_IO_URING
+				if (m_uring.isValid()
+				&&  !_connection->isSecure()
+				&&  !_connection->isUdp() )
+				{
+					// Handshake is done with polling, after that socket is
+					// handed over to io_uring.
+					_connection->setUring(true);
+					m_pending.add(idx);
+					return;
+				}
+#endif // BNET_CONFIG_IO_URING
+				m_poller.add(_connection->getSocket(), idx);
+				m_pending.add(idx);
+			}
+		}
+
+		void unwatch(uint16_t _idx)
+		{
+			m_flush.remove(_idx);
+
+			if (m_pending.isValid() )
+			{
+				m_pending.remove(_idx);
+				m_writable.remove(_idx);
+			}
+
+#if BNET_CONFIG_IO_URING
+			if (m_sending.isValid() )
+			{
+				m_sending.remove(_idx);
+				m_uringSerial[_idx] = 0;
+			}
+#endif // BNET_CONFIG_IO_URING
+		}
+
+		void updatePending(Connection* _connection)
+		{
+			if (!m_poller.isValid() )
+			{
+				return;
+			}
+
+			uint16_t idx = m_connections->getHandle(_connection);
+
+#if BNET_CONFIG_IO_URING
+			if (_connection->isUring() )
+			{
+				if (0 != m_uringSerial[idx])
+				{
+					m_sending.add(idx);
+				}
+				return;
+			}
+#endif // BNET_CONFIG_IO_URING
+
+			updateWritable(idx, _connection);
+
+			if (_connection->needsUpdate() )
+			{
+				m_pending.add(idx);
+			}
+		}
+
+		/// Socket is watched for writability only while connection has
+		/// partially written frame.
+		void updateWritable(uint16_t _idx, Connection* _connection)
+		{
+			const bool writable = _connection->isSendPending();
+			if (writable == m_writable.has(_idx) )
+			{
+				return;
+			}
+
+			if (writable)
+			{
+				m_writable.add(_idx);
+			}
+			else
+			{
+				m_writable.remove(_idx);
+			}
+
+			if (_connection->hasSocket() )
+			{
+				m_poller.mod(_connection->getSocket(), _idx, writable);
+			}
+		}
+
+		Poller m_poller;
+		HandleList m_pending;
+		HandleList m_writable;
+#else
+		void watch(ListenSocket* /*_listenSocket*/)
+		{
+		}
+
+		void watch(Connection* /*_connection*/)
+		{
+		}
+
+		void unwatch(uint16_t _idx)
+		{
+			m_flush.remove(_idx);
+		}
+
+		void updatePending(Connection* /*_connection*/)
+		{
+		}
+#endif // BNET_CONFIG_EPOLL
+
+#if BNET_CONFIG_IO_URING
+	public:
+		void uringCancel(Handle _handle, SOCKET _socket, uint32_t _numOrphans)
+		{
+			m_uringOrphans += _numOrphans;
+			m_uringSerial[_handle.idx] = 0;
+			m_sending.remove(_handle.idx);
+			if (!m_uring.cancel(_socket, UringTag::None) )
+			{
+				BX_TRACE("Disconnect %d - io_uring is full, requests are not canceled.", _handle.idx);
+			}
+		}
+
+	private:
+		static uint64_t uringKey(UringTag::Enum _tag, uint16_t _idx, uint32_t _serial)
+		{
+			return uint64_t(_serial)<<32
+				| uint64_t(_idx)<<8
+				| _tag
+				;
+		}
+
+		void armUring(uint16_t _idx, Connection* _connection)
+		{
+			if (_connection->isUring()
+			&&  _connection->hasSocket()
+			&&  0 == m_uringSerial[_idx])
+			{
+				m_uringSerial[_idx] = ++m_uringNextSerial;
+				if (!m_uring.recv(_connection->getSocket(), uringKey(UringTag::Recv, _idx, m_uringSerial[_idx]) ) )
+				{
+					// Armed again on next tick.
+					m_uringSerial[_idx] = 0;
+					m_pending.add(_idx);
+					return;
+				}
+
+				if (_connection->hasOutgoing() )
+				{
+					m_sending.add(_idx);
+				}
+			}
+		}
+
+		void updateUring()
+		{
+			// Completions are reaped before sends are queued, so
+			// connections with send completed queue next chain on same
+			// tick, instead of waiting for I/O thread to wake up again.
+			reapUring();
+
+			while (0 != m_sending.getNum() )
+			{
+				uint16_t idx = m_sending.get(m_sending.getNum()-1);
+				m_sending.remove(idx);
+
+				Connection* connection = m_connections->getFromHandle(idx);
+				if (!connection->uringSend(m_uring) )
+				{
+					// Submission queue is full, connection and ones
+					// behind it send once completions are reaped.
+					m_sending.add(idx);
+					break;
+				}
+			}
+
+			// All sends, receives and accepts queued since last tick are
+			// submitted with a single syscall.
+			m_uring.submit();
+		}
+
+		void reapUring()
+		{
+			int64_t now = 0; // Completions reaped together are measured with same time.
+			io_uring_cqe cqe;
+			while (m_uring.peek(cqe) )
+			{
+				uint64_t userData = cqe.user_data;
+				switch (userData & UringTag::Mask)
+				{
+				case UringTag::Send:
+					{
+						Message* msg = (Message*)uintptr_t(userData & ~uint64_t(UringTag::Mask) );
+						if (!isValid(msg->handle) )
+						{
+							--m_uringOrphans;
+							release(msg);
+						}
+						else
+						{
+							uint16_t idx = msg->handle.idx;
+							Connection* connection = m_connections->getFromHandle(idx);
+							if (connection->uringSendComplete(msg, cqe.res, now) )
+							{
+								m_sending.add(idx);
+							}
+						}
+					}
+					break;
+
+				case UringTag::Recv:
+					uringRecvComplete(cqe);
+					break;
+
+				case UringTag::Accept:
+					uringAcceptComplete(cqe);
+					break;
+
+				default:
+					break;
+				}
+			}
+		}
+
+		void uringRecvComplete(const io_uring_cqe& _cqe)
+		{
+			uint16_t idx = uint16_t(_cqe.user_data>>8);
+			uint32_t serial = uint32_t(_cqe.user_data>>32);
+
+			if (serial == m_uringSerial[idx])
+			{
+				Connection* connection = m_connections->getFromHandle(idx);
+
+				bool paused = false;
+
+				if (0 < _cqe.res)
+				{
+					paused = !connection->uringRecv(m_uring.getBuffer(_cqe.flags), _cqe.res);
+
+					if (paused
+					&&  0 != (_cqe.flags & IORING_CQE_F_MORE) )
+					{
+						// Receive buffer is full, multishot receive is
+						// stopped, and armed again once it drains.
+						m_uring.cancelRequest(_cqe.user_data, UringTag::None);
+					}
+				}
+				else if (0 == _cqe.res)
+				{
+					BX_TRACE("Disconnect %d - Host closed connection.", idx);
+					connection->disconnect(DisconnectReason::HostClosed);
+				}
+				else if (-ECANCELED == _cqe.res)
+				{
+					paused = true;
+				}
+				else if (-ENOBUFS != _cqe.res)
+				{
+					BX_TRACE("Disconnect %d - Receive failed. %d", idx, -_cqe.res);
+					connection->disconnect(DisconnectReason::RecvFailed);
+				}
+
+				if (0 == (_cqe.flags & IORING_CQE_F_MORE)
+				&&  connection->hasSocket()
+				&&  (paused || !m_uring.recv(connection->getSocket(), _cqe.user_data) ) )
+				{
+					// Armed again on tick once receive buffer drained.
+					m_uringSerial[idx] = 0;
+					m_pending.add(idx);
+				}
+			}
+
+			m_uring.recycle(_cqe.flags);
+		}
+
+		void uringAcceptComplete(const io_uring_cqe& _cqe)
+		{
+			uint16_t idx = uint16_t(_cqe.user_data>>8);
+			uint32_t serial = uint32_t(_cqe.user_data>>32);
+
+			if (serial != m_uringListenSerial[idx])
+			{
+				if (0 <= _cqe.res)
+				{
+					::closesocket(_cqe.res);
+				}
+				return;
+			}
+
+			ListenSocket* listenSocket = m_listenSockets->getFromHandle(idx);
+
+			if (0 <= _cqe.res)
+			{
+				sockaddr_in addr;
+				socklen_t len = sizeof(addr);
+				if (0 == ::getpeername(_cqe.res, (sockaddr*)&addr, &len) )
+				{
+					listenSocket->accept(_cqe.res, addr);
+				}
+				else
+				{
+					::closesocket(_cqe.res);
+				}
+			}
+
+			if (0 == (_cqe.flags & IORING_CQE_F_MORE)
+			&&  !m_uring.accept(listenSocket->getSocket(), _cqe.user_data) )
+			{
+				BX_TRACE("Listen %d - io_uring is full, accepting with poller.", idx);
+				m_uringListenSerial[idx] = 0;
+				m_poller.add(listenSocket->getSocket(), idx|ListenKey);
+			}
+		}
+
+		void shutdownUring()
+		{
+			for (uint16_t ii = 0, num = m_connections->getNumHandles(); ii < num; ++ii)
+			{
+				Connection* connection = m_connections->getFromHandleAt(ii);
+				connection->disconnect();
+			}
+
+			if (NULL != m_listenSockets)
+			{
+				for (uint16_t ii = 0, num = m_listenSockets->getNumHandles(); ii < num; ++ii)
+				{
+					ListenSocket* listenSocket = m_listenSockets->getFromHandleAt(ii);
+					m_uring.cancel(listenSocket->getSocket(), UringTag::None);
+					listenSocket->close();
+				}
+			}
+
+			// Wait for kernel to let go of in-flight send buffers.
+			for (uint32_t ii = 0; 0 != m_uringOrphans && ii < 1000; ++ii)
+			{
+				m_uring.submit(1);
+
+				io_uring_cqe cqe;
+				while (m_uring.peek(cqe) )
+				{
+					if (UringTag::Send == (cqe.user_data & UringTag::Mask) )
+					{
+						--m_uringOrphans;
+						release( (Message*)uintptr_t(cqe.user_data & ~uint64_t(UringTag::Mask) ) );
+					}
+					m_uring.recycle(cqe.flags);
+				}
+			}
+
+			m_uring.shutdown();
+			m_sending.shutdown();
+			BX_FREE(m_allocator, m_uringSerial);
+			m_uringSerial = NULL;
+
+			if (NULL != m_uringListenSerial)
+			{
+				BX_FREE(m_allocator, m_uringListenSerial);
+				m_uringListenSerial = NULL;
+			}
+		}
+
+		Uring m_uring;
+		HandleList m_sending;
+		uint32_t* m_uringSerial;
+		uint32_t* m_uringListenSerial;
+		uint32_t m_uringNextSerial;
+		uint32_t m_uringOrphans;
+#endif // BNET_CONFIG_IO_URING
+
+#if BNET_CONFIG_IO_THREAD
+		void startThread()
+		{
+			if (!m_poller.isValid() )
+			{
+				BX_TRACE("I/O thread requires epoll.");
+				return;
+			}
+
+			m_wakeFd = ::eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+			if (-1 == m_wakeFd)
+			{
+				BX_TRACE("Failed to create eventfd.");
+				return;
+			}
+
+			m_poller.add(m_wakeFd, WakeKey);
+
+#	if BNET_CONFIG_IO_URING
+			if (m_uring.isValid() )
+			{
+				m_poller.add(m_uring.getFd(), WakeKey);
+			}
+#	endif // BNET_CONFIG_IO_URING
+
+			m_quit = false;
+			m_ioThread = true;
+			applyPoolLimit();
+			m_thread.init(threadFunc, this);
+		}
+
+		void stopThread()
+		{
+			{
+				bx::MutexScope scope(m_lock);
+				m_quit = true;
+			}
+
+			uint64_t one = 1;
+			ssize_t result = ::write(m_wakeFd, &one, sizeof(one) );
+			BX_UNUSED(result);
+
+			m_thread.shutdown();
+			m_ioThread = false;
+
+			collectFreed(0);
+			collectFreed(1);
+			applyPoolLimit();
+
+			executeCommands();
+
+			for (Message* msg = m_ready.pop(); NULL != msg; msg = m_ready.pop() )
+			{
+				release(msg);
+			}
+
+			::close(m_wakeFd);
+			m_wakeFd = -1;
+		}
+
+		static int32_t threadFunc(void* _userData)
+		{
+			Context* ctx = (Context*)_userData;
+			ctx->threadLoop();
+			return 0;
+		}
+
+		void threadLoop()
+		{
+			s_ioThreadCtx = this;
+
+			int32_t timeout = 0;
+
+			for (;;)
+			{
+				const uint32_t num = m_poller.wait(timeout);
+
+				bx::MutexScope scope(m_lock);
+				if (m_quit)
+				{
+					break;
+				}
+
+				bx::atomicCompareAndSwap<int32_t>(&m_wakePending, 1, 0);
+				uint64_t count;
+				ssize_t result = ::read(m_wakeFd, &count, sizeof(count) );
+				BX_UNUSED(result);
+
+				executeCommands();
+				updateResolver();
+				updateTimers();
+				updateReady(num);
+				updateClosed();
+
+				for (Message* msg = pop(); NULL != msg; msg = pop() )
+				{
+					m_ready.push(msg);
+				}
+
+				// Sockets in handshake, or with unread data, are ticked
+				// without waiting for readiness.
+				timeout = 0 != m_pending.getNum() ? 1 : BNET_CONFIG_IO_THREAD_WAIT_MS;
+#if BNET_CONFIG_IO_URING
+				// Sends that didn't fit into full submission queue are
+				// retried, even if submit failed and nothing completes.
+				timeout = m_sending.isValid() && 0 != m_sending.getNum() ? 1 : timeout;
+#endif // BNET_CONFIG_IO_URING
+
+				if (0 != m_timers.getNum() )
+				{
+					const uint32_t wait = m_timers.getWaitTicks()*BNET_CONFIG_TIMER_TICK_MS;
+					timeout = int32_t(wait) < timeout ? int32_t(wait) : timeout;
+				}
+			}
+		}
+
+		/// Wakes I/O thread, eventfd is written only once until I/O thread
+		/// picks it up.
+		void wake()
+		{
+			if (0 == bx::atomicCompareAndSwap<int32_t>(&m_wakePending, 0, 1) )
+			{
+				uint64_t one = 1;
+				ssize_t result = ::write(m_wakeFd, &one, sizeof(one) );
+				BX_UNUSED(result);
+			}
+		}
+
+		bool isIoThread() const
+		{
+			return this == s_ioThreadCtx;
+		}
+
+		/// Moves blocks freed by other thread to pool free lists. Called
+		/// only by pool owner, or by API call holding lock.
+		void collectFreed(uint8_t _pool)
+		{
+			MessagePool& pool = 0 == _pool ? m_pool : m_ioPool;
+			for (Message* msg = m_poolFreed[_pool].pop(); NULL != msg; msg = m_poolFreed[_pool].pop() )
+			{
+				pool.free(msg);
+			}
+		}
+
+		void executeCommands()
+		{
+			for (Message* msg = m_commands.pop(); NULL != msg; msg = m_commands.pop() )
+			{
+				if (0 != (getHeader(msg)->flags & MessageFlags::View) )
+				{
+					releaseMessageView(msg);
+				}
+				else
+				{
+					queueMessage(msg);
+				}
+			}
+
+			flushMessages();
+		}
+
+		bx::Thread m_thread;
+		bx::Mutex m_lock;
+		MpscMessageQueue m_commands;
+		MpscMessageQueue m_ready;
+		int m_wakeFd;
+		int32_t m_wakePending;
+		int32_t m_apiWaiting;
+		bool m_ioThread;
+		bool m_quit;
+#endif // BNET_CONFIG_IO_THREAD
+
+		MessageQueue m_incoming;
+
+		SSL_CTX* m_sslCtx;
+		SSL_CTX* m_sslCtxServer;
+	};
+
+	static Context* s_ctx[BNET_CONFIG_MAX_CONTEXTS];
+	static bx::HandleAllocT<BNET_CONFIG_MAX_CONTEXTS> s_ctxHandle;
+	static ContextHandle s_defaultCtx = invalidContextHandle;
+
+#if BNET_CONFIG_OPENSSL
+	static void* sslMalloc(size_t _size)
+	{
+		return BX_ALLOC(g_allocator, _size);
+	}
+
+	static void* sslRealloc(void* _ptr, size_t _size)
+	{
+		return BX_REALLOC(g_allocator, _ptr, _size);
+	}
+
+	static void sslFree(void* _ptr)
+	{
+		return BX_FREE(g_allocator, _ptr);
+	}
+
+	typedef void* (*MallocFn)(size_t _size);
+	static MallocFn s_sslMalloc;
+
+	typedef void* (*ReallocFn)(void* _ptr, size_t _size);
+	static ReallocFn s_sslRealloc;
+
+	typedef void (*FreeFn)(void* _ptr);
+	static FreeFn s_sslFree;
+#endif // BNET_CONFIG_OPENSSL
+
+	/// Process wide state is initialized with first context, and released
+	/// with last one.
+	static void globalInit(bx::AllocatorI* _allocator)
+	{
+		if (0 != s_ctxHandle.getNumHandles() )
+		{
+			return;
+		}
+
+		g_allocator = _allocator;
+
+#if BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
+		WSADATA wsaData;
+		WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif // BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
+
+#if BNET_CONFIG_OPENSSL
+		CRYPTO_get_mem_functions(&s_sslMalloc, &s_sslRealloc, &s_sslFree);
+		CRYPTO_set_mem_functions(sslMalloc, sslRealloc, sslFree);
+		SSL_library_init();
+#	if BNET_CONFIG_DEBUG
+		SSL_load_error_strings();
+#	endif // BNET_CONFIG_DEBUG
+#endif // BNET_CONFIG_OPENSSL
+	}
+
+	static void globalShutdown()
+	{
+		if (0 != s_ctxHandle.getNumHandles() )
+		{
+			return;
+		}
+
+#if BNET_CONFIG_OPENSSL
+		CRYPTO_set_mem_functions(s_sslMalloc, s_sslRealloc, s_sslFree);
+#endif // BNET_CONFIG_OPENSSL
+
+#if BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
+		WSACleanup();
+#endif // BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
+
+		g_allocator = &s_allocatorStub;
+	}
+
+	static Context* getContext(ContextHandle _handle)
+	{
+		BX_CHECK(s_ctxHandle.isValid(_handle.idx), "Invalid context handle %d!", _handle.idx);
+		return s_ctx[_handle.idx];
+	}
+
+	static Context* getContext(Message* _msg)
+	{
+		return getHeader(_msg)->ctx;
+	}
+
+	Handle ctxAccept(Context* _ctx, Handle _listenHandle, SOCKET _socket, uint32_t _ip, uint16_t _port, bool _raw, X509* _cert, EVP_PKEY* _key)
+	{
+		return _ctx->accept(_listenHandle, _socket, _ip, _port, _raw, _cert, _key);
+	}
+
+#if BNET_CONFIG_IO_URING
+	void ctxUringCancel(Context* _ctx, Handle _handle, SOCKET _socket, uint32_t _numOrphans)
+	{
+		_ctx->uringCancel(_handle, _socket, _numOrphans);
+	}
+#endif // BNET_CONFIG_IO_URING
+
+	void ctxPush(Context* _ctx, Handle _handle, MessageId::Enum _id)
+	{
+		Message* msg = msgAlloc(_ctx, _handle, 1, true);
+		msg->data[0] = _id;
+		_ctx->push(msg);
+	}
+
+	void ctxPush(Context* _ctx, Message* _msg)
+	{
+		_ctx->push(_msg);
+	}
+
+	void ctxDestroy(Context* _ctx, Handle _handle)
+	{
+		_ctx->closed(_handle);
+	}
+
+	void ctxWatch(Context* _ctx, Handle _handle)
+	{
+		_ctx->rewatch(_handle);
+	}
+
+	TimerWheel& ctxTimers(Context* _ctx)
+	{
+		return _ctx->getTimers();
+	}
+
+	bx::AllocatorI* ctxAllocator(Context* _ctx)
+	{
+		return _ctx->getAllocator();
+	}
+
+	void ctxQueue(Context* _ctx, Message* _msg)
+	{
+		_ctx->queueInternal(_msg);
+	}
+
+	Lz4Table* ctxLz4Table(Context* _ctx)
+	{
+		return _ctx->getLz4Table();
+	}
+
+	const Lz4Dictionary* ctxDictionary(Context* _ctx, uint8_t _id)
+	{
+		return _ctx->getDictionary(_id);
+	}
+
+#if BNET_CONFIG_UDP
+	UdpBatch& ctxUdpBatch(Context* _ctx)
+	{
+		return _ctx->getUdpBatch();
+	}
+
+	void ctxAcceptUdp(Context* _ctx, Handle _listenHandle, SOCKET _listenSocket, const sockaddr_in& _local, const sockaddr_in& _remote, uint64_t _cookie)
+	{
+		_ctx->acceptUdp(_listenHandle, _listenSocket, _local, _remote, _cookie);
+	}
+#endif // BNET_CONFIG_UDP
+
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+	Histogram& ctxLatency(Context* _ctx, Latency::Enum _latency)
+	{
+		return _ctx->getLatencyHistogram(_latency);
+	}
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+	void* ctxAllocRecvBuffer(Context* _ctx, uint32_t _size)
+	{
+		return _ctx->getRecvBufferPool().alloc(_size);
+	}
+
+	void ctxFreeRecvBuffer(Context* _ctx, void* _ptr, uint32_t _size)
+	{
+		_ctx->getRecvBufferPool().free(_ptr, _size);
+	}
+
+	Message* msgAlloc(Context* _ctx, Handle _handle, uint32_t _size, bool _incoming, Internal::Enum _type)
+	{
+		uint16_t offset = _incoming ? 0 : 2;
+		Message* msg = (Message*)_ctx->allocMessage(sizeof(Message) + offset + _size);
+		getHeader(msg)->ctx = _ctx;
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		getHeader(msg)->time = 0;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+		msg->size = _size;
+		msg->handle = _handle;
+		uint8_t* data = (uint8_t*)msg + sizeof(Message);
+		data[0] = _type;
+		msg->data = data + offset;
+		return msg;
+	}
+
+	void msgRelease(Message* _msg)
+	{
+		Context* ctx = getContext(_msg);
+
+		if (0 != (getHeader(_msg)->flags & MessageFlags::View) )
+		{
+			ctx->releaseView(_msg);
+			return;
+		}
+
+		if (0 != (getHeader(_msg)->flags & MessageFlags::Shared) )
+		{
+			Message* payload = getPayload(_msg);
+			ctx->freeMessage(_msg);
+
+			if (0 == --getHeader(payload)->refs)
+			{
+				ctx->freeMessage(payload);
+			}
+			return;
+		}
+
+		ctx->freeMessage(_msg);
+	}
+
+	ContextHandle createContext(uint16_t _maxConnections, uint16_t _maxListenSockets, const char* _certs[], bx::AllocatorI* _allocator, bool _ioThread)
+	{
+		bx::AllocatorI* allocator = NULL != _allocator ? _allocator : &s_allocatorStub;
+		globalInit(allocator);
+
+		ContextHandle handle = { s_ctxHandle.alloc() };
+		if (isValid(handle) )
+		{
+			Context* ctx = BX_NEW(allocator, Context)(allocator);
+			ctx->init(_maxConnections, _maxListenSockets, _certs, _ioThread);
+			s_ctx[handle.idx] = ctx;
+		}
+		else
+		{
+			BX_TRACE("Too many contexts.");
+			globalShutdown();
+		}
+
+		return handle;
+	}
+
+	void destroyContext(ContextHandle _handle)
+	{
+		Context* ctx = getContext(_handle);
+		bx::AllocatorI* allocator = ctx->getAllocator();
+		ctx->shutdown();
+		ctx->purgePool();
+		BX_DELETE(allocator, ctx);
+
+		s_ctx[_handle.idx] = NULL;
+		s_ctxHandle.free(_handle.idx);
+		globalShutdown();
+	}
+
+	Handle listen(ContextHandle _ctx, uint32_t _ip, uint16_t _port, bool _raw, const char* _cert, const char* _key)
+	{
+		return getContext(_ctx)->listen(_ip, _port, _raw, _cert, _key);
+	}
+
+	Handle listenShared(ContextHandle _ctx, uint32_t _ip, uint16_t _port, uint16_t _numShards, bool _raw, const char* _cert, const char* _key)
+	{
+		return getContext(_ctx)->listen(_ip, _port, _raw, _cert, _key, true, _numShards);
+	}
+
+	Handle listenUdp(ContextHandle _ctx, uint32_t _ip, uint16_t _port)
+	{
+		return getContext(_ctx)->listenUdp(_ip, _port);
+	}
+
+	void stop(ContextHandle _ctx, Handle _handle)
+	{
+		getContext(_ctx)->stop(_handle);
+	}
+
+	Handle connect(ContextHandle _ctx, const Address* _addrs, uint32_t _num, uint16_t _port, bool _raw, bool _secure)
+	{
+		return getContext(_ctx)->connect(_addrs, _num, _port, _raw, _secure);
+	}
+
+	Handle connect(ContextHandle _ctx, uint32_t _ip, uint16_t _port, bool _raw, bool _secure)
+	{
+		Address addr = toAddress(_ip);
+		return getContext(_ctx)->connect(&addr, 1, _port, _raw, _secure);
+	}
+
+	Handle connectUdp(ContextHandle _ctx, uint32_t _ip, uint16_t _port)
+	{
+		return getContext(_ctx)->connectUdp(_ip, _port);
+	}
+
+	void disconnect(ContextHandle _ctx, Handle _handle, bool _finish)
+	{
+		getContext(_ctx)->disconnect(_handle, _finish);
+	}
+
+	void notify(ContextHandle _ctx, Handle _handle, uint64_t _userData, Priority::Enum _priority)
+	{
+		getContext(_ctx)->notify(_handle, _userData, _priority);
+	}
+
+	OutgoingMessage* alloc(ContextHandle _ctx, Handle _handle, uint16_t _size, Priority::Enum _priority)
+	{
+		Message* msg = msgAlloc(getContext(_ctx), _handle, _size);
+		setPriority(msg, _priority);
+		return msg;
+	}
+
+	void sendLarge(ContextHandle _ctx, Handle _handle, const void* _data, uint32_t _size)
+	{
+		getContext(_ctx)->sendLarge(_handle, (const uint8_t*)_data, _size);
+	}
+
+	void setReassembly(ContextHandle _ctx, Handle _handle, uint32_t _maxSize)
+	{
+		getContext(_ctx)->setReassembly(_handle, _maxSize);
+	}
+
+	void setIdleTimeout(ContextHandle _ctx, Handle _handle, uint32_t _ms)
+	{
+		getContext(_ctx)->setIdleTimeout(_handle, _ms);
+	}
+
+	void setSendWatermarks(ContextHandle _ctx, Handle _handle, uint32_t _low, uint32_t _high)
+	{
+		getContext(_ctx)->setSendWatermarks(_handle, _low, _high);
+	}
+
+	void setSendLimit(ContextHandle _ctx, Handle _handle, uint32_t _size, SendLimit::Enum _policy)
+	{
+		getContext(_ctx)->setSendLimit(_handle, _size, _policy);
+	}
+
+	uint32_t getSendQueueSize(ContextHandle _ctx, Handle _handle)
+	{
+		return getContext(_ctx)->getSendQueueSize(_handle);
+	}
+
+	const TrafficStats* getStats(ContextHandle _ctx, Handle _handle)
+	{
+		return getContext(_ctx)->getStats(_handle);
+	}
+
+	const TrafficStats* getGlobalStats(ContextHandle _ctx)
+	{
+		return getContext(_ctx)->getGlobalStats();
+	}
+
+	const LatencyStats* getLatency(ContextHandle _ctx, Handle _handle, Latency::Enum _latency, bool _reset)
+	{
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		return getContext(_ctx)->getLatency(_handle, _latency, _reset);
+#else
+		BX_UNUSED(_ctx);
+		BX_UNUSED(_handle);
+		BX_UNUSED(_latency);
+		BX_UNUSED(_reset);
+		return NULL;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+	}
+
+	const LatencyStats* getGlobalLatency(ContextHandle _ctx, Latency::Enum _latency, bool _reset)
+	{
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		return getContext(_ctx)->getGlobalLatency(_latency, _reset);
+#else
+		BX_UNUSED(_ctx);
+		BX_UNUSED(_latency);
+		BX_UNUSED(_reset);
+		return NULL;
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+	}
+
+	TimerHandle createTimer(ContextHandle _ctx, uint64_t _userData)
+	{
+		return getContext(_ctx)->createTimer(_userData);
+	}
+
+	void destroyTimer(ContextHandle _ctx, TimerHandle _timer)
+	{
+		getContext(_ctx)->destroyTimer(_timer);
+	}
+
+	void startTimer(ContextHandle _ctx, TimerHandle _timer, uint32_t _ms, uint32_t _periodMs)
+	{
+		getContext(_ctx)->startTimer(_timer, _ms, _periodMs);
+	}
+
+	void stopTimer(ContextHandle _ctx, TimerHandle _timer)
+	{
+		getContext(_ctx)->stopTimer(_timer);
+	}
+
+	void allocBatch(ContextHandle _ctx, OutgoingMessage** _msgs, const Handle* _handles, uint32_t _num, uint16_t _size, Priority::Enum _priority)
+	{
+		Context* ctx = getContext(_ctx);
+		for (uint32_t ii = 0; ii < _num; ++ii)
+		{
+			_msgs[ii] = msgAlloc(ctx, _handles[ii], _size);
+			setPriority(_msgs[ii], _priority);
+		}
+	}
+
+	void flush(ContextHandle _ctx)
+	{
+		getContext(_ctx)->flush();
+	}
+
+	GroupHandle createGroup(ContextHandle _ctx)
+	{
+		return getContext(_ctx)->createGroup();
+	}
+
+	void destroyGroup(ContextHandle _ctx, GroupHandle _group)
+	{
+		getContext(_ctx)->destroyGroup(_group);
+	}
+
+	void addToGroup(ContextHandle _ctx, GroupHandle _group, Handle _handle)
+	{
+		getContext(_ctx)->addToGroup(_group, _handle);
+	}
+
+	void removeFromGroup(ContextHandle _ctx, GroupHandle _group, Handle _handle)
+	{
+		getContext(_ctx)->removeFromGroup(_group, _handle);
+	}
+
+	IncomingMessage* recv(ContextHandle _ctx)
+	{
+		return getContext(_ctx)->recv();
+	}
+
+	uint32_t recv(ContextHandle _ctx, IncomingMessage** _msgs, uint32_t _max)
+	{
+		return getContext(_ctx)->recv(_msgs, _max);
+	}
+
+	void setZeroCopy(ContextHandle _ctx, Handle _handle, bool _enable)
+	{
+		getContext(_ctx)->setZeroCopy(_handle, _enable);
+	}
+
+	void setDictionary(ContextHandle _ctx, uint8_t _id, const void* _data, uint16_t _size)
+	{
+		getContext(_ctx)->setDictionary(_id, _data, _size);
+	}
+
+	void setCompression(ContextHandle _ctx, Handle _handle, Codec::Enum _codec, uint8_t _dictionary, uint16_t _threshold)
+	{
+		getContext(_ctx)->setCompression(_handle, _codec, _dictionary, _threshold);
+	}
+
+	void setDefaultCompression(ContextHandle _ctx, Codec::Enum _codec, uint8_t _dictionary, uint16_t _threshold)
+	{
+		getContext(_ctx)->setDefaultCompression(_codec, _dictionary, _threshold);
+	}
+
+	const CompressionStats* getCompressionStats(ContextHandle _ctx, Handle _handle)
+	{
+		return getContext(_ctx)->getCompressionStats(_handle);
+	}
+
+	void resolve(ContextHandle _ctx, const char* _host, uint64_t _userData)
+	{
+		getContext(_ctx)->resolve(_host, _userData);
+	}
+
+	void setResolver(ContextHandle _ctx, ResolveFn _fn, void* _userData)
+	{
+		getContext(_ctx)->setResolver(_fn, _userData);
+	}
+
+	const PoolStats* getPoolStats(ContextHandle _ctx)
+	{
+		return getContext(_ctx)->getPoolStats();
+	}
+
+	void setPoolLimit(ContextHandle _ctx, uint32_t _size)
+	{
+		getContext(_ctx)->setPoolLimit(_size);
+	}
+
+	const RecvBufferStats* getRecvBufferStats(ContextHandle _ctx)
+	{
+		return getContext(_ctx)->getRecvBufferStats();
+	}
+
+	void init(uint16_t _maxConnections, uint16_t _maxListenSockets, const char* _certs[], bx::AllocatorI* _allocator, bool _ioThread)
+	{
+		s_defaultCtx = createContext(_maxConnections, _maxListenSockets, _certs, _allocator, _ioThread);
+	}
+
+	void shutdown()
+	{
+		destroyContext(s_defaultCtx);
+		s_defaultCtx = invalidContextHandle;
+	}
+
+	Handle listen(uint32_t _ip, uint16_t _port, bool _raw, const char* _cert, const char* _key)
+	{
+		return listen(s_defaultCtx, _ip, _port, _raw, _cert, _key);
+	}
 
-			return invalidHandle;
-		}
+	Handle listenUdp(uint32_t _ip, uint16_t _port)
+	{
+		return listenUdp(s_defaultCtx, _ip, _port);
+	}
 
-		void stop(Handle _handle)
-		{
-			ListenSocket* listenSocket = { m_listenSockets->getFromHandle(_handle.idx) };
-			listenSocket->close();
-			m_listenSockets->destroy(listenSocket);
-		}
+	void stop(Handle _handle)
+	{
+		stop(s_defaultCtx, _handle);
+	}
 
-		Handle accept(Handle _listenHandle, SOCKET _socket, uint32_t _ip, uint16_t _port, bool _raw, X509* _cert, EVP_PKEY* _key)
-		{
-			Connection* connection = m_connections->create();
-			if (NULL != connection)
-			{
-				Handle handle = { m_connections->getHandle(connection) };
-				bool secure = NULL != _cert && NULL != _key;
-				connection->accept(handle, _listenHandle, _socket, _ip, _port, _raw, secure?m_sslCtxServer:NULL, _cert, _key);
-				return handle;
-			}
+	Handle connect(uint32_t _ip, uint16_t _port, bool _raw, bool _secure)
+	{
+		return connect(s_defaultCtx, _ip, _port, _raw, _secure);
+	}
 
-			return invalidHandle;
-		}
+	Handle connect(const Address* _addrs, uint32_t _num, uint16_t _port, bool _raw, bool _secure)
+	{
+		return connect(s_defaultCtx, _addrs, _num, _port, _raw, _secure);
+	}
 
-		Handle connect(uint32_t _ip, uint16_t _port, bool _raw, bool _secure)
-		{
-			Connection* connection = m_connections->create();
-			if (NULL != connection)
-			{
-				Handle handle = { m_connections->getHandle(connection) };
-				connection->connect(handle, _ip, _port, _raw, _secure?m_sslCtx:NULL);
-				return handle;
-			}
+	Handle connectUdp(uint32_t _ip, uint16_t _port)
+	{
+		return connectUdp(s_defaultCtx, _ip, _port);
+	}
 
-			return invalidHandle;
-		}
+	void disconnect(Handle _handle, bool _finish)
+	{
+		disconnect(s_defaultCtx, _handle, _finish);
+	}
 
-		void disconnect(Handle _handle, bool _finish)
-		{
-			BX_CHECK(_handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
+	void notify(Handle _handle, uint64_t _userData, Priority::Enum _priority)
+	{
+		notify(s_defaultCtx, _handle, _userData, _priority);
+	}
 
-			Connection* connection = { m_connections->getFromHandle(_handle.idx) };
-			if (_finish
-			&&  connection->hasSocket() )
-			{
-				Message* msg = msgAlloc(_handle, 0, false, Internal::Disconnect);
-				connection->send(msg);
-			}
-			else
-			{
-				BX_TRACE("Disconnect %d - Client closed connection.", _handle);
-				connection->disconnect();
+	OutgoingMessage* alloc(Handle _handle, uint16_t _size, Priority::Enum _priority)
+	{
+		return alloc(s_defaultCtx, _handle, _size, _priority);
+	}
 
-				Message* msg = msgAlloc(_handle, 2, true);
-				msg->data[0] = 0;
-				msg->data[1] = Internal::Disconnect;
-				ctxPush(msg);
-			}
-		}
+	void release(IncomingMessage* _msg)
+	{
+		msgRelease(_msg);
+	}
 
-		void notify(Handle _handle, uint64_t _userData)
+	void releaseBatch(IncomingMessage** _msgs, uint32_t _num)
+	{
+		for (uint32_t ii = 0; ii < _num; ++ii)
 		{
-			BX_CHECK(_handle.idx == invalidHandle.idx // loopback
-			      || _handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _handle.idx);
-
-			if (invalidHandle.idx != _handle.idx)
-			{
-				Message* msg = msgAlloc(_handle, sizeof(_userData), false, Internal::Notify);
-				memcpy(msg->data, &_userData, sizeof(_userData) );
-				Connection* connection = m_connections->getFromHandle(_handle.idx);
-				connection->send(msg);
-			}
-			else
-			{
-				// loopback
-				Message* msg = msgAlloc(_handle, sizeof(_userData)+1, true);
-				msg->data[0] = MessageId::Notify;
-				memcpy(&msg->data[1], &_userData, sizeof(_userData) );
-				ctxPush(msg);
-			}
+			msgRelease(_msgs[ii]);
 		}
+	}
 
-		void send(Message* _msg)
+	IncomingMessage* detach(IncomingMessage* _msg)
+	{
+		if (0 == (getHeader(_msg)->flags & MessageFlags::View) )
 		{
-			BX_CHECK(_msg->handle.idx == invalidHandle.idx // loopback
-			      || _msg->handle.idx < m_connections->getMaxHandles(), "Invalid handle %d!", _msg->handle.idx);
-
-			if (invalidHandle.idx != _msg->handle.idx)
-			{
-				Connection* connection = m_connections->getFromHandle(_msg->handle.idx);
-				connection->send(_msg);
-			}
-			else
-			{
-				// loopback
-				push(_msg);
-			}
+			return _msg;
 		}
 
-		Message* recv()
-		{
-			if (NULL != m_listenSockets)
-			{
-				for (uint16_t ii = 0, num = m_listenSockets->getNumHandles(); ii < num; ++ii)
-				{
-					ListenSocket* listenSocket = m_listenSockets->getFromHandleAt(ii);
-					listenSocket->update();
-				}
-			}
+		Message* msg = msgAlloc(getContext(_msg), _msg->handle, _msg->size, true);
+		memcpy(msg->data, _msg->data, _msg->size);
+		msgRelease(_msg);
+		return msg;
+	}
 
-			for (uint32_t ii = 0, num = m_connections->getNumHandles(); ii < num; ++ii)
-			{
-				Connection* connection = m_connections->getFromHandleAt(ii);
-				connection->update();
-			}
+	void setZeroCopy(Handle _handle, bool _enable)
+	{
+		setZeroCopy(s_defaultCtx, _handle, _enable);
+	}
 
-			Message* msg = m_incoming.pop();
+	void setDictionary(uint8_t _id, const void* _data, uint16_t _size)
+	{
+		setDictionary(s_defaultCtx, _id, _data, _size);
+	}
 
-			while (NULL != msg)
-			{
-				if (invalidHandle.idx == msg->handle.idx) // loopback
-				{
-					return msg;
-				}
+	void setCompression(Handle _handle, Codec::Enum _codec, uint8_t _dictionary, uint16_t _threshold)
+	{
+		setCompression(s_defaultCtx, _handle, _codec, _dictionary, _threshold);
+	}
+
+	void setDefaultCompression(Codec::Enum _codec, uint8_t _dictionary, uint16_t _threshold)
+	{
+		setDefaultCompression(s_defaultCtx, _codec, _dictionary, _threshold);
+	}
 
-				Connection* connection = m_connections->getFromHandle(msg->handle.idx);
+	const CompressionStats* getCompressionStats(Handle _handle)
+	{
+		return getCompressionStats(s_defaultCtx, _handle);
+	}
 
-				uint8_t id = msg->data[0];
-				if (0 == id
-				&&  Internal::Disconnect == msg->data[1])
-				{
-					m_connections->destroy(connection);
-				}
-				else if (connection->hasSocket() || MessageId::UserDefined > id)
-				{
-					return msg;
-				}
+	void resolve(const char* _host, uint64_t _userData)
+	{
+		resolve(s_defaultCtx, _host, _userData);
+	}
 
-				release(msg);
-				msg = m_incoming.pop();
-			}
+	void setResolver(ResolveFn _fn, void* _userData)
+	{
+		setResolver(s_defaultCtx, _fn, _userData);
+	}
 
-			return msg;
-		}
+	const PoolStats* getPoolStats()
+	{
+		return getPoolStats(s_defaultCtx);
+	}
 
-		void push(Message* _msg)
-		{
-			m_incoming.push(_msg);
-		}
+	const RecvBufferStats* getRecvBufferStats()
+	{
+		return getRecvBufferStats(s_defaultCtx);
+	}
 
-	private:
-		Connections* m_connections;
-		ListenSockets* m_listenSockets;
+	void setPoolLimit(uint32_t _size)
+	{
+		setPoolLimit(s_defaultCtx, _size);
+	}
 
-		MessageQueue m_incoming;
+	void send(OutgoingMessage* _msg)
+	{
+		getContext(_msg)->send(_msg);
+	}
 
-#if BNET_CONFIG_OPENSSL
-		static void* sslMalloc(size_t _size)
-		{
-			return BX_ALLOC(g_allocator, _size);
-		}
+	void send(OutgoingMessage* _msg, Channel::Enum _channel)
+	{
+		getContext(_msg)->send(_msg, _channel);
+	}
 
-		static void* sslRealloc(void* _ptr, size_t _size)
-		{
-			return BX_REALLOC(g_allocator, _ptr, _size);
-		}
+	void allocBatch(OutgoingMessage** _msgs, const Handle* _handles, uint32_t _num, uint16_t _size, Priority::Enum _priority)
+	{
+		allocBatch(s_defaultCtx, _msgs, _handles, _num, _size, _priority);
+	}
 
-		static void sslFree(void* _ptr)
+	void sendBatch(OutgoingMessage** _msgs, uint32_t _num)
+	{
+		for (uint32_t ii = 0; ii < _num; ++ii)
 		{
-			return BX_FREE(g_allocator, _ptr);
+			getContext(_msgs[ii])->queue(_msgs[ii]);
 		}
+	}
 
-		typedef void* (*MallocFn)(size_t _size);
-		MallocFn m_sslMalloc;
+	void flush()
+	{
+		flush(s_defaultCtx);
+	}
 
-		typedef void* (*ReallocFn)(void* _ptr, size_t _size);
-		ReallocFn m_sslRealloc;
+	void broadcast(OutgoingMessage* _msg, const Handle* _handles, uint32_t _num)
+	{
+		getContext(_msg)->broadcast(_msg, _handles, _num);
+	}
 
-		typedef void (*FreeFn)(void* _ptr);
-		FreeFn m_sslFree;
-#endif // BNET_CONFIG_OPENSSL
+	void broadcast(OutgoingMessage* _msg, GroupHandle _group)
+	{
+		getContext(_msg)->broadcast(_msg, _group);
+	}
 
-		SSL_CTX* m_sslCtx;
-		SSL_CTX* m_sslCtxServer;
-	};
+	GroupHandle createGroup()
+	{
+		return createGroup(s_defaultCtx);
+	}
 
-	static Context s_ctx;
+	void destroyGroup(GroupHandle _group)
+	{
+		destroyGroup(s_defaultCtx, _group);
+	}
 
-	Handle ctxAccept(Handle _listenHandle, SOCKET _socket, uint32_t _ip, uint16_t _port, bool _raw, X509* _cert, EVP_PKEY* _key)
+	void addToGroup(GroupHandle _group, Handle _handle)
 	{
-		return s_ctx.accept(_listenHandle, _socket, _ip, _port, _raw, _cert, _key);
+		addToGroup(s_defaultCtx, _group, _handle);
 	}
 
-	void ctxPush(Handle _handle, MessageId::Enum _id)
+	void removeFromGroup(GroupHandle _group, Handle _handle)
 	{
-		Message* msg = msgAlloc(_handle, 1, true);
-		msg->data[0] = _id;
-		s_ctx.push(msg);
+		removeFromGroup(s_defaultCtx, _group, _handle);
 	}
 
-	void ctxPush(Message* _msg)
+	void sendLarge(Handle _handle, const void* _data, uint32_t _size)
 	{
-		s_ctx.push(_msg);
+		sendLarge(s_defaultCtx, _handle, _data, _size);
 	}
 
-	Message* msgAlloc(Handle _handle, uint16_t _size, bool _incoming, Internal::Enum _type)
+	void setReassembly(Handle _handle, uint32_t _maxSize)
 	{
-		uint16_t offset = _incoming ? 0 : 2;
-		Message* msg = (Message*)BX_ALLOC(g_allocator, sizeof(Message) + offset + _size);
-		msg->size = _size;
-		msg->handle = _handle;
-		uint8_t* data = (uint8_t*)msg + sizeof(Message);
-		data[0] = _type;
-		msg->data = data + offset;
-		return msg;
+		setReassembly(s_defaultCtx, _handle, _maxSize);
 	}
 
-	void msgRelease(Message* _msg)
+	void setIdleTimeout(Handle _handle, uint32_t _ms)
 	{
-		BX_FREE(g_allocator, _msg);
+		setIdleTimeout(s_defaultCtx, _handle, _ms);
 	}
 
-	void init(uint16_t _maxConnections, uint16_t _maxListenSockets, const char* _certs[], bx::AllocatorI* _allocator)
+	void setSendWatermarks(Handle _handle, uint32_t _low, uint32_t _high)
 	{
-		if (NULL != _allocator)
-		{
-			g_allocator = _allocator;
-		}
+		setSendWatermarks(s_defaultCtx, _handle, _low, _high);
+	}
 
-#if BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
-		WSADATA wsaData;
-		WSAStartup(MAKEWORD(2, 2), &wsaData);
-#endif // BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
+	void setSendLimit(Handle _handle, uint32_t _size, SendLimit::Enum _policy)
+	{
+		setSendLimit(s_defaultCtx, _handle, _size, _policy);
+	}
 
-		s_ctx.init(_maxConnections, _maxListenSockets, _certs);
+	uint32_t getSendQueueSize(Handle _handle)
+	{
+		return getSendQueueSize(s_defaultCtx, _handle);
 	}
 
-	void shutdown()
+	const TrafficStats* getStats(Handle _handle)
 	{
-		s_ctx.shutdown();
+		return getStats(s_defaultCtx, _handle);
+	}
 
-#if BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
-		WSACleanup();
-#endif // BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
+	const TrafficStats* getGlobalStats()
+	{
+		return getGlobalStats(s_defaultCtx);
 	}
 
-	Handle listen(uint32_t _ip, uint16_t _port, bool _raw, const char* _cert, const char* _key)
+	const LatencyStats* getLatency(Handle _handle, Latency::Enum _latency, bool _reset)
 	{
-		return s_ctx.listen(_ip, _port, _raw, _cert, _key);
+		return getLatency(s_defaultCtx, _handle, _latency, _reset);
 	}
 
-	void stop(Handle _handle)
+	const LatencyStats* getGlobalLatency(Latency::Enum _latency, bool _reset)
 	{
-		return s_ctx.stop(_handle);
+		return getGlobalLatency(s_defaultCtx, _latency, _reset);
 	}
 
-	Handle connect(uint32_t _ip, uint16_t _port, bool _raw, bool _secure)
+	TimerHandle createTimer(uint64_t _userData)
 	{
-		return s_ctx.connect(_ip, _port, _raw, _secure);
+		return createTimer(s_defaultCtx, _userData);
 	}
 
-	void disconnect(Handle _handle, bool _finish)
+	void destroyTimer(TimerHandle _timer)
 	{
-		s_ctx.disconnect(_handle, _finish);
+		destroyTimer(s_defaultCtx, _timer);
 	}
 
-	void notify(Handle _handle, uint64_t _userData)
+	void startTimer(TimerHandle _timer, uint32_t _ms, uint32_t _periodMs)
 	{
-		s_ctx.notify(_handle, _userData);
+		startTimer(s_defaultCtx, _timer, _ms, _periodMs);
 	}
 
-	OutgoingMessage* alloc(Handle _handle, uint16_t _size)
+	void stopTimer(TimerHandle _timer)
 	{
-		return msgAlloc(_handle, _size);
+		stopTimer(s_defaultCtx, _timer);
 	}
 
-	void release(IncomingMessage* _msg)
+	IncomingMessage* recv()
 	{
-		msgRelease(_msg);
+		return recv(s_defaultCtx);
 	}
 
-	void send(OutgoingMessage* _msg)
+	uint32_t recv(IncomingMessage** _msgs, uint32_t _max)
 	{
-		s_ctx.send(_msg);
+		return recv(s_defaultCtx, _msgs, _max);
 	}
 
-	IncomingMessage* recv()
+	Address toAddress(uint32_t _ip)
 	{
-		return s_ctx.recv();
+		Address addr;
+		memset(&addr, 0, sizeof(addr) );
+		addr.family = AddressFamily::Ipv4;
+		_ip = htonl(_ip);
+		memcpy(addr.data, &_ip, sizeof(_ip) );
+		return addr;
 	}
 
-	uint32_t toIpv4(const char* _addr)
+	bool toAddress(const char* _str, Address& _addr)
 	{
-		uint32_t a0, a1, a2, a3;
-		char dummy;
-		if (4 == sscanf(_addr, "%d.%d.%d.%d%c", &a0, &a1, &a2, &a3, &dummy)
-		&&  a0 <= 0xff
-		&&  a1 <= 0xff
-		&&  a2 <= 0xff
-		&&  a3 <= 0xff)
+		uint32_t ip;
+		if (parseIpv4(_str, ip) )
 		{
-			return (a0<<24) | (a1<<16) | (a2<<8) | a3;
+			_addr = toAddress(ip);
+			return true;
 		}
 
 #if BX_PLATFORM_XBOX360 || BX_PLATFORM_NACL
-		// No DNS resolution on these platforms
-		return 0;
+		return false;
 #else
-		uint32_t ip = 0;
 		struct addrinfo* result = NULL;
 		struct addrinfo hints;
 		memset(&hints, 0, sizeof(hints) );
-		hints.ai_family = AF_UNSPEC;
+		hints.ai_family = AF_INET6;
+		hints.ai_flags = AI_NUMERICHOST;
+
+		bool parsed = false;
+		if (0 == getaddrinfo(_str, NULL, &hints, &result) )
+		{
+			parsed = fromSockaddr(result->ai_addr, _addr);
+			freeaddrinfo(result);
+		}
 
-		int res = getaddrinfo(_addr, NULL, &hints, &result);
+		return parsed;
+#endif // BX_PLATFORM_
+	}
 
-		if (0 == res)
+	uint32_t toAddresses(const char* _name, Address* _addrs, uint32_t _max)
+	{
+		if (0 == _max)
 		{
-			while (result)
-			{
-				sockaddr_in* addr = (sockaddr_in*)result->ai_addr;
-				if (AF_INET == result->ai_family
-				&&  INADDR_LOOPBACK != addr->sin_addr.s_addr)
-				{
-					ip = ntohl(addr->sin_addr.s_addr);
-					break;
-				}
+			return 0;
+		}
 
-				result = result->ai_next;
-			}
+		if (toAddress(_name, _addrs[0]) )
+		{
+			return 1;
 		}
 
-		if (NULL != result)
+		uint32_t num = _max;
+		uint32_t ttl;
+		return resolveAddrInfo(_name, _addrs, &num, &ttl, NULL) ? num : 0;
+	}
+
+	uint32_t toIpv4(const char* _addr)
+	{
+		uint32_t ip = 0;
+		if (!parseIpv4(_addr, ip) )
 		{
-			freeaddrinfo(result);
+			Address addrs[BNET_CONFIG_MAX_ADDRESSES];
+			uint32_t num = BNET_CONFIG_MAX_ADDRESSES;
+			uint32_t ttl;
+			resolveAddrInfo(_addr, addrs, &num, &ttl, NULL);
+			ip = getIpv4(addrs, num);
 		}
 
 		return ip;
-#endif // BX_PLATFORM_
 	}
 
 } // namespace bnet
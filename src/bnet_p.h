@@ -45,10 +45,198 @@ extern void dbgPrintfData(const void* _data, uint32_t _size, const char* _format
 #	define BNET_CONFIG_CONNECT_TIMEOUT_SECONDS 5
 #endif // BNET_CONFIG_CONNECT_TIMEOUT_SECONDS
 
+#ifndef BNET_CONFIG_CONNECT_STAGGER_MS
+#	define BNET_CONFIG_CONNECT_STAGGER_MS 250 // delay before connect to next address is started
+#endif // BNET_CONFIG_CONNECT_STAGGER_MS
+
+#ifndef BNET_CONFIG_IDLE_TIMEOUT_MS
+#	define BNET_CONFIG_IDLE_TIMEOUT_MS 0 // connection idle timeout, 0 disables it
+#endif // BNET_CONFIG_IDLE_TIMEOUT_MS
+
+#ifndef BNET_CONFIG_SEND_LOW_WATERMARK
+#	define BNET_CONFIG_SEND_LOW_WATERMARK 0 // queued bytes when SendQueueDrained is received
+#endif // BNET_CONFIG_SEND_LOW_WATERMARK
+
+#ifndef BNET_CONFIG_SEND_HIGH_WATERMARK
+#	define BNET_CONFIG_SEND_HIGH_WATERMARK 0 // queued bytes when SendQueueFull is received, 0 disables it
+#endif // BNET_CONFIG_SEND_HIGH_WATERMARK
+
+#ifndef BNET_CONFIG_SEND_LIMIT
+#	define BNET_CONFIG_SEND_LIMIT 0 // most queued bytes per connection, 0 is unlimited
+#endif // BNET_CONFIG_SEND_LIMIT
+
+#ifndef BNET_CONFIG_TIMER_TICK_MS
+#	define BNET_CONFIG_TIMER_TICK_MS 10 // timer wheel resolution
+#endif // BNET_CONFIG_TIMER_TICK_MS
+
+#ifndef BNET_CONFIG_MAX_TIMERS
+#	define BNET_CONFIG_MAX_TIMERS 256 // application timers per context
+#endif // BNET_CONFIG_MAX_TIMERS
+
+#ifndef BNET_CONFIG_MAX_ADDRESSES
+#	define BNET_CONFIG_MAX_ADDRESSES 8 // addresses per host name, and per connect
+#endif // BNET_CONFIG_MAX_ADDRESSES
+
 #ifndef BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE
 #	define BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE (64<<10)
 #endif // BNET_CONFIG_MAX_INCOMING_BUFFER_SIZE
 
+#ifndef BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE
+#	define BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE (4<<10) // receive buffer size before it grows
+#endif // BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE
+
+#ifndef BNET_CONFIG_RECV_BUFFER_POOL_SIZE
+#	define BNET_CONFIG_RECV_BUFFER_POOL_SIZE (4<<20) // memory kept in receive buffer free lists
+#endif // BNET_CONFIG_RECV_BUFFER_POOL_SIZE
+
+#ifndef BNET_CONFIG_FRAGMENT_SIZE
+#	define BNET_CONFIG_FRAGMENT_SIZE (16<<10) // large message payload per fragment
+#endif // BNET_CONFIG_FRAGMENT_SIZE
+
+#ifndef BNET_CONFIG_PRIORITY_QUANTUM
+#	define BNET_CONFIG_PRIORITY_QUANTUM (64<<10) // bytes of priority class moved to send queue at once
+#endif // BNET_CONFIG_PRIORITY_QUANTUM
+
+#ifndef BNET_CONFIG_PRIORITY_SHARE
+#	define BNET_CONFIG_PRIORITY_SHARE 4 // lower priority class is served at least once per this many quantums
+#endif // BNET_CONFIG_PRIORITY_SHARE
+
+#ifndef BNET_CONFIG_LATENCY_HISTOGRAM
+#	define BNET_CONFIG_LATENCY_HISTOGRAM 0 // send and receive latency histograms, messages are timestamped
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+
+#ifndef BNET_CONFIG_MAX_CONTEXTS
+#	define BNET_CONFIG_MAX_CONTEXTS 64
+#endif // BNET_CONFIG_MAX_CONTEXTS
+
+#ifndef BNET_CONFIG_MAX_GROUPS
+#	define BNET_CONFIG_MAX_GROUPS 64 // connection groups per context
+#endif // BNET_CONFIG_MAX_GROUPS
+
+#ifndef BNET_CONFIG_MAX_DICTIONARIES
+#	define BNET_CONFIG_MAX_DICTIONARIES 16 // compression dictionaries per context, id 0 is no dictionary
+#endif // BNET_CONFIG_MAX_DICTIONARIES
+
+#ifndef BNET_CONFIG_MESSAGE_POOL_SIZE
+#	define BNET_CONFIG_MESSAGE_POOL_SIZE (4<<20) // memory kept in pool free lists
+#endif // BNET_CONFIG_MESSAGE_POOL_SIZE
+
+#ifndef BNET_CONFIG_EPOLL
+#	define BNET_CONFIG_EPOLL (BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID)
+#endif // BNET_CONFIG_EPOLL
+
+#ifndef BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+#	define BNET_CONFIG_EPOLL_EDGE_TRIGGERED 0
+#endif // BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+
+#ifndef BNET_CONFIG_MAX_POLL_EVENTS
+#	define BNET_CONFIG_MAX_POLL_EVENTS 256
+#endif // BNET_CONFIG_MAX_POLL_EVENTS
+
+#ifndef BNET_CONFIG_GATHER_WRITE
+#	define BNET_CONFIG_GATHER_WRITE (BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID || BX_PLATFORM_OSX || BX_PLATFORM_IOS)
+#endif // BNET_CONFIG_GATHER_WRITE
+
+#ifndef BNET_CONFIG_MAX_GATHER_FRAMES
+#	define BNET_CONFIG_MAX_GATHER_FRAMES 64 // must not exceed IOV_MAX
+#endif // BNET_CONFIG_MAX_GATHER_FRAMES
+
+#ifndef BNET_CONFIG_MAX_GATHER_SIZE
+#	define BNET_CONFIG_MAX_GATHER_SIZE (256<<10)
+#endif // BNET_CONFIG_MAX_GATHER_SIZE
+
+#ifndef BNET_CONFIG_IO_THREAD
+#	define BNET_CONFIG_IO_THREAD BNET_CONFIG_EPOLL
+#endif // BNET_CONFIG_IO_THREAD
+
+#if BNET_CONFIG_IO_THREAD && !BNET_CONFIG_EPOLL
+#	error "BNET_CONFIG_IO_THREAD requires BNET_CONFIG_EPOLL."
+#endif // BNET_CONFIG_IO_THREAD && !BNET_CONFIG_EPOLL
+
+#ifndef BNET_CONFIG_IO_THREAD_WAIT_MS
+#	define BNET_CONFIG_IO_THREAD_WAIT_MS 100 // I/O thread wait when no socket needs ticking
+#endif // BNET_CONFIG_IO_THREAD_WAIT_MS
+
+#ifndef BNET_CONFIG_REUSEPORT
+#	define BNET_CONFIG_REUSEPORT (BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID)
+#endif // BNET_CONFIG_REUSEPORT
+
+#ifndef BNET_CONFIG_IO_URING
+#	define BNET_CONFIG_IO_URING 0
+#endif // BNET_CONFIG_IO_URING
+
+#if BNET_CONFIG_IO_URING && !BNET_CONFIG_EPOLL
+#	error "BNET_CONFIG_IO_URING requires BNET_CONFIG_EPOLL."
+#endif // BNET_CONFIG_IO_URING && !BNET_CONFIG_EPOLL
+
+#ifndef BNET_CONFIG_IO_URING_ENTRIES
+#	define BNET_CONFIG_IO_URING_ENTRIES 1024
+#endif // BNET_CONFIG_IO_URING_ENTRIES
+
+#ifndef BNET_CONFIG_IO_URING_NUM_BUFFERS
+#	define BNET_CONFIG_IO_URING_NUM_BUFFERS 256 // must be power of 2
+#endif // BNET_CONFIG_IO_URING_NUM_BUFFERS
+
+#ifndef BNET_CONFIG_IO_URING_BUFFER_SIZE
+#	define BNET_CONFIG_IO_URING_BUFFER_SIZE (16<<10)
+#endif // BNET_CONFIG_IO_URING_BUFFER_SIZE
+
+#ifndef BNET_CONFIG_IO_URING_MAX_LINKED_SENDS
+#	define BNET_CONFIG_IO_URING_MAX_LINKED_SENDS 16
+#endif // BNET_CONFIG_IO_URING_MAX_LINKED_SENDS
+
+#ifndef BNET_CONFIG_UDP
+#	define BNET_CONFIG_UDP BNET_CONFIG_REUSEPORT
+#endif // BNET_CONFIG_UDP
+
+#if BNET_CONFIG_UDP && !BNET_CONFIG_REUSEPORT
+#	error "BNET_CONFIG_UDP requires BNET_CONFIG_REUSEPORT."
+#endif // BNET_CONFIG_UDP && !BNET_CONFIG_REUSEPORT
+
+#ifndef BNET_CONFIG_UDP_MTU
+#	define BNET_CONFIG_UDP_MTU 1200 // largest datagram, fits IPv6 minimum MTU
+#endif // BNET_CONFIG_UDP_MTU
+
+#ifndef BNET_CONFIG_UDP_BATCH
+#	define BNET_CONFIG_UDP_BATCH 32 // datagrams per sendmmsg/recvmmsg
+#endif // BNET_CONFIG_UDP_BATCH
+
+#ifndef BNET_CONFIG_UDP_WINDOW
+#	define BNET_CONFIG_UDP_WINDOW 256 // reliable messages in flight, power of 2 and at least 32
+#endif // BNET_CONFIG_UDP_WINDOW
+
+#ifndef BNET_CONFIG_UDP_RESEND_MS
+#	define BNET_CONFIG_UDP_RESEND_MS 100
+#endif // BNET_CONFIG_UDP_RESEND_MS
+
+#ifndef BNET_CONFIG_UDP_KEEPALIVE_MS
+#	define BNET_CONFIG_UDP_KEEPALIVE_MS 1000
+#endif // BNET_CONFIG_UDP_KEEPALIVE_MS
+
+#ifndef BNET_CONFIG_UDP_TIMEOUT_SECONDS
+#	define BNET_CONFIG_UDP_TIMEOUT_SECONDS 10
+#endif // BNET_CONFIG_UDP_TIMEOUT_SECONDS
+
+#ifndef BNET_CONFIG_RESOLVER_THREADS
+#	define BNET_CONFIG_RESOLVER_THREADS 2 // 0 resolves host names on thread calling bnet::resolve
+#endif // BNET_CONFIG_RESOLVER_THREADS
+
+#ifndef BNET_CONFIG_RESOLVER_CACHE_SIZE
+#	define BNET_CONFIG_RESOLVER_CACHE_SIZE 64 // cached host names per context
+#endif // BNET_CONFIG_RESOLVER_CACHE_SIZE
+
+#ifndef BNET_CONFIG_RESOLVER_MAX_NAME
+#	define BNET_CONFIG_RESOLVER_MAX_NAME 256
+#endif // BNET_CONFIG_RESOLVER_MAX_NAME
+
+#ifndef BNET_CONFIG_RESOLVER_TTL_SECONDS
+#	define BNET_CONFIG_RESOLVER_TTL_SECONDS 60 // getaddrinfo doesn't report record TTL
+#endif // BNET_CONFIG_RESOLVER_TTL_SECONDS
+
+#ifndef BNET_CONFIG_RESOLVER_NEGATIVE_TTL_SECONDS
+#	define BNET_CONFIG_RESOLVER_NEGATIVE_TTL_SECONDS 5 // failed lookups are cached too
+#endif // BNET_CONFIG_RESOLVER_NEGATIVE_TTL_SECONDS
+
 #if BX_PLATFORM_WINDOWS || BX_PLATFORM_XBOX360
 #	if BX_PLATFORM_WINDOWS
 #		if !defined(_WIN32_WINNT)
@@ -92,11 +280,45 @@ extern void dbgPrintfData(const void* _data, uint32_t _size, const char* _format
 #	include "nacl_socket.h"
 #endif // BX_PLATFORM_
 
+#if BNET_CONFIG_EPOLL
+#	include <sys/epoll.h>
+#endif // BNET_CONFIG_EPOLL
+
+#if BNET_CONFIG_GATHER_WRITE
+#	include <sys/uio.h> // iovec
+#endif // BNET_CONFIG_GATHER_WRITE
+
+#if BNET_CONFIG_IO_THREAD
+#	include <sched.h> // sched_yield
+#	include <sys/eventfd.h>
+#	include <bx/mutex.h>
+#	include <bx/thread.h>
+#endif // BNET_CONFIG_IO_THREAD
+
+#if BNET_CONFIG_REUSEPORT
+#	include <linux/filter.h> // sock_filter
+#endif // BNET_CONFIG_REUSEPORT
+
+#if BNET_CONFIG_IO_URING
+#	include "uring.h"
+#endif // BNET_CONFIG_IO_URING
+
+#if BNET_CONFIG_UDP
+#	include "udp.h"
+#endif // BNET_CONFIG_UDP
+
+#include "lz4.h"
+
 #include <bx/debug.h>
 #include <bx/handlealloc.h>
 #include <bx/ringbuffer.h>
 #include <bx/timer.h>
 #include <bx/allocator.h>
+#include <bx/cpu.h>
+
+#include "histogram.h"
+#include "resolver.h"
+#include "timer.h"
 
 #include <new> // placement new
 #include <stdio.h> // sscanf
@@ -111,8 +333,6 @@ extern void dbgPrintfData(const void* _data, uint32_t _size, const char* _format
 #	define EVP_PKEY void
 #endif // BNET_CONFIG_OPENSSL
 
-#include <list>
-
 namespace bnet
 {
 	struct Internal
@@ -125,68 +345,146 @@ namespace bnet
 		};
 	};
 
+	/// Frames with message id 0 are internal to bnet, second byte is
+	/// control frame type.
+	struct ControlFrame
+	{
+		enum Enum
+		{
+			Offer,      // Codec, dictionary id, u32 dictionary hash.
+			Answer,     // Codec and dictionary id peer can decompress.
+			Compressed, // Dictionary id, u16 size, compressed message.
+		};
+	};
+
+	/// Owner of timer, stored in upper bits of timer key, lower bits
+	/// are connection or timer handle.
+	struct TimerKind
+	{
+		enum Enum
+		{
+			Connect,
+			Idle,
+			Udp,
+			User,
+		};
+	};
+
+	class Context;
+
+	/// Allocator used for process wide state (OpenSSL).
 	extern bx::AllocatorI* g_allocator;
 
-	Handle ctxAccept(Handle _listenHandle, SOCKET _socket, uint32_t _ip, uint16_t _port, bool _raw, X509* _cert, EVP_PKEY* _key);
-	void ctxPush(Handle _handle, MessageId::Enum _id);
-	void ctxPush(Message* _msg);
-	Message* msgAlloc(Handle _handle, uint16_t _size, bool _incoming = false, Internal::Enum _type = Internal::None);
+	Handle ctxAccept(Context* _ctx, Handle _listenHandle, SOCKET _socket, uint32_t _ip, uint16_t _port, bool _raw, X509* _cert, EVP_PKEY* _key);
+	void ctxPush(Context* _ctx, Handle _handle, MessageId::Enum _id);
+	void ctxPush(Context* _ctx, Message* _msg);
+	void ctxDestroy(Context* _ctx, Handle _handle);
+	void ctxWatch(Context* _ctx, Handle _handle);
+	TimerWheel& ctxTimers(Context* _ctx);
+	bx::AllocatorI* ctxAllocator(Context* _ctx);
+	void ctxQueue(Context* _ctx, Message* _msg);
+	Lz4Table* ctxLz4Table(Context* _ctx);
+	const Lz4Dictionary* ctxDictionary(Context* _ctx, uint8_t _id);
+	void* ctxAllocRecvBuffer(Context* _ctx, uint32_t _size);
+	void ctxFreeRecvBuffer(Context* _ctx, void* _ptr, uint32_t _size);
+#if BNET_CONFIG_UDP
+	UdpBatch& ctxUdpBatch(Context* _ctx);
+	void ctxAcceptUdp(Context* _ctx, Handle _listenHandle, SOCKET _listenSocket, const sockaddr_in& _local, const sockaddr_in& _remote, uint64_t _cookie);
+#endif // BNET_CONFIG_UDP
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+	Histogram& ctxLatency(Context* _ctx, Latency::Enum _latency);
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+	Message* msgAlloc(Context* _ctx, Handle _handle, uint32_t _size, bool _incoming = false, Internal::Enum _type = Internal::None);
 	void msgRelease(Message* _msg);
 
 	template<typename Ty>
 	class FreeList
 	{
 	public:
-		FreeList(uint16_t _max)
+		FreeList(bx::AllocatorI* _allocator, uint16_t _max)
+			: m_allocator(_allocator)
 		{
-			m_memBlock = BX_ALLOC(g_allocator, _max*sizeof(Ty) );
-			m_handleAlloc = bx::createHandleAlloc(g_allocator, _max);
+			m_memBlock = BX_ALLOC(m_allocator, _max*sizeof(Ty) );
+			m_handleAlloc = bx::createHandleAlloc(m_allocator, _max);
+			m_generation = (uint16_t*)BX_ALLOC(m_allocator, _max*sizeof(uint16_t) );
+			memset(m_generation, 0, _max*sizeof(uint16_t) );
 		}
 
 		~FreeList()
 		{
-			bx::destroyHandleAlloc(g_allocator, m_handleAlloc);
-			BX_FREE(g_allocator, m_memBlock);
+			BX_FREE(m_allocator, m_generation);
+			bx::destroyHandleAlloc(m_allocator, m_handleAlloc);
+			BX_FREE(m_allocator, m_memBlock);
 		}
 
 		Ty* create()
 		{
-			Ty* first = reinterpret_cast<Ty*>(m_memBlock);
-			Ty* obj = &first[m_handleAlloc->alloc()];
-			obj = ::new (obj) Ty;
+			Ty* obj = alloc();
+			if (NULL != obj)
+			{
+				obj = ::new (obj) Ty;
+			}
 			return obj;
 		}
 
 		template<typename Arg0> Ty* create(Arg0 _a0)
 		{
-			Ty* first = reinterpret_cast<Ty*>(m_memBlock);
-			Ty* obj = &first[m_handleAlloc->alloc()];
-			obj = ::new (obj) Ty(_a0);
+			Ty* obj = alloc();
+			if (NULL != obj)
+			{
+				obj = ::new (obj) Ty(_a0);
+			}
 			return obj;
 		}
 
 		template<typename Arg0, typename Arg1> Ty* create(Arg0 _a0, Arg1 _a1)
 		{
-			Ty* first = reinterpret_cast<Ty*>(m_memBlock);
-			Ty* obj = &first[m_handleAlloc->alloc()];
-			obj = ::new (obj) Ty(_a0, _a1);
+			Ty* obj = alloc();
+			if (NULL != obj)
+			{
+				obj = ::new (obj) Ty(_a0, _a1);
+			}
 			return obj;
 		}
 
 		template<typename Arg0, typename Arg1, typename Arg2> Ty* create(Arg0 _a0, Arg1 _a1, Arg2 _a2)
 		{
-			Ty* first = reinterpret_cast<Ty*>(m_memBlock);
-			Ty* obj = &first[m_handleAlloc->alloc()];
-			obj = ::new (obj) Ty(_a0, _a1, _a2);
+			Ty* obj = alloc();
+			if (NULL != obj)
+			{
+				obj = ::new (obj) Ty(_a0, _a1, _a2);
+			}
 			return obj;
 		}
 
 		void destroy(Ty* _obj)
 		{
 			_obj->~Ty();
+			invalidate(getHandle(_obj) );
 			m_handleAlloc->free(getHandle(_obj) );
 		}
 
+		/// Makes handles to slot stale, before object is destroyed.
+		void invalidate(uint16_t _index)
+		{
+			++m_generation[_index];
+		}
+
+		/// Returns handle to slot, with current generation.
+		Handle makeHandle(uint16_t _index) const
+		{
+			Handle handle = { _index, m_generation[_index] };
+			return handle;
+		}
+
+		bool isValid(Handle _handle) const
+		{
+			return _handle.idx < m_handleAlloc->getMaxHandles()
+				&& m_handleAlloc->isValid(_handle.idx)
+				&& m_generation[_handle.idx] == _handle.gen
+				;
+		}
+
 		uint16_t getHandle(Ty* _obj) const
 		{
 			Ty* first = reinterpret_cast<Ty*>(m_memBlock);
@@ -216,8 +514,22 @@ namespace bnet
 		}
 
 	private:
+		Ty* alloc()
+		{
+			uint16_t handle = m_handleAlloc->alloc();
+			if (bx::HandleAlloc::invalid == handle)
+			{
+				return NULL;
+			}
+
+			Ty* first = reinterpret_cast<Ty*>(m_memBlock);
+			return &first[handle];
+		}
+
+		bx::AllocatorI* m_allocator;
 		void* m_memBlock;
 		bx::HandleAlloc* m_handleAlloc;
+		uint16_t* m_generation;
 	};
 
 	class RecvRingBuffer
@@ -240,6 +552,20 @@ namespace bnet
 		{
 		}
 
+		/// Starts writing at control's current position, into new buffer.
+		void reset(char* _buffer)
+		{
+			m_write = m_control.m_current;
+			m_reserved = 0;
+			m_buffer = _buffer;
+		}
+
+		bool isFull()
+		{
+			m_reserved += m_control.reserve(UINT32_MAX);
+			return 0 == m_reserved;
+		}
+
 		int recv(SOCKET _socket)
 		{
 			m_reserved += m_control.reserve(UINT32_MAX);
@@ -264,6 +590,22 @@ namespace bnet
 			return bytes;
 		}
 
+		uint32_t write(const char* _data, uint32_t _len)
+		{
+			m_reserved += m_control.reserve(UINT32_MAX);
+			uint32_t size = bx::uint32_min(_len, m_reserved);
+			uint32_t wrap = bx::uint32_min(size, m_control.m_size - m_write);
+			memcpy(&m_buffer[m_write], _data, wrap);
+			memcpy(m_buffer, &_data[wrap], size - wrap);
+
+			m_write += size;
+			m_write %= m_control.m_size;
+			m_reserved -= size;
+			m_control.commit(size);
+
+			return size;
+		}
+
 #if BNET_CONFIG_OPENSSL
 		int recv(SSL* _ssl)
 		{
@@ -298,10 +640,317 @@ namespace bnet
 		char* m_buffer;
 	};
 
+	struct MessageFlags
+	{
+		enum Enum
+		{
+			View   = 0x01, // Data points into connection receive buffer.
+			Stream = 0x02, // Large message fragment.
+			Shared = 0x04, // Data points into broadcast message payload.
+			Control = 0x08, // Internal frame, see ControlFrame.
+			Channel = 0x30, // UDP channel, Channel::Enum << ChannelShift.
+			Priority = 0xc0, // Priority::Enum+1 << PriorityShift, 0 is Priority::Normal.
+
+			ChannelShift = 4,
+			PriorityShift = 6,
+		};
+	};
+
+	/// Hidden header in front of every message.
+	struct MessageHeader
+	{
+		MessageHeader* next; // Queue link, or free list link while pooled.
+		Context* ctx;        // Owner.
+		uint32_t size;
+		uint8_t sizeClass : 7;
+		uint8_t pool      : 1; // Pool that allocated block.
+		uint8_t flags;
+		uint16_t refs;       // Shared messages still referencing payload.
+#if BNET_CONFIG_LATENCY_HISTOGRAM
+		int64_t time;        // Send or receive time, 0 when it's not measured.
+#endif // BNET_CONFIG_LATENCY_HISTOGRAM
+	};
+
+	inline MessageHeader* getHeader(Message* _msg)
+	{
+		return (MessageHeader*)_msg - 1;
+	}
+
+	inline Message* getMessage(MessageHeader* _header)
+	{
+		return (Message*)(_header + 1);
+	}
+
+	/// Returns internal marker stored in front of outgoing message data.
+	/// Shared messages hold frame length there instead.
+	inline Internal::Enum getMarker(Message* _msg)
+	{
+		return 0 == (getHeader(_msg)->flags & MessageFlags::Shared)
+			? Internal::Enum(*(_msg->data - 2) )
+			: Internal::None
+			;
+	}
+
+	/// Message allocator with power-of-two size classes. Released blocks
+	/// are kept in per-class free lists, until pool limit is reached.
+	class MessagePool
+	{
+		BX_CLASS(MessagePool
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		MessagePool(bx::AllocatorI* _allocator, uint8_t _id = 0)
+			: m_allocator(_allocator)
+			, m_limit(BNET_CONFIG_MESSAGE_POOL_SIZE)
+			, m_id(_id)
+		{
+			memset(m_free, 0, sizeof(m_free) );
+			memset(&m_stats, 0, sizeof(m_stats) );
+		}
+
+		~MessagePool()
+		{
+		}
+
+		void* alloc(uint32_t _size)
+		{
+			const uint32_t size = _size + sizeof(MessageHeader);
+			const uint8_t sizeClass = getSizeClass(size);
+
+			MessageHeader* block;
+			uint32_t blockSize;
+			if (NumSizeClasses > sizeClass
+			&&  NULL != m_free[sizeClass])
+			{
+				block = m_free[sizeClass];
+				m_free[sizeClass] = block->next;
+				blockSize = block->size;
+				m_stats.cached -= blockSize;
+				++m_stats.hits;
+			}
+			else
+			{
+				blockSize = NumSizeClasses > sizeClass ? MinBlockSize<<sizeClass : size;
+				block = (MessageHeader*)BX_ALLOC(m_allocator, blockSize);
+				block->size = blockSize;
+				block->sizeClass = sizeClass;
+				block->pool = m_id;
+				++m_stats.misses;
+			}
+
+			block->next = NULL;
+			block->flags = 0;
+			m_stats.used += blockSize;
+			m_stats.usedMax = bx::uint32_max(m_stats.usedMax, m_stats.used);
+
+			return block + 1;
+		}
+
+		void free(void* _ptr)
+		{
+			MessageHeader* block = (MessageHeader*)_ptr - 1;
+			const uint32_t blockSize = block->size;
+			m_stats.used -= blockSize;
+
+			if (NumSizeClasses > block->sizeClass
+			&&  m_limit >= m_stats.cached + blockSize)
+			{
+				block->next = m_free[block->sizeClass];
+				m_free[block->sizeClass] = block;
+				m_stats.cached += blockSize;
+				m_stats.cachedMax = bx::uint32_max(m_stats.cachedMax, m_stats.cached);
+				return;
+			}
+
+			BX_FREE(m_allocator, block);
+		}
+
+		void setLimit(uint32_t _size)
+		{
+			m_limit = _size;
+
+			// Trim largest blocks first.
+			for (uint32_t ii = NumSizeClasses; 0 < ii && m_stats.cached > m_limit; --ii)
+			{
+				MessageHeader*& head = m_free[ii-1];
+				while (NULL != head
+				&&     m_stats.cached > m_limit)
+				{
+					MessageHeader* block = head;
+					head = block->next;
+					m_stats.cached -= block->size;
+					BX_FREE(m_allocator, block);
+				}
+			}
+		}
+
+		/// Returns all cached blocks to allocator.
+		void purge()
+		{
+			uint32_t limit = m_limit;
+			setLimit(0);
+			m_limit = limit;
+		}
+
+		const PoolStats& getStats() const
+		{
+			return m_stats;
+		}
+
+	private:
+		static const uint32_t MinBlockSize = 64;
+		static const uint32_t NumSizeClasses = 11; // 64 - 64K
+
+		static uint8_t getSizeClass(uint32_t _size)
+		{
+			uint8_t sizeClass = 0;
+			while (NumSizeClasses > sizeClass
+			&&     _size > (MinBlockSize<<sizeClass) )
+			{
+				++sizeClass;
+			}
+
+			return sizeClass;
+		}
+
+		bx::AllocatorI* m_allocator;
+		MessageHeader* m_free[NumSizeClasses];
+		uint32_t m_limit;
+		uint8_t m_id;
+		PoolStats m_stats;
+	};
+
+	/// Connection receive buffer allocator. Buffers are taken only while
+	/// connection has unconsumed data. Power-of-two sized buffers are kept
+	/// in per-size free lists once drained, until pool limit is reached.
+	class RecvBufferPool
+	{
+		BX_CLASS(RecvBufferPool
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		RecvBufferPool(bx::AllocatorI* _allocator)
+			: m_allocator(_allocator)
+			, m_limit(BNET_CONFIG_RECV_BUFFER_POOL_SIZE)
+		{
+			memset(m_free, 0, sizeof(m_free) );
+			memset(&m_stats, 0, sizeof(m_stats) );
+		}
+
+		~RecvBufferPool()
+		{
+		}
+
+		void* alloc(uint32_t _size)
+		{
+			const uint8_t sizeClass = getSizeClass(_size);
+
+			void* ptr;
+			if (NumSizeClasses > sizeClass
+			&&  NULL != m_free[sizeClass])
+			{
+				FreeBuffer* buffer = m_free[sizeClass];
+				m_free[sizeClass] = buffer->next;
+				m_stats.cached -= _size;
+				ptr = buffer;
+			}
+			else
+			{
+				ptr = BX_ALLOC(m_allocator, _size);
+			}
+
+			++m_stats.buffers;
+			m_stats.used += _size;
+			m_stats.usedMax = bx::uint32_max(m_stats.usedMax, m_stats.used);
+
+			return ptr;
+		}
+
+		void free(void* _ptr, uint32_t _size)
+		{
+			const uint8_t sizeClass = getSizeClass(_size);
+
+			--m_stats.buffers;
+			m_stats.used -= _size;
+
+			if (NumSizeClasses > sizeClass
+			&&  m_limit >= m_stats.cached + _size)
+			{
+				FreeBuffer* buffer = (FreeBuffer*)_ptr;
+				buffer->next = m_free[sizeClass];
+				m_free[sizeClass] = buffer;
+				m_stats.cached += _size;
+				return;
+			}
+
+			BX_FREE(m_allocator, _ptr);
+		}
+
+		/// Returns all cached buffers to allocator.
+		void purge()
+		{
+			for (uint32_t ii = 0; ii < NumSizeClasses; ++ii)
+			{
+				while (NULL != m_free[ii])
+				{
+					FreeBuffer* buffer = m_free[ii];
+					m_free[ii] = buffer->next;
+					BX_FREE(m_allocator, buffer);
+				}
+			}
+
+			m_stats.cached = 0;
+		}
+
+		const RecvBufferStats& getStats() const
+		{
+			return m_stats;
+		}
+
+	private:
+		struct FreeBuffer
+		{
+			FreeBuffer* next;
+		};
+
+		static const uint32_t NumSizeClasses = 16;
+
+		/// Zero-copy buffers, which have slack after ring, are not pooled.
+		static uint8_t getSizeClass(uint32_t _size)
+		{
+			for (uint8_t sizeClass = 0; sizeClass < NumSizeClasses; ++sizeClass)
+			{
+				if (_size == uint32_t(BNET_CONFIG_MIN_INCOMING_BUFFER_SIZE)<<sizeClass)
+				{
+					return sizeClass;
+				}
+			}
+
+			return NumSizeClasses;
+		}
+
+		bx::AllocatorI* m_allocator;
+		FreeBuffer* m_free[NumSizeClasses];
+		uint32_t m_limit;
+		RecvBufferStats m_stats;
+	};
+
+	/// Intrusive FIFO of messages, linked through message header.
 	class MessageQueue
 	{
+		BX_CLASS(MessageQueue
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
 	public:
 		MessageQueue()
+			: m_head(NULL)
+			, m_tail(NULL)
 		{
 		}
 
@@ -311,34 +960,333 @@ namespace bnet
 
 		void push(Message* _msg)
 		{
-			m_queue.push_back(_msg);
+			MessageHeader* header = getHeader(_msg);
+			header->next = NULL;
+
+			if (NULL == m_tail)
+			{
+				m_head = header;
+			}
+			else
+			{
+				m_tail->next = header;
+			}
+
+			m_tail = header;
 		}
 
 		Message* peek()
 		{
-			if (!m_queue.empty() )
+			return NULL != m_head ? getMessage(m_head) : NULL;
+		}
+
+		Message* pop()
+		{
+			MessageHeader* header = m_head;
+			if (NULL == header)
 			{
-				return m_queue.front();
+				return NULL;
 			}
 
-			return NULL;
+			m_head = header->next;
+			if (NULL == m_head)
+			{
+				m_tail = NULL;
+			}
+
+			header->next = NULL;
+			return getMessage(header);
+		}
+
+		/// Fills up to _max messages from front of the queue without
+		/// removing them.
+		uint32_t peek(Message** _msgs, uint32_t _max)
+		{
+			uint32_t num = 0;
+			for (MessageHeader* header = m_head; NULL != header && num < _max; header = header->next)
+			{
+				_msgs[num++] = getMessage(header);
+			}
+
+			return num;
+		}
+
+	private:
+		MessageHeader* m_head;
+		MessageHeader* m_tail;
+	};
+
+	/// Lock-free intrusive multi-producer single-consumer message queue.
+	/// Any thread can push, only one thread can pop. Also usable as SPSC
+	/// queue between network and application thread.
+	class MpscMessageQueue
+	{
+		BX_CLASS(MpscMessageQueue
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		MpscMessageQueue()
+			: m_head(&m_stub)
+			, m_tail(&m_stub)
+		{
+			m_stub.next = NULL;
+		}
+
+		~MpscMessageQueue()
+		{
+		}
+
+		void push(Message* _msg)
+		{
+			push(getHeader(_msg) );
 		}
 
 		Message* pop()
 		{
-			if (!m_queue.empty() )
+			MessageHeader* tail = m_tail;
+			MessageHeader* next = load(&tail->next);
+
+			if (&m_stub == tail)
+			{
+				if (NULL == next)
+				{
+					return NULL;
+				}
+
+				m_tail = next;
+				tail   = next;
+				next   = load(&next->next);
+			}
+
+			if (NULL != next)
 			{
-				Message* msg = m_queue.front();
-				m_queue.pop_front();
-				return msg;
+				m_tail = next;
+				return getMessage(tail);
+			}
+
+			if (tail != load(&m_head) )
+			{
+				// Producer is in the middle of push.
+				return NULL;
+			}
+
+			push(&m_stub);
+
+			next = load(&tail->next);
+			if (NULL != next)
+			{
+				m_tail = next;
+				return getMessage(tail);
 			}
 
 			return NULL;
 		}
 
 	private:
-		std::list<Message*> m_queue;
+		void push(MessageHeader* _header)
+		{
+			_header->next = NULL;
+			bx::memoryBarrier(); // Exchange is acquire only.
+			MessageHeader* prev = (MessageHeader*)bx::atomicExchangePtr( (void**)&m_head, _header);
+			bx::memoryBarrier();
+			prev->next = _header;
+		}
+
+		static MessageHeader* load(MessageHeader* volatile* _ptr)
+		{
+			MessageHeader* ptr = *_ptr;
+			bx::memoryBarrier();
+			return ptr;
+		}
+
+		MessageHeader* volatile m_head; // Producers.
+		MessageHeader* m_tail;          // Consumer.
+		MessageHeader m_stub;
+	};
+
+	/// Unordered set of handles with O(1) add, remove and membership test.
+	class HandleList
+	{
+		BX_CLASS(HandleList
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		HandleList()
+			: m_allocator(NULL)
+			, m_dense(NULL)
+			, m_sparse(NULL)
+			, m_num(0)
+		{
+		}
+
+		~HandleList()
+		{
+			shutdown();
+		}
+
+		void init(bx::AllocatorI* _allocator, uint16_t _max)
+		{
+			m_allocator = _allocator;
+			m_dense  = (uint16_t*)BX_ALLOC(m_allocator, _max*sizeof(uint16_t) );
+			m_sparse = (uint16_t*)BX_ALLOC(m_allocator, _max*sizeof(uint16_t) );
+			memset(m_sparse, 0xff, _max*sizeof(uint16_t) );
+			m_num = 0;
+		}
+
+		void shutdown()
+		{
+			if (NULL != m_dense)
+			{
+				BX_FREE(m_allocator, m_dense);
+				BX_FREE(m_allocator, m_sparse);
+				m_dense  = NULL;
+				m_sparse = NULL;
+				m_num    = 0;
+			}
+		}
+
+		bool isValid() const
+		{
+			return NULL != m_dense;
+		}
+
+		void add(uint16_t _idx)
+		{
+			if (UINT16_MAX == m_sparse[_idx])
+			{
+				m_sparse[_idx] = m_num;
+				m_dense[m_num] = _idx;
+				++m_num;
+			}
+		}
+
+		void remove(uint16_t _idx)
+		{
+			if (UINT16_MAX != m_sparse[_idx])
+			{
+				uint16_t at = m_sparse[_idx];
+				--m_num;
+				uint16_t last = m_dense[m_num];
+				m_dense[at] = last;
+				m_sparse[last] = at;
+				m_sparse[_idx] = UINT16_MAX;
+			}
+		}
+
+		bool has(uint16_t _idx) const
+		{
+			return UINT16_MAX != m_sparse[_idx];
+		}
+
+		uint16_t getNum() const
+		{
+			return m_num;
+		}
+
+		uint16_t get(uint16_t _at) const
+		{
+			return m_dense[_at];
+		}
+
+	private:
+		bx::AllocatorI* m_allocator;
+		uint16_t* m_dense;
+		uint16_t* m_sparse;
+		uint16_t m_num;
+	};
+
+#if BNET_CONFIG_EPOLL
+	class Poller
+	{
+		BX_CLASS(Poller
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		Poller()
+			: m_fd(-1)
+			, m_num(0)
+		{
+		}
+
+		~Poller()
+		{
+			shutdown();
+		}
+
+		bool init()
+		{
+			m_fd = ::epoll_create1(EPOLL_CLOEXEC);
+			m_num = 0;
+			return isValid();
+		}
+
+		void shutdown()
+		{
+			if (isValid() )
+			{
+				::close(m_fd);
+				m_fd = -1;
+			}
+		}
+
+		bool isValid() const
+		{
+			return -1 != m_fd;
+		}
+
+		bool add(SOCKET _socket, uint32_t _key)
+		{
+			epoll_event ev;
+			ev.events = EPOLLIN
+#	if BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+				| EPOLLET
+#	endif // BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+				;
+			ev.data.u64 = _key;
+			return 0 == ::epoll_ctl(m_fd, EPOLL_CTL_ADD, _socket, &ev);
+		}
+
+		/// Enables or disables writability notifications for socket.
+		bool mod(SOCKET _socket, uint32_t _key, bool _writable)
+		{
+			epoll_event ev;
+			ev.events = EPOLLIN
+#	if BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+				| EPOLLET
+#	endif // BNET_CONFIG_EPOLL_EDGE_TRIGGERED
+				;
+			if (_writable)
+			{
+				ev.events |= EPOLLOUT;
+			}
+			ev.data.u64 = _key;
+			return 0 == ::epoll_ctl(m_fd, EPOLL_CTL_MOD, _socket, &ev);
+		}
+
+		uint32_t wait(int32_t _timeoutMs)
+		{
+			int num = ::epoll_wait(m_fd, m_events, BX_COUNTOF(m_events), _timeoutMs);
+			m_num = 0 < num ? uint32_t(num) : 0;
+			return m_num;
+		}
+
+		uint32_t getKey(uint32_t _idx) const
+		{
+			return uint32_t(m_events[_idx].data.u64);
+		}
+
+	private:
+		int m_fd;
+		uint32_t m_num;
+		epoll_event m_events[BNET_CONFIG_MAX_POLL_EVENTS];
 	};
+#endif // BNET_CONFIG_EPOLL
 
 } // namespace bnet
 
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#ifndef BNET_HISTOGRAM_H_HEADER_GUARD
+#define BNET_HISTOGRAM_H_HEADER_GUARD
+
+#include <bx/uint32_t.h> // uint64_cntlz
+
+namespace bnet
+{
+	/// Log-bucketed histogram. Each power of two range is split into
+	/// 2^SubBits buckets, so values are kept with 1/2^SubBits relative
+	/// precision, and values below 2^(SubBits+1) are exact. Recording is
+	/// count leading zeros, shift, and increment.
+	class Histogram
+	{
+	public:
+		Histogram()
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			memset(m_buckets, 0, sizeof(m_buckets) );
+			m_count = 0;
+			m_sum   = 0;
+			m_max   = 0;
+		}
+
+		void record(uint64_t _value)
+		{
+			const uint64_t value = _value < MaxValue ? _value : MaxValue;
+			++m_buckets[getIndex(value)];
+			++m_count;
+			m_sum += value;
+			m_max  = value > m_max ? value : m_max;
+		}
+
+		void add(const Histogram& _other)
+		{
+			for (uint32_t ii = 0; ii < NumBuckets; ++ii)
+			{
+				m_buckets[ii] += _other.m_buckets[ii];
+			}
+
+			m_count += _other.m_count;
+			m_sum   += _other.m_sum;
+			m_max    = _other.m_max > m_max ? _other.m_max : m_max;
+		}
+
+		uint64_t getCount() const
+		{
+			return m_count;
+		}
+
+		uint64_t getMean() const
+		{
+			return 0 != m_count ? m_sum/m_count : 0;
+		}
+
+		uint64_t getMax() const
+		{
+			return m_max;
+		}
+
+		/// Returns highest value of bucket holding _permille of recorded
+		/// values, or 0 when histogram is empty.
+		uint64_t getPercentile(uint32_t _permille) const
+		{
+			const uint64_t rank = (m_count*_permille + 999)/1000;
+			uint64_t count = 0;
+
+			for (uint32_t ii = 0; ii < NumBuckets; ++ii)
+			{
+				count += m_buckets[ii];
+				if (0 != count
+				&&  count >= rank)
+				{
+					const uint64_t value = getHighest(ii);
+					return value < m_max ? value : m_max;
+				}
+			}
+
+			return m_max;
+		}
+
+	private:
+		static const uint32_t SubBits    = 4;
+		static const uint32_t SubCount   = 1<<SubBits;
+		static const uint32_t MaxBits    = 40;
+		static const uint32_t NumBuckets = (MaxBits-SubBits+1)*SubCount;
+		static const uint64_t MaxValue   = (UINT64_C(1)<<MaxBits)-1;
+
+		static uint32_t getIndex(uint64_t _value)
+		{
+			if (_value < 2*SubCount)
+			{
+				return uint32_t(_value);
+			}
+
+			const uint32_t shift = uint32_t(63 - bx::uint64_cntlz(_value) ) - SubBits;
+			return shift*SubCount + uint32_t(_value>>shift);
+		}
+
+		static uint64_t getHighest(uint32_t _index)
+		{
+			if (_index < 2*SubCount)
+			{
+				return _index;
+			}
+
+			const uint32_t shift = _index/SubCount - 1;
+			const uint64_t top   = _index%SubCount + SubCount;
+			return ( (top+1)<<shift) - 1;
+		}
+
+		uint32_t m_buckets[NumBuckets];
+		uint64_t m_count;
+		uint64_t m_sum;
+		uint64_t m_max;
+	};
+
+} // namespace bnet
+
+#endif // BNET_HISTOGRAM_H_HEADER_GUARD
@@ -0,0 +1,342 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#ifndef BNET_LZ4_H_HEADER_GUARD
+#define BNET_LZ4_H_HEADER_GUARD
+
+namespace bnet
+{
+	/// Minimal LZ4 block format codec (no frame format, no external
+	/// dependency). Compressor is greedy single-probe hash matcher, tuned
+	/// for small messages, with optional pre-shared dictionary that
+	/// matches can reference as if it preceded message.
+	static const uint32_t Lz4HashLog  = 12;
+	static const uint32_t Lz4HashSize = 1<<Lz4HashLog;
+	static const uint32_t Lz4MinMatch = 4;
+	static const uint32_t Lz4MaxOffset = UINT16_MAX;
+	static const uint32_t Lz4LastLiterals = 5;  // Block always ends with literals.
+	static const uint32_t Lz4MatchFindLimit = 12; // Last match must start before this.
+
+	inline uint32_t lz4Read32(const uint8_t* _ptr)
+	{
+		uint32_t value;
+		memcpy(&value, _ptr, sizeof(value) );
+		return value;
+	}
+
+	inline uint32_t lz4Hash(uint32_t _sequence)
+	{
+		return (_sequence * UINT32_C(2654435761) ) >> (32 - Lz4HashLog);
+	}
+
+	/// Pre-shared dictionary, hashed once when it's set.
+	struct Lz4Dictionary
+	{
+		uint32_t table[Lz4HashSize]; // Dictionary position + 1, 0 is empty.
+		uint32_t hash; // FNV-1a of data, peers compare it before using dictionary.
+		uint32_t size;
+		uint8_t data[1];
+	};
+
+	inline void lz4InitDictionary(Lz4Dictionary* _dict, const void* _data, uint32_t _size)
+	{
+		memset(_dict->table, 0, sizeof(_dict->table) );
+		memcpy(_dict->data, _data, _size);
+		_dict->size = _size;
+
+		uint32_t hash = UINT32_C(2166136261);
+		for (uint32_t ii = 0; ii < _size; ++ii)
+		{
+			hash = (hash ^ _dict->data[ii]) * UINT32_C(16777619);
+		}
+		_dict->hash = hash;
+
+		// Later positions overwrite earlier ones, so matches are closer to
+		// end of dictionary, and reachable with 16-bit offset.
+		for (uint32_t ii = 0; ii + Lz4MinMatch <= _size; ++ii)
+		{
+			_dict->table[lz4Hash(lz4Read32(&_dict->data[ii]) )] = ii + 1;
+		}
+	}
+
+	/// Match table for messages. Entries are stream positions, so table
+	/// doesn't have to be cleared between messages, only when position
+	/// counter wraps.
+	struct Lz4Table
+	{
+		uint32_t table[Lz4HashSize];
+		uint32_t base;
+	};
+
+	inline void lz4InitTable(Lz4Table* _table)
+	{
+		memset(_table->table, 0, sizeof(_table->table) );
+		_table->base = 1;
+	}
+
+	/// Writes length continuation bytes.
+	inline uint8_t* lz4WriteLength(uint8_t* _dst, uint32_t _len)
+	{
+		for (; _len >= 255; _len -= 255)
+		{
+			*_dst++ = 255;
+		}
+
+		*_dst++ = uint8_t(_len);
+		return _dst;
+	}
+
+	/// Compresses _src into _dst. Returns compressed size, or 0 if it
+	/// doesn't fit into _dstSize.
+	inline uint32_t lz4Compress(uint8_t* _dst, uint32_t _dstSize, const uint8_t* _src, uint32_t _srcSize, Lz4Table* _table, const Lz4Dictionary* _dict)
+	{
+		if (UINT32_MAX/2 < _table->base)
+		{
+			lz4InitTable(_table);
+		}
+
+		const uint32_t base = _table->base;
+		_table->base += _srcSize + 1;
+
+		uint8_t* op = _dst;
+		uint8_t* oend = _dst + _dstSize;
+		const uint8_t* ip = _src;
+		const uint8_t* anchor = _src;
+		const uint8_t* iend = _src + _srcSize;
+		const uint8_t* mflimit = _srcSize > Lz4MatchFindLimit ? iend - Lz4MatchFindLimit : _src;
+		const uint8_t* matchlimit = iend - Lz4LastLiterals;
+
+		while (ip < mflimit)
+		{
+			const uint32_t sequence = lz4Read32(ip);
+			const uint32_t hash = lz4Hash(sequence);
+			const uint32_t pos = uint32_t(ip - _src);
+
+			uint32_t offset = 0;
+			uint32_t len = 0;
+
+			const uint32_t entry = _table->table[hash];
+			_table->table[hash] = base + pos;
+
+			if (entry >= base
+			&&  pos - (entry - base) <= Lz4MaxOffset
+			&&  lz4Read32(&_src[entry - base]) == sequence)
+			{
+				const uint8_t* ref = &_src[entry - base];
+				offset = uint32_t(ip - ref);
+				for (len = Lz4MinMatch; ip + len < matchlimit && ip[len] == ref[len]; ++len)
+				{
+				}
+			}
+			else if (NULL != _dict
+			     &&  0 != _dict->table[hash])
+			{
+				const uint32_t dictPos = _dict->table[hash] - 1;
+				const uint32_t distance = pos + _dict->size - dictPos;
+				if (distance <= Lz4MaxOffset
+				&&  lz4Read32(&_dict->data[dictPos]) == sequence)
+				{
+					// Match can continue past end of dictionary, into
+					// start of message.
+					offset = distance;
+					for (len = Lz4MinMatch; ip + len < matchlimit; ++len)
+					{
+						const uint32_t at = dictPos + len;
+						const uint8_t byte = at < _dict->size ? _dict->data[at] : _src[at - _dict->size];
+						if (ip[len] != byte)
+						{
+							break;
+						}
+					}
+				}
+			}
+
+			if (0 == offset)
+			{
+				// Skip faster through data that doesn't compress.
+				ip += 1 + (uint32_t(ip - anchor)>>6);
+				continue;
+			}
+
+			const uint32_t literals = uint32_t(ip - anchor);
+			const uint32_t matchLen = len - Lz4MinMatch;
+			if (op + 1 + literals + literals/255 + 1 + 2 + matchLen/255 + 1 > oend)
+			{
+				return 0;
+			}
+
+			uint8_t* token = op++;
+			if (literals >= 15)
+			{
+				*token = 15<<4;
+				op = lz4WriteLength(op, literals - 15);
+			}
+			else
+			{
+				*token = uint8_t(literals<<4);
+			}
+
+			memcpy(op, anchor, literals);
+			op += literals;
+
+			*op++ = uint8_t(offset);
+			*op++ = uint8_t(offset>>8);
+
+			if (matchLen >= 15)
+			{
+				*token |= 15;
+				op = lz4WriteLength(op, matchLen - 15);
+			}
+			else
+			{
+				*token |= uint8_t(matchLen);
+			}
+
+			ip += len;
+			anchor = ip;
+		}
+
+		const uint32_t literals = uint32_t(iend - anchor);
+		if (op + 1 + literals + literals/255 + 1 > oend)
+		{
+			return 0;
+		}
+
+		if (literals >= 15)
+		{
+			*op++ = 15<<4;
+			op = lz4WriteLength(op, literals - 15);
+		}
+		else
+		{
+			*op++ = uint8_t(literals<<4);
+		}
+
+		memcpy(op, anchor, literals);
+		op += literals;
+
+		return uint32_t(op - _dst);
+	}
+
+	/// Reads length continuation bytes. Returns false if input ends.
+	inline bool lz4ReadLength(const uint8_t*& _src, const uint8_t* _end, uint32_t& _len)
+	{
+		for (;;)
+		{
+			if (_src >= _end)
+			{
+				return false;
+			}
+
+			const uint8_t byte = *_src++;
+			_len += byte;
+			if (255 != byte)
+			{
+				return true;
+			}
+		}
+	}
+
+	/// Decompresses _src into _dst, never reads or writes out of bounds.
+	/// Returns decompressed size, or -1 if data is malformed.
+	inline int32_t lz4Decompress(uint8_t* _dst, uint32_t _dstSize, const uint8_t* _src, uint32_t _srcSize, const Lz4Dictionary* _dict)
+	{
+		uint8_t* op = _dst;
+		uint8_t* oend = _dst + _dstSize;
+		const uint8_t* ip = _src;
+		const uint8_t* iend = _src + _srcSize;
+
+		while (ip < iend)
+		{
+			const uint8_t token = *ip++;
+
+			uint32_t literals = token>>4;
+			if (15 == literals
+			&&  !lz4ReadLength(ip, iend, literals) )
+			{
+				return -1;
+			}
+
+			if (literals > uint32_t(iend - ip)
+			||  literals > uint32_t(oend - op) )
+			{
+				return -1;
+			}
+
+			memcpy(op, ip, literals);
+			op += literals;
+			ip += literals;
+
+			if (ip == iend)
+			{
+				// Last sequence has only literals.
+				break;
+			}
+
+			if (2 > iend - ip)
+			{
+				return -1;
+			}
+
+			const uint32_t offset = ip[0] | (uint32_t(ip[1])<<8);
+			ip += 2;
+
+			uint32_t len = token & 15;
+			if (15 == len
+			&&  !lz4ReadLength(ip, iend, len) )
+			{
+				return -1;
+			}
+			len += Lz4MinMatch;
+
+			const uint32_t produced = uint32_t(op - _dst);
+			if (0 == offset
+			||  len > uint32_t(oend - op) )
+			{
+				return -1;
+			}
+
+			const uint8_t* ref;
+			if (offset > produced)
+			{
+				const uint32_t back = offset - produced;
+				if (NULL == _dict
+				||  back > _dict->size)
+				{
+					return -1;
+				}
+
+				const uint32_t size = back < len ? back : len;
+				memcpy(op, &_dict->data[_dict->size - back], size);
+				op  += size;
+				len -= size;
+				ref = _dst;
+			}
+			else
+			{
+				ref = op - offset;
+			}
+
+			if (uint32_t(op - ref) >= len)
+			{
+				memcpy(op, ref, len);
+				op += len;
+			}
+			else
+			{
+				// Overlapping match repeats last bytes.
+				for (; 0 < len; --len)
+				{
+					*op++ = *ref++;
+				}
+			}
+		}
+
+		return int32_t(op - _dst);
+	}
+
+} // namespace bnet
+
+#endif // BNET_LZ4_H_HEADER_GUARD
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#ifndef BNET_RESOLVER_H_HEADER_GUARD
+#define BNET_RESOLVER_H_HEADER_GUARD
+
+#include <bx/string.h> // strlcpy
+
+#if BNET_CONFIG_RESOLVER_THREADS
+#	include <bx/mutex.h>
+#	include <bx/sem.h>
+#	include <bx/thread.h>
+#endif // BNET_CONFIG_RESOLVER_THREADS
+
+namespace bnet
+{
+	/// Host name lookup. Requests for host that is already being resolved
+	/// wait on first request, instead of calling resolver again.
+	struct ResolveRequest
+	{
+		ResolveRequest* next;     // Resolver queue.
+		ResolveRequest* inflight; // Requests owned by context, waiting for result.
+		ResolveRequest* waiting;  // Requests for same host.
+		ResolveFn fn;
+		void* fnUserData;
+		uint64_t userData;
+		Address addrs[BNET_CONFIG_MAX_ADDRESSES];
+		uint32_t num;
+		uint32_t ttl;
+		char host[BNET_CONFIG_RESOLVER_MAX_NAME];
+	};
+
+	/// Cached lookup, failed lookups are cached without addresses.
+	struct ResolverEntry
+	{
+		char host[BNET_CONFIG_RESOLVER_MAX_NAME];
+		Address addrs[BNET_CONFIG_MAX_ADDRESSES];
+		uint32_t num;
+		int64_t expires;
+		int64_t used;
+	};
+
+	/// Resolves host names on small thread pool, so slow resolver doesn't
+	/// block thread driving context. Cache and request list are accessed
+	/// only by thread owning context, resolver threads only see request
+	/// queues.
+	class Resolver
+	{
+		BX_CLASS(Resolver
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		typedef void (*WakeFn)(void* _userData);
+
+		Resolver(bx::AllocatorI* _allocator)
+			: m_allocator(_allocator)
+			, m_fn(NULL)
+			, m_fnUserData(NULL)
+			, m_wakeFn(NULL)
+			, m_wakeUserData(NULL)
+			, m_inflight(NULL)
+			, m_pending(NULL)
+			, m_pendingTail(NULL)
+			, m_done(NULL)
+			, m_doneTail(NULL)
+			, m_numThreads(0)
+			, m_quit(false)
+		{
+			memset(m_cache, 0, sizeof(m_cache) );
+		}
+
+		/// _wakeFn is called by resolver thread when lookup is done.
+		void init(ResolveFn _fn, void* _fnUserData, WakeFn _wakeFn, void* _wakeUserData)
+		{
+			m_fn = _fn;
+			m_fnUserData = _fnUserData;
+			m_wakeFn = _wakeFn;
+			m_wakeUserData = _wakeUserData;
+		}
+
+		/// Stops resolver threads, lookups that are not done yet are never
+		/// returned.
+		void stop()
+		{
+#if BNET_CONFIG_RESOLVER_THREADS
+			if (0 != m_numThreads)
+			{
+				m_lock.lock();
+				m_quit = true;
+				m_lock.unlock();
+
+				m_sem.post(m_numThreads);
+				for (uint32_t ii = 0; ii < m_numThreads; ++ii)
+				{
+					m_thread[ii].shutdown();
+				}
+				m_numThreads = 0;
+			}
+#endif // BNET_CONFIG_RESOLVER_THREADS
+		}
+
+		void shutdown()
+		{
+			stop();
+
+			// Requests stay on inflight list, until they are returned by
+			// `pop`, whether they are queued or done.
+			for (ResolveRequest* req = m_inflight; NULL != req;)
+			{
+				ResolveRequest* next = req->inflight;
+				free(req);
+				req = next;
+			}
+			m_inflight = NULL;
+			m_pending = NULL;
+			m_pendingTail = NULL;
+			m_done = NULL;
+			m_doneTail = NULL;
+		}
+
+		/// Resolver used by lookups started after this call.
+		void setResolver(ResolveFn _fn, void* _userData)
+		{
+			m_fn = _fn;
+			m_fnUserData = _userData;
+			memset(m_cache, 0, sizeof(m_cache) );
+		}
+
+		/// Returns cached lookup, or NULL if host is not in cache.
+		const ResolverEntry* find(const char* _host)
+		{
+			const int64_t now = bx::getHPCounter();
+
+			for (uint32_t ii = 0; ii < BNET_CONFIG_RESOLVER_CACHE_SIZE; ++ii)
+			{
+				ResolverEntry& entry = m_cache[ii];
+				if (now < entry.expires
+				&&  0 == strcmp(entry.host, _host) )
+				{
+					entry.used = now;
+					return &entry;
+				}
+			}
+
+			return NULL;
+		}
+
+		void resolve(const char* _host, uint64_t _userData)
+		{
+			ResolveRequest* req = (ResolveRequest*)BX_ALLOC(m_allocator, sizeof(ResolveRequest) );
+			memset(req, 0, sizeof(ResolveRequest) );
+			req->fn = m_fn;
+			req->fnUserData = m_fnUserData;
+			req->userData = _userData;
+			bx::strlcpy(req->host, _host, BNET_CONFIG_RESOLVER_MAX_NAME);
+
+			for (ResolveRequest* inflight = m_inflight; NULL != inflight; inflight = inflight->inflight)
+			{
+				if (0 == strcmp(inflight->host, req->host) )
+				{
+					req->waiting = inflight->waiting;
+					inflight->waiting = req;
+					return;
+				}
+			}
+
+			req->inflight = m_inflight;
+			m_inflight = req;
+
+#if BNET_CONFIG_RESOLVER_THREADS
+			m_lock.lock();
+			if (NULL == m_pendingTail)
+			{
+				m_pending = req;
+			}
+			else
+			{
+				m_pendingTail->next = req;
+			}
+			m_pendingTail = req;
+			m_lock.unlock();
+
+			if (BNET_CONFIG_RESOLVER_THREADS != m_numThreads)
+			{
+				// Threads are started on demand, context that never
+				// resolves host names doesn't have any.
+				m_thread[m_numThreads].init(threadFunc, this, 64<<10, "bnet resolver");
+				++m_numThreads;
+			}
+
+			m_sem.post();
+#else
+			lookup(req);
+			push(req);
+#endif // BNET_CONFIG_RESOLVER_THREADS
+		}
+
+		/// Returns finished lookup, with requests waiting for it, and adds
+		/// it to cache. Request must be released with `free`.
+		ResolveRequest* pop()
+		{
+#if BNET_CONFIG_RESOLVER_THREADS
+			bx::MutexScope scope(m_lock);
+#endif // BNET_CONFIG_RESOLVER_THREADS
+
+			ResolveRequest* req = m_done;
+			if (NULL != req)
+			{
+				m_done = req->next;
+				if (NULL == m_done)
+				{
+					m_doneTail = NULL;
+				}
+
+				for (ResolveRequest** it = &m_inflight; NULL != *it; it = &(*it)->inflight)
+				{
+					if (req == *it)
+					{
+						*it = req->inflight;
+						break;
+					}
+				}
+
+				insert(req);
+			}
+
+			return req;
+		}
+
+		/// Releases request, and requests waiting for it.
+		void free(ResolveRequest* _req)
+		{
+			for (ResolveRequest* req = _req; NULL != req;)
+			{
+				ResolveRequest* next = req->waiting;
+				BX_FREE(m_allocator, req);
+				req = next;
+			}
+		}
+
+	private:
+		static void lookup(ResolveRequest* _req)
+		{
+			_req->num = BNET_CONFIG_MAX_ADDRESSES;
+			_req->ttl = BNET_CONFIG_RESOLVER_NEGATIVE_TTL_SECONDS;
+
+			if (!_req->fn(_req->host, _req->addrs, &_req->num, &_req->ttl, _req->fnUserData)
+			||  0 == _req->num)
+			{
+				_req->num = 0;
+				_req->ttl = BNET_CONFIG_RESOLVER_NEGATIVE_TTL_SECONDS;
+			}
+
+			_req->num = _req->num < BNET_CONFIG_MAX_ADDRESSES ? _req->num : BNET_CONFIG_MAX_ADDRESSES;
+		}
+
+		void push(ResolveRequest* _req)
+		{
+			_req->next = NULL;
+			if (NULL == m_doneTail)
+			{
+				m_done = _req;
+			}
+			else
+			{
+				m_doneTail->next = _req;
+			}
+			m_doneTail = _req;
+		}
+
+		/// Replaces entry for same host, expired entry, or least recently
+		/// used entry.
+		void insert(const ResolveRequest* _req)
+		{
+			if (0 == _req->ttl)
+			{
+				return;
+			}
+
+			const int64_t now = bx::getHPCounter();
+
+			ResolverEntry* entry = NULL;
+			int64_t oldest = INT64_MAX;
+			for (uint32_t ii = 0; ii < BNET_CONFIG_RESOLVER_CACHE_SIZE; ++ii)
+			{
+				ResolverEntry& candidate = m_cache[ii];
+				if (0 == strcmp(candidate.host, _req->host) )
+				{
+					entry = &candidate;
+					break;
+				}
+
+				const int64_t used = candidate.expires <= now ? INT64_MIN : candidate.used;
+				if (used < oldest)
+				{
+					entry = &candidate;
+					oldest = used;
+				}
+			}
+
+			bx::strlcpy(entry->host, _req->host, BNET_CONFIG_RESOLVER_MAX_NAME);
+			memcpy(entry->addrs, _req->addrs, _req->num*sizeof(Address) );
+			entry->num = _req->num;
+			entry->expires = now + int64_t(_req->ttl)*bx::getHPFrequency();
+			entry->used = now;
+		}
+
+#if BNET_CONFIG_RESOLVER_THREADS
+		static int32_t threadFunc(void* _userData)
+		{
+			Resolver* resolver = (Resolver*)_userData;
+			resolver->threadLoop();
+			return 0;
+		}
+
+		void threadLoop()
+		{
+			for (;;)
+			{
+				m_sem.wait();
+
+				m_lock.lock();
+				if (m_quit)
+				{
+					m_lock.unlock();
+					break;
+				}
+
+				ResolveRequest* req = m_pending;
+				if (NULL != req)
+				{
+					m_pending = req->next;
+					if (NULL == m_pending)
+					{
+						m_pendingTail = NULL;
+					}
+				}
+				m_lock.unlock();
+
+				if (NULL != req)
+				{
+					lookup(req);
+
+					m_lock.lock();
+					push(req);
+					m_lock.unlock();
+
+					m_wakeFn(m_wakeUserData);
+				}
+			}
+		}
+
+		bx::Thread m_thread[BNET_CONFIG_RESOLVER_THREADS];
+		bx::Mutex m_lock;
+		bx::Semaphore m_sem;
+#endif // BNET_CONFIG_RESOLVER_THREADS
+
+		bx::AllocatorI* m_allocator;
+		ResolveFn m_fn;
+		void* m_fnUserData;
+		WakeFn m_wakeFn;
+		void* m_wakeUserData;
+		ResolveRequest* m_inflight;
+		ResolveRequest* m_pending;
+		ResolveRequest* m_pendingTail;
+		ResolveRequest* m_done;
+		ResolveRequest* m_doneTail;
+		uint32_t m_numThreads;
+		bool m_quit;
+		ResolverEntry m_cache[BNET_CONFIG_RESOLVER_CACHE_SIZE];
+	};
+
+} // namespace bnet
+
+#endif // BNET_RESOLVER_H_HEADER_GUARD
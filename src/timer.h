@@ -0,0 +1,294 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#ifndef BNET_TIMER_H_HEADER_GUARD
+#define BNET_TIMER_H_HEADER_GUARD
+
+namespace bnet
+{
+	/// Timer node, embedded in object that owns timer. Key identifies
+	/// timer to owner of wheel.
+	struct Timer
+	{
+		Timer()
+			: prev(NULL)
+			, next(NULL)
+			, expires(0)
+			, key(0)
+		{
+		}
+
+		Timer* prev;
+		Timer* next;
+		uint64_t expires; // Wheel tick.
+		uint32_t key;
+	};
+
+	/// Hierarchical timer wheel. Slots of each level cover 64 slots of
+	/// level below, timers are moved to lower level when its slot is
+	/// reached. Adding and removing timer is O(1), and tick only touches
+	/// expired timers, and timers moved from higher level.
+	class TimerWheel
+	{
+		BX_CLASS(TimerWheel
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		TimerWheel()
+			: m_start(0)
+			, m_tickFreq(1)
+			, m_tick(0)
+			, m_now(0)
+			, m_num(0)
+		{
+			reset();
+		}
+
+		~TimerWheel()
+		{
+			BX_CHECK(0 == m_num, "Timers are still active %d.", m_num);
+		}
+
+		void init(int64_t _now)
+		{
+			m_start = _now;
+			m_tickFreq = bx::getHPFrequency()*BNET_CONFIG_TIMER_TICK_MS/1000;
+			m_tickFreq = 0 < m_tickFreq ? m_tickFreq : 1;
+			m_tick = 0;
+			m_now = 0;
+		}
+
+		/// Forgets all timers, without touching them.
+		void reset()
+		{
+			for (uint32_t ii = 0; ii < NumLevels*NumSlots; ++ii)
+			{
+				clear(m_slots[ii]);
+			}
+
+			clear(m_expired);
+			m_num = 0;
+		}
+
+		/// Current tick, as of last `update` or `add`.
+		uint64_t getTick() const
+		{
+			return m_now;
+		}
+
+		uint64_t msToTicks(uint32_t _ms) const
+		{
+			return (uint64_t(_ms) + BNET_CONFIG_TIMER_TICK_MS - 1)/BNET_CONFIG_TIMER_TICK_MS;
+		}
+
+		uint32_t getNum() const
+		{
+			return m_num;
+		}
+
+		bool isActive(const Timer* _timer) const
+		{
+			return NULL != _timer->next;
+		}
+
+		/// Timer expires after at least _ms milliseconds.
+		void add(Timer* _timer, uint32_t _ms)
+		{
+			setNow(bx::getHPCounter() );
+
+			// Current tick is partially elapsed, so one tick is added to
+			// never expire early.
+			addAt(_timer, m_now + msToTicks(_ms) + 1);
+		}
+
+		/// Timer expires once `getTick` reaches _tick.
+		void addAt(Timer* _timer, uint64_t _tick)
+		{
+			remove(_timer);
+
+			_timer->expires = _tick;
+			link(_timer);
+			++m_num;
+		}
+
+		void remove(Timer* _timer)
+		{
+			if (isActive(_timer) )
+			{
+				unlink(_timer);
+				--m_num;
+			}
+		}
+
+		/// Moves timers that expired by _now to expired list.
+		void update(int64_t _now)
+		{
+			setNow(_now);
+
+			if (0 == m_num)
+			{
+				m_tick = m_now+1;
+				return;
+			}
+
+			for (; m_tick <= m_now; ++m_tick)
+			{
+				const uint32_t slot = uint32_t(m_tick) & SlotMask;
+
+				// Timers of next block of higher level are moved down
+				// once lower level wraps around.
+				if (0 == slot)
+				{
+					for (uint32_t level = 1; level < NumLevels; ++level)
+					{
+						const uint32_t index = uint32_t(m_tick>>(level*SlotBits) ) & SlotMask;
+						cascade(m_slots[level*NumSlots + index]);
+
+						if (0 != index)
+						{
+							break;
+						}
+					}
+				}
+
+				splice(m_expired, m_slots[slot]);
+			}
+		}
+
+		/// Returns expired timer, timer is not active anymore.
+		Timer* pop()
+		{
+			Timer* timer = m_expired.next;
+			if (&m_expired == timer)
+			{
+				return NULL;
+			}
+
+			unlink(timer);
+			--m_num;
+			return timer;
+		}
+
+		/// Returns number of ticks until next timer on lowest level
+		/// expires, or until lowest level wraps around.
+		uint32_t getWaitTicks() const
+		{
+			if (m_expired.next != &m_expired)
+			{
+				return 0;
+			}
+
+			const uint32_t pending = m_tick > m_now ? uint32_t(m_tick - m_now) : 0;
+			const uint32_t start   = uint32_t(m_tick) & SlotMask;
+			for (uint32_t ii = start; ii < NumSlots; ++ii)
+			{
+				if (m_slots[ii].next != &m_slots[ii])
+				{
+					return pending + ii - start;
+				}
+			}
+
+			// Higher level is moved down on first tick of lowest level.
+			return pending + ( (NumSlots - start) & SlotMask);
+		}
+
+	private:
+		static const uint32_t SlotBits  = 6;
+		static const uint32_t NumSlots  = 1<<SlotBits;
+		static const uint32_t SlotMask  = NumSlots-1;
+		static const uint32_t NumLevels = 4;
+
+		void setNow(int64_t _now)
+		{
+			const uint64_t now = uint64_t(_now - m_start)/m_tickFreq;
+			m_now = now > m_now ? now : m_now;
+		}
+
+		static void clear(Timer& _list)
+		{
+			_list.prev = &_list;
+			_list.next = &_list;
+		}
+
+		static void unlink(Timer* _timer)
+		{
+			_timer->prev->next = _timer->next;
+			_timer->next->prev = _timer->prev;
+			_timer->prev = NULL;
+			_timer->next = NULL;
+		}
+
+		static void pushBack(Timer& _list, Timer* _timer)
+		{
+			_timer->prev = _list.prev;
+			_timer->next = &_list;
+			_list.prev->next = _timer;
+			_list.prev = _timer;
+		}
+
+		static void splice(Timer& _dst, Timer& _src)
+		{
+			if (_src.next != &_src)
+			{
+				_src.next->prev = _dst.prev;
+				_src.prev->next = &_dst;
+				_dst.prev->next = _src.next;
+				_dst.prev = _src.prev;
+				clear(_src);
+			}
+		}
+
+		void link(Timer* _timer)
+		{
+			// Timer that already expired fires on next processed tick.
+			uint64_t expires = _timer->expires > m_tick ? _timer->expires : m_tick;
+			uint64_t delta   = expires - m_tick;
+
+			uint32_t level = 0;
+			while (level < NumLevels-1
+			&&     delta >= UINT64_C(1)<<( (level+1)*SlotBits) )
+			{
+				++level;
+			}
+
+			if (delta >= UINT64_C(1)<<(NumLevels*SlotBits) )
+			{
+				// Beyond wheel range, placed in farthest slot and moved
+				// down again once it's reached.
+				expires = m_tick + (UINT64_C(1)<<(NumLevels*SlotBits) ) - 1;
+			}
+
+			const uint32_t index = uint32_t(expires>>(level*SlotBits) ) & SlotMask;
+			pushBack(m_slots[level*NumSlots + index], _timer);
+		}
+
+		void cascade(Timer& _list)
+		{
+			Timer list;
+			clear(list);
+			splice(list, _list);
+
+			while (list.next != &list)
+			{
+				Timer* timer = list.next;
+				unlink(timer);
+				link(timer);
+			}
+		}
+
+		Timer m_slots[NumLevels*NumSlots];
+		Timer m_expired;
+		int64_t m_start;
+		uint64_t m_tickFreq;
+		uint64_t m_tick; // Next tick to process.
+		uint64_t m_now;
+		uint32_t m_num;
+	};
+
+} // namespace bnet
+
+#endif // BNET_TIMER_H_HEADER_GUARD
@@ -0,0 +1,377 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#ifndef BNET_UDP_H_HEADER_GUARD
+#define BNET_UDP_H_HEADER_GUARD
+
+#include <sys/uio.h> // iovec
+#include <bx/allocator.h>
+
+namespace bnet
+{
+	/// Datagram is kind byte, followed by kind specific data. Data
+	/// datagram has ack header, followed by message records.
+	struct UdpKind
+	{
+		enum Enum
+		{
+			Connect = 0xb1, // u32 magic, u64 cookie, zero until host sends challenge.
+			Accept,
+			Data,
+			Disconnect,
+			Challenge,      // u64 cookie.
+			Ack,            // u16 ack, u8 size, ack bits of whole receive window.
+		};
+	};
+
+	static const uint32_t UdpAckHeaderSize    = 7; // kind, u16 ack, u32 ack bits
+	static const uint32_t UdpAckBitsSize      = BNET_CONFIG_UDP_WINDOW/8;
+	static const uint32_t UdpRecordHeaderSize = 5; // channel, u16 seq, u16 size
+	static const uint32_t UdpMaxMessageSize   = BNET_CONFIG_UDP_MTU - UdpAckHeaderSize - UdpRecordHeaderSize;
+
+	// Connect is always sent with cookie field, so challenge is never
+	// larger than datagram that caused it.
+	static const uint32_t UdpConnectSize   = 13;
+	static const uint32_t UdpChallengeSize = 9;
+
+	/// Cookie is valid until end of next period after it was issued.
+	static const uint32_t UdpCookieSeconds = 10;
+
+	inline uint64_t rotl64(uint64_t _a, uint32_t _shift)
+	{
+		return (_a << _shift) | (_a >> (64 - _shift) );
+	}
+
+	inline void sipRound(uint64_t& _v0, uint64_t& _v1, uint64_t& _v2, uint64_t& _v3)
+	{
+		_v0 += _v1; _v1 = rotl64(_v1, 13); _v1 ^= _v0; _v0 = rotl64(_v0, 32);
+		_v2 += _v3; _v3 = rotl64(_v3, 16); _v3 ^= _v2;
+		_v0 += _v3; _v3 = rotl64(_v3, 21); _v3 ^= _v0;
+		_v2 += _v1; _v1 = rotl64(_v1, 17); _v1 ^= _v2; _v2 = rotl64(_v2, 32);
+	}
+
+	/// SipHash-2-4 of 16 byte message _m0, _m1. Keyed hash, so cookie
+	/// can't be forged without knowing host's secret.
+	inline uint64_t sipHash(const uint64_t _key[2], uint64_t _m0, uint64_t _m1)
+	{
+		uint64_t v0 = _key[0] ^ UINT64_C(0x736f6d6570736575);
+		uint64_t v1 = _key[1] ^ UINT64_C(0x646f72616e646f6d);
+		uint64_t v2 = _key[0] ^ UINT64_C(0x6c7967656e657261);
+		uint64_t v3 = _key[1] ^ UINT64_C(0x7465646279746573);
+
+		const uint64_t msg[3] = { _m0, _m1, UINT64_C(16)<<56 };
+		for (uint32_t ii = 0; ii < 3; ++ii)
+		{
+			v3 ^= msg[ii];
+			sipRound(v0, v1, v2, v3);
+			sipRound(v0, v1, v2, v3);
+			v0 ^= msg[ii];
+		}
+
+		v2 ^= 0xff;
+		sipRound(v0, v1, v2, v3);
+		sipRound(v0, v1, v2, v3);
+		sipRound(v0, v1, v2, v3);
+		sipRound(v0, v1, v2, v3);
+
+		return v0 ^ v1 ^ v2 ^ v3;
+	}
+
+	/// Connections accepted by UDP listen sockets, by listen socket and
+	/// peer address. Open addressing with linear probing, table is at
+	/// least twice the number of connections, so probes stay short.
+	class UdpPeers
+	{
+		BX_CLASS(UdpPeers
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		UdpPeers()
+			: m_allocator(NULL)
+			, m_keys(NULL)
+			, m_values(NULL)
+			, m_mask(0)
+		{
+		}
+
+		~UdpPeers()
+		{
+			shutdown();
+		}
+
+		void init(bx::AllocatorI* _allocator, uint16_t _max)
+		{
+			uint32_t size = 2;
+			while (size < uint32_t(_max)*2)
+			{
+				size *= 2;
+			}
+
+			m_allocator = _allocator;
+			m_keys   = (uint64_t*)BX_ALLOC(m_allocator, size*sizeof(uint64_t) );
+			m_values = (uint16_t*)BX_ALLOC(m_allocator, size*sizeof(uint16_t) );
+			memset(m_values, 0xff, size*sizeof(uint16_t) );
+			m_mask = size-1;
+		}
+
+		void shutdown()
+		{
+			if (NULL != m_keys)
+			{
+				BX_FREE(m_allocator, m_keys);
+				BX_FREE(m_allocator, m_values);
+				m_keys   = NULL;
+				m_values = NULL;
+			}
+		}
+
+		static uint64_t makeKey(uint16_t _listenIdx, uint32_t _ip, uint16_t _port)
+		{
+			return uint64_t(_listenIdx)<<48
+				| uint64_t(_ip)<<16
+				| _port
+				;
+		}
+
+		/// Returns connection index, or UINT16_MAX if peer isn't found.
+		uint16_t find(uint64_t _key) const
+		{
+			for (uint32_t ii = hash(_key);; ii = (ii+1) & m_mask)
+			{
+				if (UINT16_MAX == m_values[ii]
+				||  _key == m_keys[ii])
+				{
+					return m_values[ii];
+				}
+			}
+		}
+
+		/// Replaces connection of peer, if it's already in table.
+		void insert(uint64_t _key, uint16_t _idx)
+		{
+			uint32_t ii = hash(_key);
+			while (UINT16_MAX != m_values[ii]
+			&&     _key != m_keys[ii])
+			{
+				ii = (ii+1) & m_mask;
+			}
+
+			m_keys[ii]   = _key;
+			m_values[ii] = _idx;
+		}
+
+		/// Removes peer only if it still maps to connection _idx.
+		void remove(uint64_t _key, uint16_t _idx)
+		{
+			uint32_t ii = hash(_key);
+			for (; UINT16_MAX != m_values[ii]; ii = (ii+1) & m_mask)
+			{
+				if (_key == m_keys[ii])
+				{
+					break;
+				}
+			}
+
+			if (_idx != m_values[ii])
+			{
+				return;
+			}
+
+			// Entries after removed one are shifted back, unless that
+			// moves them before their home slot.
+			for (uint32_t jj = (ii+1) & m_mask; UINT16_MAX != m_values[jj]; jj = (jj+1) & m_mask)
+			{
+				const uint32_t home = hash(m_keys[jj]);
+				if ( ( (jj - home) & m_mask) >= ( (jj - ii) & m_mask) )
+				{
+					m_keys[ii]   = m_keys[jj];
+					m_values[ii] = m_values[jj];
+					ii = jj;
+				}
+			}
+
+			m_values[ii] = UINT16_MAX;
+		}
+
+	private:
+		uint32_t hash(uint64_t _key) const
+		{
+			return uint32_t( (_key * UINT64_C(0x9e3779b97f4a7c15) ) >> 32) & m_mask;
+		}
+
+		bx::AllocatorI* m_allocator;
+		uint64_t* m_keys;
+		uint16_t* m_values;
+		uint32_t m_mask;
+	};
+
+	/// Returns true if sequence number _a is newer than _b, sequence
+	/// numbers wrap around.
+	inline bool seqGreater(uint16_t _a, uint16_t _b)
+	{
+		return 0 < int16_t(_a - _b);
+	}
+
+	/// Scratch datagrams for sendmmsg/recvmmsg. Shared by all UDP sockets
+	/// of context, since only one socket is updated at the time.
+	class UdpBatch
+	{
+		BX_CLASS(UdpBatch
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		UdpBatch()
+			: m_num(0)
+			, m_headerSize(0)
+			, m_open(false)
+		{
+			for (uint32_t ii = 0; ii < BNET_CONFIG_UDP_BATCH; ++ii)
+			{
+				m_iov[ii].iov_base = m_data[ii];
+				m_iov[ii].iov_len  = 0;
+				memset(&m_hdr[ii], 0, sizeof(mmsghdr) );
+				m_hdr[ii].msg_hdr.msg_iov    = &m_iov[ii];
+				m_hdr[ii].msg_hdr.msg_iovlen = 1;
+			}
+		}
+
+		/// Starts batch of datagrams, each starting with _header.
+		void begin(const uint8_t* _header, uint32_t _size)
+		{
+			memcpy(m_header, _header, _size);
+			m_headerSize = _size;
+			m_num  = 0;
+			m_open = false;
+		}
+
+		/// Returns space for _size bytes in last datagram, or in new one
+		/// when it doesn't fit. Returns NULL when batch is full.
+		uint8_t* append(uint32_t _size)
+		{
+			if (0 == m_num
+			||  !m_open
+			||  m_iov[m_num-1].iov_len + _size > BNET_CONFIG_UDP_MTU)
+			{
+				if (BNET_CONFIG_UDP_BATCH == m_num)
+				{
+					return NULL;
+				}
+
+				memcpy(m_data[m_num], m_header, m_headerSize);
+				m_iov[m_num].iov_len = m_headerSize;
+				++m_num;
+				m_open = true;
+			}
+
+			iovec& iov = m_iov[m_num-1];
+			uint8_t* data = (uint8_t*)iov.iov_base + iov.iov_len;
+			iov.iov_len += _size;
+			return data;
+		}
+
+		/// Adds datagram with header only, unless batch already has one.
+		void appendHeader()
+		{
+			if (0 == m_num)
+			{
+				append(0);
+			}
+		}
+
+		bool isEmpty() const
+		{
+			return 0 == m_num;
+		}
+
+		/// Sends batch on connected socket. Datagrams that can't be sent
+		/// are dropped, socket errors are reported by next receive.
+		/// Returns size of datagrams that were sent.
+		uint32_t send(SOCKET _socket)
+		{
+			uint32_t bytes = 0;
+			uint32_t sent = 0;
+			while (sent < m_num)
+			{
+				for (uint32_t ii = sent; ii < m_num; ++ii)
+				{
+					m_hdr[ii].msg_hdr.msg_name    = NULL;
+					m_hdr[ii].msg_hdr.msg_namelen = 0;
+				}
+
+				int result = ::sendmmsg(_socket, &m_hdr[sent], m_num - sent, 0);
+				if (0 > result)
+				{
+					if (EINTR == errno)
+					{
+						continue;
+					}
+
+					break;
+				}
+
+				for (int32_t ii = 0; ii < result; ++ii)
+				{
+					bytes += m_hdr[sent+ii].msg_len;
+				}
+
+				sent += uint32_t(result);
+			}
+
+			m_num  = 0;
+			m_open = false;
+			return bytes;
+		}
+
+		/// Receives up to BNET_CONFIG_UDP_BATCH datagrams. Returns number
+		/// of datagrams, or -1 on error.
+		int recv(SOCKET _socket)
+		{
+			for (uint32_t ii = 0; ii < BNET_CONFIG_UDP_BATCH; ++ii)
+			{
+				m_iov[ii].iov_len = BNET_CONFIG_UDP_MTU;
+				m_hdr[ii].msg_hdr.msg_name    = &m_addr[ii];
+				m_hdr[ii].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			}
+
+			m_num  = 0;
+			m_open = false;
+
+			int result = ::recvmmsg(_socket, m_hdr, BNET_CONFIG_UDP_BATCH, MSG_DONTWAIT, NULL);
+			return result;
+		}
+
+		const uint8_t* getData(uint32_t _idx) const
+		{
+			return m_data[_idx];
+		}
+
+		uint32_t getSize(uint32_t _idx) const
+		{
+			return m_hdr[_idx].msg_len;
+		}
+
+		const sockaddr_in& getAddr(uint32_t _idx) const
+		{
+			return m_addr[_idx];
+		}
+
+	private:
+		mmsghdr m_hdr[BNET_CONFIG_UDP_BATCH];
+		iovec m_iov[BNET_CONFIG_UDP_BATCH];
+		sockaddr_in m_addr[BNET_CONFIG_UDP_BATCH];
+		uint8_t m_data[BNET_CONFIG_UDP_BATCH][BNET_CONFIG_UDP_MTU];
+		uint8_t m_header[UdpAckHeaderSize];
+		uint32_t m_num;
+		uint32_t m_headerSize;
+		bool m_open;
+	};
+
+} // namespace bnet
+
+#endif // BNET_UDP_H_HEADER_GUARD
@@ -0,0 +1,496 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#ifndef BNET_URING_H_HEADER_GUARD
+#define BNET_URING_H_HEADER_GUARD
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace bnet
+{
+	/// Minimal io_uring wrapper. It talks to kernel directly (no liburing
+	/// dependency) and supports only what bnet needs: multishot accept,
+	/// multishot receive into provided buffer ring, linked sends and
+	/// cancelation by socket.
+	class Uring
+	{
+		BX_CLASS(Uring
+			, NO_COPY
+			, NO_ASSIGNMENT
+			);
+
+	public:
+		Uring()
+			: m_fd(-1)
+			, m_sqRing(NULL)
+			, m_sqRingSize(0)
+			, m_cqRing(NULL)
+			, m_sqes(NULL)
+			, m_sqesSize(0)
+			, m_bufRing(NULL)
+			, m_bufRingSize(0)
+			, m_buffers(NULL)
+			, m_numBuffers(0)
+			, m_bufferSize(0)
+			, m_sqTail(0)
+			, m_sqSubmitted(0)
+		{
+		}
+
+		~Uring()
+		{
+			shutdown();
+		}
+
+		bool init(uint32_t _entries, uint32_t _numBuffers, uint32_t _bufferSize)
+		{
+			io_uring_params params;
+			memset(&params, 0, sizeof(params) );
+			params.flags = IORING_SETUP_CQSIZE;
+			params.cq_entries = _entries*4;
+
+			m_fd = (int)::syscall(__NR_io_uring_setup, _entries, &params);
+			if (0 > m_fd)
+			{
+				BX_TRACE("io_uring_setup failed %d.", errno);
+				m_fd = -1;
+				return false;
+			}
+
+			if (0 == (params.features & IORING_FEAT_SINGLE_MMAP)
+			||  !mapRings(params)
+			||  !initBuffers(_numBuffers, _bufferSize)
+			||  !probeMultishotRecv() )
+			{
+				shutdown();
+				return false;
+			}
+
+			return true;
+		}
+
+		void shutdown()
+		{
+			if (-1 != m_fd)
+			{
+				::close(m_fd);
+				m_fd = -1;
+			}
+
+			unmap(m_sqRing, m_sqRingSize);
+			unmap(m_sqes, m_sqesSize);
+			unmap(m_bufRing, m_bufRingSize);
+			unmap(m_buffers, m_numBuffers*m_bufferSize);
+			m_cqRing = NULL;
+		}
+
+		bool isValid() const
+		{
+			return -1 != m_fd;
+		}
+
+		/// Ring fd is readable while completion queue is not empty.
+		int getFd() const
+		{
+			return m_fd;
+		}
+
+		/// Request functions return false if submission queue is full,
+		/// and it couldn't be flushed.
+		bool accept(SOCKET _socket, uint64_t _userData)
+		{
+			io_uring_sqe* sqe = getSqe();
+			if (NULL == sqe)
+			{
+				return false;
+			}
+
+			sqe->opcode    = IORING_OP_ACCEPT;
+			sqe->fd        = _socket;
+			sqe->ioprio    = IORING_ACCEPT_MULTISHOT;
+			sqe->user_data = _userData;
+			return true;
+		}
+
+		bool recv(SOCKET _socket, uint64_t _userData)
+		{
+			io_uring_sqe* sqe = getSqe();
+			if (NULL == sqe)
+			{
+				return false;
+			}
+
+			sqe->opcode    = IORING_OP_RECV;
+			sqe->fd        = _socket;
+			sqe->ioprio    = IORING_RECV_MULTISHOT;
+			sqe->flags     = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = BufferGroup;
+			sqe->user_data = _userData;
+			return true;
+		}
+
+		/// Linked sends must be queued without flushing, otherwise chain
+		/// would be split. Caller checks `getSqSpace` for whole chain
+		/// before queuing first send.
+		bool send(SOCKET _socket, const void* _data, uint32_t _len, uint64_t _userData, bool _link)
+		{
+			io_uring_sqe* sqe = getSqe();
+			if (NULL == sqe)
+			{
+				return false;
+			}
+
+			sqe->opcode    = IORING_OP_SEND;
+			sqe->fd        = _socket;
+			sqe->addr      = uint64_t(uintptr_t(_data) );
+			sqe->len       = _len;
+			sqe->msg_flags = MSG_WAITALL|MSG_NOSIGNAL;
+			sqe->flags     = _link ? IOSQE_IO_LINK : 0;
+			sqe->user_data = _userData;
+			return true;
+		}
+
+		/// Cancel all requests on socket. Submitted immediately since socket
+		/// is about to be closed.
+		bool cancel(SOCKET _socket, uint64_t _userData)
+		{
+			io_uring_sqe* sqe = getSqe();
+			if (NULL == sqe)
+			{
+				return false;
+			}
+
+			sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+			sqe->fd           = _socket;
+			sqe->cancel_flags = IORING_ASYNC_CANCEL_FD|IORING_ASYNC_CANCEL_ALL;
+			sqe->user_data    = _userData;
+			submit();
+			return true;
+		}
+
+		/// Cancel request that was queued with _target user data. Submitted
+		/// with other queued requests.
+		bool cancelRequest(uint64_t _target, uint64_t _userData)
+		{
+			io_uring_sqe* sqe = getSqe();
+			if (NULL == sqe)
+			{
+				return false;
+			}
+
+			sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+			sqe->addr      = _target;
+			sqe->user_data = _userData;
+			return true;
+		}
+
+		/// Returns number of requests that can be queued before submission
+		/// queue has to be flushed.
+		uint32_t getSqSpace() const
+		{
+			return *m_sq.ringEntries - (m_sqTail - __atomic_load_n(m_sq.head, __ATOMIC_ACQUIRE) );
+		}
+
+		/// Submit all queued requests and optionally wait for completions,
+		/// with a single `io_uring_enter` call. Requests kernel didn't
+		/// take stay queued, and are submitted by next call. Returns false
+		/// if `io_uring_enter` failed.
+		bool submit(uint32_t _wait = 0)
+		{
+			__atomic_store_n(m_sq.tail, m_sqTail, __ATOMIC_RELEASE);
+
+			uint32_t toSubmit = m_sqTail - m_sqSubmitted;
+			if (0 == toSubmit
+			&&  0 == _wait
+			&&  0 == (__atomic_load_n(m_sq.flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) )
+			{
+				return true;
+			}
+
+			int result;
+			do
+			{
+				result = (int)::syscall(__NR_io_uring_enter
+					, m_fd
+					, toSubmit
+					, _wait
+					, IORING_ENTER_GETEVENTS
+					, NULL
+					, 0
+					);
+			} while (0 > result
+			     &&  EINTR == errno);
+
+			if (0 > result)
+			{
+				// EAGAIN and EBUSY are transient, kernel is out of memory,
+				// or completion queue overflowed and has to be reaped.
+				BX_TRACE("io_uring_enter failed %d.", errno);
+				return false;
+			}
+
+			m_sqSubmitted += result;
+			return true;
+		}
+
+		/// Pop completion. Completion is consumed before it's handled, so
+		/// it's safe to queue or submit new requests while handling it.
+		bool peek(io_uring_cqe& _cqe)
+		{
+			uint32_t head = *m_cq.head;
+			if (head == __atomic_load_n(m_cq.tail, __ATOMIC_ACQUIRE) )
+			{
+				return false;
+			}
+
+			_cqe = m_cq.cqes[head & *m_cq.ringMask];
+			__atomic_store_n(m_cq.head, head+1, __ATOMIC_RELEASE);
+			return true;
+		}
+
+		const uint8_t* getBuffer(uint32_t _cqeFlags) const
+		{
+			uint16_t bid = uint16_t(_cqeFlags >> IORING_CQE_BUFFER_SHIFT);
+			return &m_buffers[bid*m_bufferSize];
+		}
+
+		/// Return buffer selected by completion back to provided buffer ring.
+		void recycle(uint32_t _cqeFlags)
+		{
+			if (0 != (_cqeFlags & IORING_CQE_F_BUFFER) )
+			{
+				uint16_t bid = uint16_t(_cqeFlags >> IORING_CQE_BUFFER_SHIFT);
+				uint16_t tail = getBufTail();
+				addBuffer(bid, tail);
+				__atomic_store_n(&m_bufRing[0].resv, uint16_t(tail+1), __ATOMIC_RELEASE);
+			}
+		}
+
+	private:
+		static const uint16_t BufferGroup = 0;
+
+		struct SqRing
+		{
+			uint32_t* head;
+			uint32_t* tail;
+			uint32_t* ringMask;
+			uint32_t* ringEntries;
+			uint32_t* flags;
+			uint32_t* array;
+		};
+
+		struct CqRing
+		{
+			uint32_t* head;
+			uint32_t* tail;
+			uint32_t* ringMask;
+			io_uring_cqe* cqes;
+		};
+
+		template<typename Ty>
+		static void unmap(Ty*& _ptr, size_t _size)
+		{
+			if (NULL != _ptr)
+			{
+				::munmap(_ptr, _size);
+				_ptr = NULL;
+			}
+		}
+
+		static void* map(size_t _size, int _fd = -1, off_t _offset = 0)
+		{
+			void* ptr = ::mmap(NULL
+				, _size
+				, PROT_READ|PROT_WRITE
+				, -1 == _fd ? MAP_PRIVATE|MAP_ANONYMOUS : MAP_SHARED|MAP_POPULATE
+				, _fd
+				, _offset
+				);
+			return MAP_FAILED == ptr ? NULL : ptr;
+		}
+
+		bool mapRings(const io_uring_params& _params)
+		{
+			size_t sqSize = _params.sq_off.array + _params.sq_entries*sizeof(uint32_t);
+			size_t cqSize = _params.cq_off.cqes  + _params.cq_entries*sizeof(io_uring_cqe);
+			m_sqRingSize = bx::uint32_max(uint32_t(sqSize), uint32_t(cqSize) );
+			m_sqRing = map(m_sqRingSize, m_fd, IORING_OFF_SQ_RING);
+			m_cqRing = m_sqRing;
+
+			m_sqesSize = _params.sq_entries*sizeof(io_uring_sqe);
+			m_sqes = map(m_sqesSize, m_fd, IORING_OFF_SQES);
+
+			if (NULL == m_sqRing
+			||  NULL == m_sqes)
+			{
+				return false;
+			}
+
+			uint8_t* sq = (uint8_t*)m_sqRing;
+			m_sq.head        = (uint32_t*)&sq[_params.sq_off.head];
+			m_sq.tail        = (uint32_t*)&sq[_params.sq_off.tail];
+			m_sq.ringMask    = (uint32_t*)&sq[_params.sq_off.ring_mask];
+			m_sq.ringEntries = (uint32_t*)&sq[_params.sq_off.ring_entries];
+			m_sq.flags       = (uint32_t*)&sq[_params.sq_off.flags];
+			m_sq.array       = (uint32_t*)&sq[_params.sq_off.array];
+
+			uint8_t* cq = (uint8_t*)m_cqRing;
+			m_cq.head     = (uint32_t*)&cq[_params.cq_off.head];
+			m_cq.tail     = (uint32_t*)&cq[_params.cq_off.tail];
+			m_cq.ringMask = (uint32_t*)&cq[_params.cq_off.ring_mask];
+			m_cq.cqes     = (io_uring_cqe*)&cq[_params.cq_off.cqes];
+
+			// SQE index is always same as SQ ring index.
+			for (uint32_t ii = 0, num = *m_sq.ringEntries; ii < num; ++ii)
+			{
+				m_sq.array[ii] = ii;
+			}
+
+			m_sqTail = *m_sq.tail;
+			m_sqSubmitted = m_sqTail;
+
+			return true;
+		}
+
+		bool initBuffers(uint32_t _numBuffers, uint32_t _bufferSize)
+		{
+			BX_CHECK(0 == (_numBuffers & (_numBuffers-1) ), "Number of buffers must be power of 2.");
+
+			m_numBuffers  = _numBuffers;
+			m_bufferSize  = _bufferSize;
+			m_bufRingSize = _numBuffers*sizeof(io_uring_buf);
+			m_bufRing     = (io_uring_buf*)map(m_bufRingSize);
+			m_buffers     = (uint8_t*)map(_numBuffers*_bufferSize);
+
+			if (NULL == m_bufRing
+			||  NULL == m_buffers)
+			{
+				return false;
+			}
+
+			io_uring_buf_reg reg;
+			memset(&reg, 0, sizeof(reg) );
+			reg.ring_addr    = uint64_t(uintptr_t(m_bufRing) );
+			reg.ring_entries = _numBuffers;
+			reg.bgid         = BufferGroup;
+
+			if (0 != ::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) )
+			{
+				BX_TRACE("io_uring provided buffer ring is not supported %d.", errno);
+				return false;
+			}
+
+			for (uint16_t ii = 0; ii < _numBuffers; ++ii)
+			{
+				addBuffer(ii, ii);
+			}
+			__atomic_store_n(&m_bufRing[0].resv, uint16_t(_numBuffers), __ATOMIC_RELEASE);
+
+			return true;
+		}
+
+		// io_uring_buf_ring is not used directly since its flexible array
+		// member has different offset when compiled as C++. Ring tail
+		// overlays `resv` field of the first buffer.
+		uint16_t getBufTail() const
+		{
+			return m_bufRing[0].resv;
+		}
+
+		void addBuffer(uint16_t _bid, uint16_t _at)
+		{
+			io_uring_buf& buf = m_bufRing[_at & (m_numBuffers-1)];
+			buf.addr = uint64_t(uintptr_t(&m_buffers[_bid*m_bufferSize]) );
+			buf.len  = m_bufferSize;
+			buf.bid  = _bid;
+		}
+
+		/// Multishot receive was added after multishot accept and provided
+		/// buffer rings, so if it works everything else bnet uses works too.
+		bool probeMultishotRecv()
+		{
+			int sv[2];
+			if (0 != ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) )
+			{
+				return false;
+			}
+
+			bool supported = false;
+			if (1 == ::send(sv[1], "", 1, 0) )
+			{
+				recv(sv[0], 0);
+				submit(1);
+
+				io_uring_cqe cqe;
+				if (peek(cqe) )
+				{
+					supported = 1 == cqe.res && 0 != (cqe.flags & IORING_CQE_F_MORE);
+					recycle(cqe.flags);
+				}
+
+				cancel(sv[0], 0);
+				::close(sv[0]);
+				::close(sv[1]);
+
+				submit(1);
+				while (peek(cqe) )
+				{
+					recycle(cqe.flags);
+				}
+			}
+			else
+			{
+				::close(sv[0]);
+				::close(sv[1]);
+			}
+
+			BX_TRACE("io_uring multishot receive is %ssupported.", supported ? "" : "not ");
+			return supported;
+		}
+
+		/// Returns NULL if submission queue is full, and flushing it
+		/// didn't make room.
+		io_uring_sqe* getSqe()
+		{
+			if (0 == getSqSpace() )
+			{
+				// Submission queue is full, flush it.
+				submit();
+
+				if (0 == getSqSpace() )
+				{
+					return NULL;
+				}
+			}
+
+			io_uring_sqe* sqe = &((io_uring_sqe*)m_sqes)[m_sqTail & *m_sq.ringMask];
+			memset(sqe, 0, sizeof(io_uring_sqe) );
+			++m_sqTail;
+			return sqe;
+		}
+
+		int m_fd;
+		void* m_sqRing;
+		size_t m_sqRingSize;
+		void* m_cqRing;
+		void* m_sqes;
+		size_t m_sqesSize;
+		io_uring_buf* m_bufRing;
+		size_t m_bufRingSize;
+		uint8_t* m_buffers;
+		uint32_t m_numBuffers;
+		uint32_t m_bufferSize;
+
+		SqRing m_sq;
+		CqRing m_cq;
+		uint32_t m_sqTail;
+		uint32_t m_sqSubmitted;
+	};
+
+} // namespace bnet
+
+#endif // BNET_URING_H_HEADER_GUARD
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz4.h"
+
+#include "test.h"
+
+using namespace bnet;
+
+static const char s_dictText[] =
+	"{\"player\":\"position\":[\"health\":\"inventory\":\"name\":\"true,false,null,"
+	;
+
+static const char* s_words[] =
+{
+	"{\"player\":",
+	"\"position\":[",
+	"\"health\":",
+	"\"inventory\":",
+	"\"name\":\"",
+	"true,",
+	"false,",
+	"null,",
+};
+
+static uint32_t s_seed = 1;
+
+static uint32_t rnd()
+{
+	s_seed = s_seed*1103515245u + 12345u;
+	return s_seed>>8;
+}
+
+static uint32_t fillText(uint8_t* _data, uint32_t _size)
+{
+	uint32_t pos = 0;
+	while (pos < _size)
+	{
+		for (const char* word = s_words[rnd() & 7]; '\0' != *word && pos < _size; ++word)
+		{
+			_data[pos++] = uint8_t(*word);
+		}
+
+		if (pos < _size)
+		{
+			_data[pos++] = uint8_t('0' + rnd()%10);
+		}
+	}
+
+	return _size;
+}
+
+static uint32_t fillRandom(uint8_t* _data, uint32_t _size)
+{
+	for (uint32_t ii = 0; ii < _size; ++ii)
+	{
+		_data[ii] = uint8_t(rnd() );
+	}
+
+	return _size;
+}
+
+/// Worst case size of incompressible data, all literals.
+static uint32_t lz4Bound(uint32_t _size)
+{
+	return _size + _size/255 + 16;
+}
+
+/// Compresses and decompresses _src, returns compressed size.
+static uint32_t roundTrip(const uint8_t* _src, uint32_t _size, Lz4Table* _table, const Lz4Dictionary* _dict)
+{
+	static uint8_t compressed[2*UINT16_MAX];
+	static uint8_t decompressed[UINT16_MAX+1];
+
+	const uint32_t size = lz4Compress(compressed, lz4Bound(_size), _src, _size, _table, _dict);
+	TEST_CHECK(0 != size);
+
+	const int32_t result = lz4Decompress(decompressed, _size, compressed, size, _dict);
+	TEST_CHECK(int32_t(_size) == result);
+	TEST_CHECK(0 == memcmp(_src, decompressed, _size) );
+
+	return size;
+}
+
+static void testRoundTrip()
+{
+	Lz4Table table;
+	lz4InitTable(&table);
+
+	static uint8_t data[UINT16_MAX];
+
+	// Sizes around match find limit, last literals, and length
+	// continuation bytes.
+	static const uint32_t sizes[] = { 0, 1, 4, 5, 12, 13, 14, 15, 16, 17, 64, 269, 270, 271, 1000, 4096, UINT16_MAX };
+	for (uint32_t ii = 0; ii < TEST_COUNTOF(sizes); ++ii)
+	{
+		const uint32_t size = sizes[ii];
+
+		fillText(data, size);
+		const uint32_t text = roundTrip(data, size, &table, NULL);
+		TEST_CHECK(1000 > size || text*2 < size);
+
+		memset(data, 'a', size);
+		const uint32_t run = roundTrip(data, size, &table, NULL);
+		TEST_CHECK(1000 > size || run*50 < size);
+
+		fillRandom(data, size);
+		roundTrip(data, size, &table, NULL);
+	}
+}
+
+static void testIncompressible()
+{
+	Lz4Table table;
+	lz4InitTable(&table);
+
+	static uint8_t src[4096];
+	static uint8_t dst[4096];
+	fillRandom(src, sizeof(src) );
+
+	// Random data doesn't fit into its own size, compressor must fail
+	// instead of writing past end of buffer.
+	TEST_CHECK(0 == lz4Compress(dst, sizeof(src), src, sizeof(src), &table, NULL) );
+
+	const uint32_t size = roundTrip(src, sizeof(src), &table, NULL);
+	TEST_CHECK(size > sizeof(src) );
+	TEST_CHECK(size <= lz4Bound(sizeof(src) ) );
+}
+
+static void testDictionary()
+{
+	Lz4Dictionary* dict = (Lz4Dictionary*)malloc(sizeof(Lz4Dictionary) + sizeof(s_dictText) );
+	lz4InitDictionary(dict, s_dictText, sizeof(s_dictText)-1);
+
+	Lz4Table table;
+	lz4InitTable(&table);
+
+	uint8_t data[256];
+	uint32_t withDict    = 0;
+	uint32_t withoutDict = 0;
+	for (uint32_t ii = 0; ii < 1000; ++ii)
+	{
+		const uint32_t size = fillText(data, 16 + rnd()%(sizeof(data)-16) );
+		withDict    += roundTrip(data, size, &table, dict);
+		withoutDict += roundTrip(data, size, &table, NULL);
+	}
+
+	// Small messages have little repetition of their own.
+	TEST_CHECK(withDict < withoutDict);
+
+	// Match that starts in dictionary and continues into message.
+	const uint32_t tail = 20;
+	memcpy(data, &s_dictText[sizeof(s_dictText)-1-tail], tail);
+	memcpy(&data[tail], s_dictText, 40);
+	const uint32_t size = roundTrip(data, tail+40, &table, dict);
+	TEST_CHECK(size < 20);
+
+	// Data compressed with dictionary can't be decompressed without it.
+	static uint8_t compressed[512];
+	static uint8_t decompressed[256];
+	const uint32_t cs = lz4Compress(compressed, sizeof(compressed), data, tail+40, &table, dict);
+	TEST_CHECK(0 > lz4Decompress(decompressed, sizeof(decompressed), compressed, cs, NULL) );
+
+	free(dict);
+}
+
+static void testTableWrap()
+{
+	Lz4Table table;
+	lz4InitTable(&table);
+
+	// Positions stored in table before wrap must not be matched after.
+	table.base = UINT32_MAX/2 - 1000;
+
+	uint8_t data[1000];
+	for (uint32_t ii = 0; ii < 100; ++ii)
+	{
+		const uint32_t size = fillText(data, 100 + rnd()%900);
+		roundTrip(data, size, &table, NULL);
+	}
+
+	TEST_CHECK(UINT32_MAX/2 > table.base);
+}
+
+static void testMalformed()
+{
+	Lz4Table table;
+	lz4InitTable(&table);
+
+	uint8_t src[1000];
+	fillText(src, sizeof(src) );
+
+	static uint8_t compressed[2000];
+	static uint8_t decompressed[1000];
+	const uint32_t size = lz4Compress(compressed, sizeof(compressed), src, sizeof(src), &table, NULL);
+	TEST_CHECK(0 != size);
+
+	// Truncated input and too small output are rejected, never read or
+	// written past end.
+	for (uint32_t ii = 1; ii < size; ++ii)
+	{
+		const int32_t result = lz4Decompress(decompressed, sizeof(decompressed), compressed, ii, NULL);
+		TEST_CHECK(int32_t(sizeof(src) ) != result);
+	}
+
+	TEST_CHECK(0 > lz4Decompress(decompressed, sizeof(decompressed)-1, compressed, size, NULL) );
+
+	// Offset reaching before start of output.
+	const uint8_t invalidOffset[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+	TEST_CHECK(0 > lz4Decompress(decompressed, sizeof(decompressed), invalidOffset, sizeof(invalidOffset), NULL) );
+
+	// Zero offset.
+	const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+	TEST_CHECK(0 > lz4Decompress(decompressed, sizeof(decompressed), zeroOffset, sizeof(zeroOffset), NULL) );
+}
+
+int main()
+{
+	testRoundTrip();
+	testIncompressible();
+	testDictionary();
+	testTableWrap();
+	testMalformed();
+
+	return testResult();
+}
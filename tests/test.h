@@ -0,0 +1,33 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#ifndef BNET_TEST_H_HEADER_GUARD
+#define BNET_TEST_H_HEADER_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Number of failed checks, test returns non-zero exit code if any
+/// check failed.
+static int s_testFailed = 0;
+
+#define TEST_CHECK(_condition) \
+	do { \
+		if (!(_condition) ) \
+		{ \
+			fprintf(stderr, "%s(%d): Check failed: %s\n", __FILE__, __LINE__, #_condition); \
+			++s_testFailed; \
+		} \
+	} while (0)
+
+#define TEST_COUNTOF(_x) (sizeof(_x)/sizeof(_x[0]) )
+
+inline int testResult()
+{
+	printf("%s\n", 0 == s_testFailed ? "Passed." : "Failed!");
+	return 0 == s_testFailed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // BNET_TEST_H_HEADER_GUARD
@@ -0,0 +1,446 @@
+/*
+ * Copyright 2010-2016 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bnet#license-bsd-2-clause
+ */
+
+#include <bx/bx.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <bnet/bnet.h>
+
+#include "test.h"
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID
+#include <bx/endian.h>
+#include <bx/timer.h>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace bnet;
+
+// Datagram layout from src/udp.h, with default UdpMtu.
+static const uint32_t UdpMtu            = 1200;
+static const uint32_t UdpMaxMessageSize = UdpMtu - 12;
+static const uint32_t UdpConnectSize    = 13;
+static const uint32_t UdpChallengeSize  = 9;
+static const uint32_t UdpWindow         = 256;
+static const uint32_t UdpResendMs       = 100;
+static const uint8_t  UdpAccept         = 0xb2;
+static const uint8_t  UdpConnect        = 0xb1;
+static const uint8_t  UdpChallenge      = 0xb5;
+
+static uint32_t s_seed = 1;
+
+static uint32_t rnd()
+{
+	s_seed = s_seed*1103515245u + 12345u;
+	return s_seed>>8;
+}
+
+static uint64_t nowMs()
+{
+	return uint64_t(bx::getHPCounter() )*1000/bx::getHPFrequency();
+}
+
+static uint16_t getPort()
+{
+	return uint16_t(20000 + (getpid() % 10000) );
+}
+
+static int createSocket(sockaddr_in& _addr)
+{
+	int sock = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	memset(&_addr, 0, sizeof(_addr) );
+	_addr.sin_family = AF_INET;
+	_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t len = sizeof(_addr);
+	::bind(sock, (sockaddr*)&_addr, len);
+	::getsockname(sock, (sockaddr*)&_addr, &len);
+	return sock;
+}
+
+/// Drops and reorders datagrams between client and host.
+struct Relay
+{
+	Relay(uint16_t _hostPort, uint32_t _lossPercent)
+		: lossPercent(_lossPercent)
+	{
+		front = createSocket(frontAddr);
+		back  = createSocket(backAddr);
+
+		memset(&hostAddr, 0, sizeof(hostAddr) );
+		hostAddr.sin_family = AF_INET;
+		hostAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		hostAddr.sin_port = htons(_hostPort);
+
+		memset(&clientAddr, 0, sizeof(clientAddr) );
+		memset(dropped, 0, sizeof(dropped) );
+		memset(reordered, 0, sizeof(reordered) );
+		memset(heldSize, 0, sizeof(heldSize) );
+	}
+
+	~Relay()
+	{
+		::close(front);
+		::close(back);
+	}
+
+	void update()
+	{
+		forward(0, front, back, hostAddr);
+		forward(1, back, front, clientAddr);
+	}
+
+	void forward(uint32_t _dir, int _from, int _to, const sockaddr_in& _addr)
+	{
+		for (;;)
+		{
+			uint8_t data[UdpMtu];
+			sockaddr_in addr;
+			socklen_t len = sizeof(addr);
+			const ssize_t size = ::recvfrom(_from, data, sizeof(data), MSG_DONTWAIT, (sockaddr*)&addr, &len);
+			if (0 >= size)
+			{
+				return;
+			}
+
+			if (0 == _dir)
+			{
+				clientAddr = addr;
+			}
+
+			const uint32_t action = rnd()%100;
+			if (action < lossPercent)
+			{
+				++dropped[_dir];
+				continue;
+			}
+
+			::sendto(_to, data, size_t(size), 0, (const sockaddr*)&_addr, sizeof(_addr) );
+
+			if (0 != heldSize[_dir])
+			{
+				// Held datagram is sent after one that arrived later.
+				::sendto(_to, held[_dir], heldSize[_dir], 0, (const sockaddr*)&_addr, sizeof(_addr) );
+				heldSize[_dir] = 0;
+				++reordered[_dir];
+			}
+			else if (action >= 90)
+			{
+				memcpy(held[_dir], data, size_t(size) );
+				heldSize[_dir] = uint32_t(size);
+			}
+		}
+	}
+
+	sockaddr_in frontAddr;
+	sockaddr_in backAddr;
+	sockaddr_in hostAddr;
+	sockaddr_in clientAddr;
+	int front;
+	int back;
+	uint32_t lossPercent;
+	uint32_t dropped[2];
+	uint32_t reordered[2];
+	uint8_t held[2][UdpMtu];
+	uint32_t heldSize[2];
+};
+
+static uint16_t fillMessage(uint8_t* _data, uint32_t _seq)
+{
+	const uint16_t size = uint16_t(3 + (_seq*7919) % (UdpMaxMessageSize-3) );
+	_data[0] = MessageId::UserDefined;
+	_data[1] = uint8_t(_seq);
+	_data[2] = uint8_t(_seq>>8);
+	for (uint16_t ii = 3; ii < size; ++ii)
+	{
+		_data[ii] = uint8_t(ii + _seq);
+	}
+
+	return size;
+}
+
+static bool checkMessage(const Message* _msg, uint32_t _seq)
+{
+	uint8_t data[UdpMaxMessageSize];
+	const uint16_t size = fillMessage(data, _seq);
+	return size == _msg->size
+		&& 0 == memcmp(data, _msg->data, size)
+		;
+}
+
+/// Sends reliable messages both ways through lossy relay, all must be
+/// delivered once and in order.
+static void testLossy()
+{
+	const uint16_t port = getPort();
+	Relay relay(port, 15);
+
+	Handle listenHandle = listenUdp(0x7f000001, port);
+	Handle client = connectUdp(0x7f000001, ntohs(relay.frontAddr.sin_port) );
+	Handle host = invalidHandle;
+
+	// More than send window, so messages also wait for acks.
+	const uint32_t numMessages = 3*UdpWindow;
+	uint32_t sent[2]     = {};
+	uint32_t received[2] = {};
+	uint64_t payload[2]  = {};
+	uint32_t unreliable  = 0;
+
+	const uint64_t start = nowMs();
+	while (received[0] < numMessages
+	||     received[1] < numMessages)
+	{
+		if (nowMs() - start > 30000)
+		{
+			TEST_CHECK(!"Timeout.");
+			break;
+		}
+
+		relay.update();
+
+		for (uint32_t dir = 0; dir < 2 && isValid(host); ++dir)
+		{
+			if (numMessages == sent[dir])
+			{
+				continue;
+			}
+
+			const Handle handle = 0 == dir ? client : host;
+			for (uint32_t ii = 0; ii < 32 && sent[dir] < numMessages; ++ii)
+			{
+				Message* msg = alloc(handle, UdpMaxMessageSize);
+				msg->size = fillMessage(msg->data, sent[dir]++);
+				payload[dir] += msg->size;
+				send(msg, Channel::ReliableOrdered);
+			}
+
+			Message* msg = alloc(handle, 3);
+			msg->data[0] = MessageId::UserDefined+1;
+			send(msg, Channel::Unreliable);
+		}
+
+		Message* msg = recv();
+		if (NULL == msg)
+		{
+			usleep(100);
+			continue;
+		}
+
+		switch (msg->data[0])
+		{
+		case MessageId::IncomingConnection:
+			TEST_CHECK(!isValid(host) );
+			host = msg->handle;
+			break;
+
+		case MessageId::UserDefined:
+			{
+				const uint32_t dir = msg->handle.idx == host.idx ? 0 : 1;
+				TEST_CHECK(checkMessage(msg, received[dir]) );
+				++received[dir];
+			}
+			break;
+
+		case MessageId::UserDefined+1:
+			++unreliable;
+			break;
+
+		default:
+			TEST_CHECK(!"Unexpected message.");
+			break;
+		}
+
+		release(msg);
+	}
+
+	TEST_CHECK(0 < relay.dropped[0] && 0 < relay.dropped[1]);
+	TEST_CHECK(0 < relay.reordered[0] && 0 < relay.reordered[1]);
+
+	TEST_CHECK(0 < unreliable);
+
+	// Messages received ahead of order are acknowledged across whole
+	// window, so mostly lost ones are resent.
+	const TrafficStats* stats = getStats(client);
+	TEST_CHECK(NULL != stats && stats->bytesSent < payload[0]*2);
+
+	disconnect(client);
+	disconnect(host);
+	stop(listenHandle);
+}
+
+/// Returns 1 if incoming connection was received, and closes it.
+static uint32_t closeIncoming()
+{
+	Message* msg = recv();
+	if (NULL == msg)
+	{
+		return 0;
+	}
+
+	const bool incoming = MessageId::IncomingConnection == msg->data[0];
+	if (incoming)
+	{
+		disconnect(msg->handle);
+	}
+
+	release(msg);
+	return incoming ? 1 : 0;
+}
+
+/// Host answers connect with challenge, and doesn't create connection
+/// until cookie is echoed back from peer's address.
+static void testCookie()
+{
+	const uint16_t port = getPort();
+	Handle listenHandle = listenUdp(0x7f000001, port);
+
+	sockaddr_in hostAddr;
+	memset(&hostAddr, 0, sizeof(hostAddr) );
+	hostAddr.sin_family = AF_INET;
+	hostAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	hostAddr.sin_port = htons(port);
+
+	sockaddr_in addr;
+	int sock = createSocket(addr);
+
+	uint8_t connect[UdpConnectSize] = { UdpConnect };
+	const uint32_t magic = bx::toLittleEndian(BX_MAKEFOURCC('b', 'n', 'e', 't') );
+	memcpy(&connect[1], &magic, sizeof(magic) );
+
+	uint32_t numIncoming = 0;
+	uint8_t reply[UdpMtu];
+	for (uint32_t ii = 0; ii < 4; ++ii)
+	{
+		if (3 == ii)
+		{
+			// Cookie from last challenge.
+			memcpy(&connect[5], &reply[1], sizeof(uint64_t) );
+		}
+		else
+		{
+			memset(&connect[5], int(ii), sizeof(uint64_t) );
+		}
+
+		::sendto(sock, connect, sizeof(connect), 0, (const sockaddr*)&hostAddr, sizeof(hostAddr) );
+
+		ssize_t size = -1;
+		for (const uint64_t start = nowMs(); 0 > size && nowMs() - start < 1000;)
+		{
+			numIncoming += closeIncoming();
+
+			size = ::recv(sock, reply, sizeof(reply), MSG_DONTWAIT);
+			usleep(100);
+		}
+
+		if (3 == ii)
+		{
+			TEST_CHECK(1 == size && UdpAccept == reply[0]);
+		}
+		else
+		{
+			TEST_CHECK(UdpChallengeSize == size && UdpChallenge == reply[0]);
+			TEST_CHECK(0 == numIncoming);
+		}
+	}
+
+	for (const uint64_t start = nowMs(); 0 == numIncoming && nowMs() - start < 1000;)
+	{
+		numIncoming += closeIncoming();
+	}
+
+	TEST_CHECK(1 == numIncoming);
+
+	::close(sock);
+	stop(listenHandle);
+}
+
+/// Connects resent while handshake is in progress never create second
+/// connection for same peer.
+static void testReconnect()
+{
+	const uint16_t port = getPort();
+	Handle listenHandle = listenUdp(0x7f000001, port);
+
+	for (uint32_t round = 0; round < 3; ++round)
+	{
+		Handle clients[8];
+		for (uint32_t ii = 0; ii < TEST_COUNTOF(clients); ++ii)
+		{
+			clients[ii] = connectUdp(0x7f000001, port);
+		}
+
+		uint32_t numIncoming = 0;
+		uint32_t numConnected = 0;
+		Handle hosts[TEST_COUNTOF(clients)];
+
+		// Waits past resend time, so resent connects reach host too.
+		for (const uint64_t start = nowMs(); nowMs() - start < 4*UdpResendMs;)
+		{
+			Message* msg = recv();
+			if (NULL == msg)
+			{
+				usleep(100);
+				continue;
+			}
+
+			if (MessageId::IncomingConnection == msg->data[0])
+			{
+				TEST_CHECK(numIncoming < TEST_COUNTOF(hosts) );
+				if (numIncoming < TEST_COUNTOF(hosts) )
+				{
+					hosts[numIncoming] = msg->handle;
+				}
+				++numIncoming;
+			}
+
+			release(msg);
+		}
+
+		for (uint32_t ii = 0; ii < TEST_COUNTOF(clients); ++ii)
+		{
+			const TrafficStats* stats = getStats(clients[ii]);
+			numConnected += NULL != stats && 0 != stats->handshakes;
+		}
+
+		TEST_CHECK(TEST_COUNTOF(clients) == numIncoming);
+		TEST_CHECK(TEST_COUNTOF(clients) == numConnected);
+
+		for (uint32_t ii = 0; ii < TEST_COUNTOF(clients); ++ii)
+		{
+			disconnect(clients[ii]);
+		}
+
+		for (uint32_t ii = 0; ii < numIncoming && ii < TEST_COUNTOF(hosts); ++ii)
+		{
+			disconnect(hosts[ii]);
+		}
+	}
+
+	stop(listenHandle);
+}
+
+int main()
+{
+	init(64, 1);
+	testCookie();
+	testReconnect();
+	testLossy();
+	shutdown();
+
+	return testResult();
+}
+#else
+int main()
+{
+	printf("UDP connections are not available on this platform.\n");
+	return testResult();
+}
+#endif // BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID